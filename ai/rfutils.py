@@ -93,3 +93,29 @@ def read_data(files, poscount, locidx):
         vals.append(fvals)
         labels.append(fname.endswith('.s'))
     return np.array(locs), np.array(vals), np.array(labels)
+
+
+def read_features(fname):
+    """Maps a features file written by ../tools/ramfuzz-features.
+
+    Unlike read_data(), which aligns values by their position in the log, the
+    features are aligned by location and occurrence, so they don't shift when
+    earlier choices in a run differ.  Returns a pair (scipy.sparse.csr_matrix
+    with a row per run, numpy array of labels: true for '.s', false for '.f').
+    The values and labels are memory-mapped rather than read.
+    """
+    from scipy.sparse import csr_matrix
+    head = np.memmap(fname, np.uint32, 'r', 0, (4, ))
+    if head[0].tobytes() != b'RFF1':
+        raise ValueError('Not a features file: ' + fname)
+    dims = int(head[1])
+    runs, nnz, nkeys = np.memmap(fname, np.uint64, 'r', 16, (3, ))
+    offset = 40 + 16 * int(nkeys)
+    rows = np.memmap(fname, np.uint64, 'r', offset, (int(runs) + 1, ))
+    offset += 8 * (int(runs) + 1)
+    value = np.memmap(fname, np.float64, 'r', offset, (int(nnz), ))
+    offset += 8 * int(nnz)
+    index = np.memmap(fname, np.uint32, 'r', offset, (int(nnz), ))
+    offset += 4 * int(nnz)
+    labels = np.memmap(fname, np.bool_, 'r', offset, (int(runs), ))
+    return csr_matrix((value, index, rows), shape=(int(runs), dims)), labels
@@ -0,0 +1,54 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "AliasTable.hpp"
+
+#include <cmath>
+#include <numeric>
+
+using namespace std;
+
+namespace ramfuzz {
+
+constexpr unsigned AliasTable::scale;
+
+AliasTable::AliasTable(const vector<double> &weights)
+    : prob(weights.size(), scale), alias(weights.size()) {
+  const auto n = weights.size();
+  const double sum = accumulate(weights.cbegin(), weights.cend(), 0.);
+  // Vose's method: rows below average borrow the rest of their probability
+  // from rows above average.  Working in units of scale/n per row keeps the
+  // arithmetic exact enough that every row ends up full.
+  vector<double> p(n);
+  vector<size_t> small, large;
+  for (size_t i = 0; i < n; ++i) {
+    alias[i] = i;
+    p[i] = weights[i] * n / sum * scale;
+    (p[i] < scale ? small : large).push_back(i);
+  }
+  while (!small.empty() && !large.empty()) {
+    const auto s = small.back(), l = large.back();
+    small.pop_back();
+    prob[s] = p[s] > 0 ? unsigned(lround(p[s])) : 0;
+    alias[s] = l;
+    p[l] -= scale - p[s];
+    if (p[l] < scale) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // Leftovers are within rounding error of full; prob already says so.
+}
+
+} // namespace ramfuzz
@@ -0,0 +1,41 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+
+namespace ramfuzz {
+
+/// Walker's alias table, which draws index i with probability proportional to
+/// weights[i] in constant time, no matter how many weights there are.
+///
+/// To draw, pick a row i uniformly and a number r uniformly from [0, scale);
+/// the result is i if r < prob[i], otherwise alias[i].  Generated harnesses
+/// embed such tables for their method roulettes (see
+/// runtime::gen::pick() in ../runtime/ramfuzz-rt.hpp, which must use the same
+/// scale).
+struct AliasTable {
+  /// Probabilities are fractions of this.  Must equal runtime::alias_scale.
+  static constexpr unsigned scale = 1u << 16;
+
+  std::vector<unsigned> prob;  ///< Chance of keeping row i, out of scale.
+  std::vector<unsigned> alias; ///< What to draw instead of row i.
+
+  /// Builds the table for \p weights, which must be non-negative, with at
+  /// least one positive.
+  explicit AliasTable(const std::vector<double> &weights);
+};
+
+} // namespace ramfuzz
@@ -0,0 +1,92 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+
+namespace clang {
+class CXXRecordDecl;
+} // namespace clang
+
+namespace ramfuzz {
+
+class NameGetter;
+
+/// Keeps class details permanently, even after AST is deleted.  Has enough
+/// information to allow various ways of referencing the class in generated
+/// code.  Examples:
+/// - a simple class A is referenced by just its name (if visible)
+/// - a class in a namespace is referenced by its qualified name
+/// - a class template is referenced by its name and template parameters, eg:
+///   A<T1, T2>. But this requires a preamble like `template<class T1, class
+///   T2>` somewhere before the reference.
+class ClassDetails {
+public:
+  ClassDetails() = default;
+
+  /// Parameters needn't survive past this constructor.
+  explicit ClassDetails(const clang::CXXRecordDecl &, NameGetter &);
+
+  /// Reconstitutes details previously taken apart via the accessors below.
+  ClassDetails(std::string name, std::string qname, std::string tpreamble,
+               std::string tparams, bool is_template, bool is_visible)
+      : name_(std::move(name)), qname_(std::move(qname)),
+        prefix_(std::move(tpreamble)), suffix_(std::move(tparams)),
+        is_template_(is_template), is_visible_(is_visible) {}
+
+  /// The class's fully qualified name.  Meant to uniquely identify this object.
+  const std::string &qname() const { return qname_; };
+
+  /// Unqualified class name.
+  const std::string &name() const { return name_; };
+
+  /// Template preamble, eg, `template<typename T1, int n>`.  Empty if the class
+  /// is not a template.
+  const std::string &tpreamble() const { return prefix_; }
+
+  /// Template parameters, eg, `<T1, n>`.  Empty if the class is not a template.
+  const std::string &tparams() const { return suffix_; }
+
+  bool operator<(const ClassDetails &that) const {
+    return this->qname_ < that.qname_;
+  }
+
+  ClassDetails &operator=(const ClassDetails &that) = default;
+
+  bool is_template() const { return is_template_; }
+
+  bool is_visible() const { return is_visible_; }
+
+private:
+  std::string name_, qname_, prefix_, suffix_;
+  bool is_template_; ///< True iff this is a class template.
+  ///< True iff this class is visible from the outermost scope.
+  bool is_visible_;
+};
+
+inline llvm::raw_ostream &operator<<(llvm::raw_ostream &os,
+                                     const ClassDetails &cd) {
+  return os << cd.qname() << cd.tparams();
+}
+
+/// Maps a class to all subclasses that inherit from it directly.
+using Inheritance = std::map<ClassDetails, std::vector<ClassDetails>>;
+
+} // namespace ramfuzz
@@ -0,0 +1,148 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "GenCache.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace ramfuzz;
+using namespace std;
+
+namespace {
+
+/// Magic bytes at the beginning of every cache entry.
+constexpr char magic[4] = {'R', 'F', 'K', '1'};
+
+string md5(llvm::StringRef data) {
+  llvm::MD5 h;
+  h.update(data);
+  llvm::MD5::MD5Result res;
+  h.final(res);
+  llvm::SmallString<32> hex;
+  llvm::MD5::stringifyResult(res, hex);
+  return hex.str().str();
+}
+
+void put(ostream &os, uint64_t x) {
+  os.write(reinterpret_cast<const char *>(&x), sizeof(x));
+}
+
+bool get(istream &is, uint64_t &x) {
+  return bool(is.read(reinterpret_cast<char *>(&x), sizeof(x)));
+}
+
+void put(ostream &os, const string &s) {
+  put(os, uint64_t(s.size()));
+  os.write(s.data(), s.size());
+}
+
+bool get(istream &is, string &s) {
+  uint64_t len;
+  if (!get(is, len))
+    return false;
+  s.resize(len);
+  return len == 0 || is.read(&s[0], len);
+}
+
+} // anonymous namespace
+
+namespace ramfuzz {
+
+GenCache::GenCache(const string &dir, const string &generator)
+    : dir(dir), generator(generator) {
+  llvm::sys::fs::create_directories(dir);
+}
+
+string GenCache::digest(const string &fname) {
+  const auto buf = llvm::MemoryBuffer::getFile(fname);
+  return buf ? md5((*buf)->getBuffer()) : string();
+}
+
+string GenCache::digest_contents(llvm::StringRef contents) {
+  return md5(contents);
+}
+
+string GenCache::entry(const string &source, const string &command) const {
+  string key = generator;
+  key.append(1, '\0').append(source).append(1, '\0').append(command);
+  return dir + "/" + md5(key) + ".rfgc";
+}
+
+bool GenCache::lookup(const string &source, const string &command,
+                      SourceCode &code) const {
+  ifstream f(entry(source, command), ios::binary);
+  char m[sizeof(magic)];
+  if (!f.read(m, sizeof(m)) || !equal(m, m + sizeof(m), magic))
+    return false;
+  string gen, src, cmd;
+  uint64_t ndeps;
+  // Guard against digest collisions by checking the full key.
+  if (!get(f, gen) || !get(f, src) || !get(f, cmd) || gen != generator ||
+      src != source || cmd != command || !get(f, ndeps))
+    return false;
+  for (auto n = ndeps; n > 0; --n) {
+    string dep, dig;
+    if (!get(f, dep) || !get(f, dig) || digest(dep) != dig)
+      return false;
+  }
+  return code.read(f);
+}
+
+bool GenCache::store(const string &source, const string &command,
+                     const map<string, string> &deps,
+                     const SourceCode &code) const {
+  ostringstream os;
+  os.write(magic, sizeof(magic));
+  put(os, generator);
+  put(os, source);
+  put(os, command);
+  put(os, uint64_t(deps.size()));
+  for (const auto &d : deps) {
+    if (d.second.empty())
+      return false;
+    put(os, d.first);
+    put(os, d.second);
+  }
+  code.write(os);
+  // Write a temporary file and rename it, so readers never see partial entries.
+  int fd;
+  llvm::SmallString<128> tmp;
+  if (llvm::sys::fs::createUniqueFile(dir + "/%%%%%%%%.tmp", fd, tmp))
+    return false;
+  {
+    llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+    out << os.str();
+    if (out.has_error()) {
+      out.clear_error();
+      llvm::sys::fs::remove(tmp);
+      return false;
+    }
+  }
+  if (llvm::sys::fs::rename(tmp, entry(source, command))) {
+    llvm::sys::fs::remove(tmp);
+    return false;
+  }
+  return true;
+}
+
+} // namespace ramfuzz
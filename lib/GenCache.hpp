@@ -0,0 +1,70 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "Generated.hpp"
+#include "llvm/ADT/StringRef.h"
+
+namespace ramfuzz {
+
+/// On-disk cache of SourceCode, so unchanged sources needn't be parsed again.
+///
+/// An entry is keyed on the source's name, the command that compiles it, and
+/// the generator's identity.  It records every file read while parsing the
+/// source (the source itself and every header it #includes), together with a
+/// digest of each file's contents.  The entry is valid only while all those
+/// files have the same contents, which is what the preprocessed source depends
+/// on.  So touching a file doesn't invalidate the cache, but changing it does.
+///
+/// Entries are written atomically, so concurrent generators can share a cache
+/// directory.
+class GenCache {
+public:
+  /// Keeps the cache in directory \p dir, creating it if needed.  Entries made
+  /// by generators other than \p generator (eg, a digest of the generator
+  /// executable) are ignored.
+  GenCache(const std::string &dir, const std::string &generator);
+
+  /// Fills \p code from the entry for \p source and \p command.  Returns false,
+  /// leaving \p code unspecified, if there is no valid entry.
+  bool lookup(const std::string &source, const std::string &command,
+              SourceCode &code) const;
+
+  /// Stores \p code as the entry for \p source and \p command.  \p deps maps
+  /// each file read while generating code to the digest of the contents that
+  /// were read, which the file may no longer hold.  Returns false on failure,
+  /// which doesn't affect correctness, only speed.
+  bool store(const std::string &source, const std::string &command,
+             const std::map<std::string, std::string> &deps,
+             const SourceCode &code) const;
+
+  /// Digest of file \p fname's contents.  Empty if the file can't be read.
+  static std::string digest(const std::string &fname);
+
+  /// Digest of \p contents, as digest() would compute for a file holding them.
+  static std::string digest_contents(llvm::StringRef contents);
+
+private:
+  /// Name of the entry file for \p source and \p command.
+  std::string entry(const std::string &source,
+                    const std::string &command) const;
+
+  std::string dir, generator;
+};
+
+} // namespace ramfuzz
@@ -0,0 +1,392 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Generated.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+
+#include "llvm/Support/Regex.h"
+
+using namespace ramfuzz;
+using namespace std;
+
+using llvm::raw_ostream;
+
+namespace {
+
+/// Magic bytes at the beginning of serialized SourceCode.
+constexpr char magic[4] = {'R', 'F', 'G', '1'};
+
+void put(ostream &os, uint64_t x) {
+  os.write(reinterpret_cast<const char *>(&x), sizeof(x));
+}
+
+bool get(istream &is, uint64_t &x) {
+  return bool(is.read(reinterpret_cast<char *>(&x), sizeof(x)));
+}
+
+void put(ostream &os, const string &s) {
+  put(os, uint64_t(s.size()));
+  os.write(s.data(), s.size());
+}
+
+bool get(istream &is, string &s) {
+  uint64_t len;
+  if (!get(is, len))
+    return false;
+  s.resize(len);
+  return len == 0 || is.read(&s[0], len);
+}
+
+void put(ostream &os, const ClassDetails &cd) {
+  put(os, cd.name());
+  put(os, cd.qname());
+  put(os, cd.tpreamble());
+  put(os, cd.tparams());
+  put(os, uint64_t(cd.is_template()) | uint64_t(cd.is_visible()) << 1);
+}
+
+bool get(istream &is, ClassDetails &cd) {
+  string name, qname, tpreamble, tparams;
+  uint64_t flags;
+  if (!get(is, name) || !get(is, qname) || !get(is, tpreamble) ||
+      !get(is, tparams) || !get(is, flags))
+    return false;
+  cd = ClassDetails(name, qname, tpreamble, tparams, flags & 1, flags & 2);
+  return true;
+}
+
+template <typename T> void put_all(ostream &os, const T &c);
+template <typename T> bool get_all(istream &is, T &c);
+template <typename K, typename V>
+bool get_all(istream &is, map<K, vector<V>> &m);
+
+void put(ostream &os, const ClassCode &cc) {
+  put(os, cc.cls);
+  put(os, cc.decl);
+  put(os, cc.defs);
+  put_all(os, cc.referenced);
+  put_all(os, cc.enums);
+}
+
+bool get(istream &is, ClassCode &cc) {
+  return get(is, cc.cls) && get(is, cc.decl) && get(is, cc.defs) &&
+         get_all(is, cc.referenced) && get_all(is, cc.enums);
+}
+
+template <typename K, typename V>
+void put(ostream &os, const pair<const K, vector<V>> &kv) {
+  put(os, kv.first);
+  put_all(os, kv.second);
+}
+
+/// Writes the size of container c, followed by its elements.
+template <typename T> void put_all(ostream &os, const T &c) {
+  put(os, uint64_t(c.size()));
+  for (const auto &x : c)
+    put(os, x);
+}
+
+/// Reads what put_all() wrote, appending each element to c.
+template <typename T> bool get_all(istream &is, T &c) {
+  uint64_t n;
+  if (!get(is, n))
+    return false;
+  for (uint64_t i = 0; i < n; ++i) {
+    typename T::value_type x;
+    if (!get(is, x))
+      return false;
+    c.insert(c.end(), move(x));
+  }
+  return true;
+}
+
+/// Reads what put_all() wrote for a map.
+template <typename K, typename V>
+bool get_all(istream &is, map<K, vector<V>> &m) {
+  uint64_t n;
+  if (!get(is, n))
+    return false;
+  for (uint64_t i = 0; i < n; ++i) {
+    K key;
+    if (!get(is, key) || !get_all(is, m[key]))
+      return false;
+  }
+  return true;
+}
+
+/// The qualified name of the class template that \p type (eg, "ns::Vec<int>")
+/// specializes.
+string template_name(llvm::StringRef type) {
+  auto name = type.split('<').first.trim();
+  name.consume_front("::");
+  return name.str();
+}
+
+} // anonymous namespace
+
+namespace ramfuzz {
+
+void SourceCode::write(ostream &os) const {
+  os.write(magic, sizeof(magic));
+  put_all(os, classes);
+  put_all(os, inheritance);
+}
+
+bool SourceCode::read(istream &is) {
+  char m[sizeof(magic)];
+  if (!is.read(m, sizeof(m)) || !equal(m, m + sizeof(m), magic))
+    return false;
+  classes.clear();
+  inheritance.clear();
+  return get_all(is, classes) && get_all(is, inheritance);
+}
+
+void Generated::add(const SourceCode &code) {
+  for (const auto &cc : code.classes)
+    if (processed.insert(cc.cls).second)
+      classes.push_back(cc);
+  for (const auto &i : code.inheritance) {
+    auto &subs = inheritance[i.first];
+    for (const auto &sub : i.second)
+      if (none_of(subs.cbegin(), subs.cend(), [&sub](const ClassDetails &s) {
+            return s.qname() == sub.qname();
+          }))
+        subs.push_back(sub);
+  }
+}
+
+vector<string> Generated::prune(const vector<string> &roots,
+                                const string &include, const string &exclude) {
+  llvm::Regex incl(include), excl(exclude);
+  const auto excluded = [&](const ClassDetails &cls) {
+    return !exclude.empty() && excl.match(cls.qname());
+  };
+  for (auto &i : inheritance)
+    i.second.erase(remove_if(i.second.begin(), i.second.end(), excluded),
+                   i.second.end());
+
+  set<string> unknown(roots.cbegin(), roots.cend());
+  set<string> templates;
+  for (const auto &t : instances)
+    templates.insert(template_name(t));
+  // Without roots or include, exclude alone selects the roots.
+  const bool all = roots.empty() && include.empty();
+  vector<const ClassDetails *> todo;
+  for (const auto &cls : processed) {
+    const bool named = unknown.erase(cls.qname()) ||
+                       (cls.is_template() && templates.count(cls.qname()));
+    if ((all || named || (!include.empty() && incl.match(cls.qname()))) &&
+        !excluded(cls))
+      todo.push_back(&cls);
+  }
+  map<ClassDetails, const ClassCode *> code;
+  for (const auto &cc : classes)
+    code[cc.cls] = &cc;
+  set<ClassDetails> reachable;
+  while (!todo.empty()) {
+    const auto &cls = *todo.back();
+    todo.pop_back();
+    const auto cc = code.find(cls);
+    if (cc == code.end() || !reachable.insert(cls).second)
+      continue;
+    for (const auto &ref : cc->second->referenced)
+      todo.push_back(&ref);
+    const auto subs = inheritance.find(cls);
+    if (subs != inheritance.end())
+      for (const auto &sub : subs->second)
+        if (!sub.is_template() && sub.is_visible())
+          todo.push_back(&sub);
+  }
+
+  classes.erase(remove_if(classes.begin(), classes.end(),
+                          [&reachable](const ClassCode &cc) {
+                            return !reachable.count(cc.cls);
+                          }),
+                classes.end());
+  processed = move(reachable);
+  return vector<string>(unknown.cbegin(), unknown.cend());
+}
+
+vector<string> Generated::instantiate(const vector<string> &types) {
+  set<string> templates;
+  for (const auto &cls : processed)
+    if (cls.is_template())
+      templates.insert(cls.qname());
+  vector<string> unknown;
+  for (const auto &t : types)
+    (templates.count(template_name(t)) ? instances : unknown).push_back(t);
+  return unknown;
+}
+
+vector<ClassDetails> Generated::submakable(const ClassDetails &cls) const {
+  vector<ClassDetails> res;
+  const auto found = inheritance.find(cls);
+  if (found != inheritance.end())
+    for (const auto &sub : found->second)
+      if (!sub.is_template() && sub.is_visible())
+        res.push_back(sub);
+  return res;
+}
+
+int Generated::emit(const vector<string> &sources, raw_ostream &outh,
+                    raw_ostream &outc, raw_ostream &errs) const {
+  raw_ostream *const out = &outc;
+  return emit(sources, outh, out, errs);
+}
+
+int Generated::emit(const vector<string> &sources, raw_ostream &outh,
+                    llvm::ArrayRef<raw_ostream *> outc,
+                    raw_ostream &errs) const {
+  assert(!outc.empty());
+  outh << "#include <memory>\n";
+  for (const auto &f : sources)
+    outh << "#include \"" << f << "\"\n";
+  outh << "#include \"ramfuzz-rt.hpp\"\n";
+  outh << "\nnamespace ramfuzz {\n\n";
+  for (const auto out : outc)
+    *out << R"(#include <cstddef>
+#include <iostream>
+#include <string>
+
+namespace ramfuzz {
+
+)";
+  EnumValues enums;
+  for (const auto &cc : classes) {
+    outh << cc.decl;
+    *outc[shard(cc.cls.qname(), outc.size())] << cc.defs;
+    enums.insert(cc.enums.cbegin(), cc.enums.cend());
+  }
+  for (const auto &e : enums) {
+    outh << "  namespace runtime {\n";
+    outh << "    template<> " << e.first << "* gen::make<" << e.first
+         << ">(bool);\n";
+    outh << "  } // namespace runtime\n";
+    auto &out = *outc[shard(e.first, outc.size())];
+    out << "template<> " << e.first << "* ramfuzz::runtime::gen::make<"
+        << e.first << ">(bool) {\n";
+    out << "  static " << e.first << " a[] = {\n    ";
+    int comma = 0;
+    for (const auto &n : e.second)
+      out << (comma++ ? "," : "") << n;
+    out << "  };\n";
+    out << "  return &a[between(std::size_t(0), sizeof(a)/sizeof(a[0]) - "
+           "1)];\n";
+    out << "}\n";
+  }
+  gen_submakers_defs(outh, outc);
+  if (!instances.empty())
+    outh << "// Instantiated once, in a generated .cpp file, rather than in "
+            "every includer.\n";
+  for (const auto &t : instances) {
+    outh << "extern template class harness<" << t << ">;\n";
+    *outc[shard(t, outc.size())] << "template class harness<" << t << ">;\n";
+  }
+  for (const auto out : outc)
+    *out << "} // namespace ramfuzz\n";
+  outh << "} // namespace ramfuzz\n";
+  const auto missing = missingClasses();
+  if (!missing.empty()) {
+    errs << "RamFuzz code will likely not compile, because the following "
+            "required classes \nwere not processed:\n";
+    for (const auto &cls : missing)
+      errs << cls << '\n';
+    return 2;
+  }
+  return 0;
+}
+
+void Generated::gen_submakers_defs(raw_ostream &outh,
+                                   llvm::ArrayRef<raw_ostream *> outc) const {
+  // Numbered per output, so a class's submakers don't change names when
+  // classes are added to other shards.
+  vector<unsigned> next_maker_fns(outc.size() + 1, 0);
+  for (const auto &cls : processed) {
+    const auto name = cls.qname() + cls.tparams();
+    const auto &tmpl_preamble = cls.tpreamble();
+    const auto out = tmpl_preamble.empty() ? shard(cls.qname(), outc.size())
+                                           : outc.size();
+    auto &next_maker_fn = next_maker_fns[out];
+    string stemp;
+    llvm::raw_string_ostream outt(stemp);
+    const auto subs = submakable(cls);
+    if (subs.empty()) {
+      outt << tmpl_preamble << "const size_t harness<" << name
+           << ">::subcount = 0;\n";
+      outt << tmpl_preamble << name << "*(*const harness<" << name
+           << ">::submakers[])(runtime::gen&) = {};\n";
+    } else {
+      const auto first_maker_fn = next_maker_fn;
+      outt << "namespace {\n";
+      for (const auto &subcls : subs)
+        outt << tmpl_preamble << name << "* submakerfn" << next_maker_fn++
+             << "(runtime::gen& g) { return g.make<" << subcls.qname()
+             << ">(true); }\n";
+      outt << "} // anonymous namespace\n";
+      outt << tmpl_preamble << name << "*(*const harness<" << name
+           << ">::submakers[])(runtime::gen&) = { ";
+      for (auto i = first_maker_fn; i < next_maker_fn; ++i)
+        outt << (i == first_maker_fn ? "" : ",") << "submakerfn" << i;
+      outt << " };\n";
+      outt << tmpl_preamble << "const size_t harness<" << name
+           << ">::subcount = " << next_maker_fn - first_maker_fn << ";\n\n";
+    }
+    (out < outc.size() ? *outc[out] : outh) << outt.str();
+  }
+}
+
+vector<string> Generated::missingClasses() const {
+  set<ClassDetails> referenced;
+  for (const auto &cc : classes) {
+    referenced.insert(cc.referenced.cbegin(), cc.referenced.cend());
+    const auto subs = submakable(cc.cls);
+    referenced.insert(subs.cbegin(), subs.cend());
+  }
+  vector<ClassDetails> diff;
+  set_difference(referenced.cbegin(), referenced.cend(), processed.cbegin(),
+                 processed.cend(), inserter(diff, diff.begin()));
+  vector<string> names;
+  for (const auto &d : diff)
+    names.push_back(d.qname());
+  return names;
+}
+
+unsigned shard(const string &name, size_t shards) {
+  // FNV-1a, which unlike std::hash is the same on every platform and build.
+  uint64_t h = 14695981039346656037u;
+  for (const char c : name) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 1099511628211u;
+  }
+  return shards ? h % shards : 0;
+}
+
+bool write_if_changed(const string &fname, const string &content) {
+  {
+    ifstream old(fname, ios::binary);
+    if (old && string(istreambuf_iterator<char>(old),
+                      istreambuf_iterator<char>()) == content)
+      return true;
+  }
+  ofstream f(fname, ios::binary);
+  f.write(content.data(), content.size());
+  return bool(f);
+}
+
+} // namespace ramfuzz
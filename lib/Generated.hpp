@@ -0,0 +1,145 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file Generated code in a form that outlives the AST it came from.
+///
+/// The RamFuzz match callback (RamFuzz.cpp) turns each class under test into a
+/// ClassCode.  All ClassCode from one source file make up a SourceCode, which
+/// can be saved and loaded (eg, by GenCache).  A Generated object merges the
+/// SourceCode of all input files and emits the final fuzz.hpp and fuzz.cpp.
+
+#pragma once
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ClassDetails.hpp"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace ramfuzz {
+
+/// Enum types, each mapped to its enumerators' qualified names.
+using EnumValues = std::map<std::string, std::vector<std::string>>;
+
+/// Code generated for one class under test.
+struct ClassCode {
+  ClassDetails cls;
+
+  /// Goes into fuzz.hpp: the harness<cls> declaration, followed by its member
+  /// definitions if cls is a template.
+  std::string decl;
+
+  /// Goes into fuzz.cpp: definitions of harness<cls> members that aren't
+  /// templates.
+  std::string defs;
+
+  /// Classes whose harnesses this code uses.
+  std::set<ClassDetails> referenced;
+
+  /// Enums this code makes values of.
+  EnumValues enums;
+};
+
+/// Code generated for all classes under test defined in one source file.
+struct SourceCode {
+  std::vector<ClassCode> classes; ///< In the order they were processed.
+  Inheritance inheritance;        ///< All inheritance seen in the source.
+
+  /// Writes *this to \p os in a binary format that read() understands.
+  void write(std::ostream &os) const;
+
+  /// Replaces *this with what write() wrote into \p is.  Returns false (leaving
+  /// *this in an unspecified state) if \p is doesn't contain valid SourceCode.
+  bool read(std::istream &is);
+};
+
+/// Merges SourceCode from multiple sources and emits it.
+class Generated {
+public:
+  /// Adds all classes from \p code that haven't already been added, and all of
+  /// its inheritance.
+  void add(const SourceCode &code);
+
+  /// Emits the harnesses of all added classes into \p outh (declarations and
+  /// templates) and \p outc (other definitions).  \p sources are the headers
+  /// that outh must #include.  Returns 0 on success and 2 if some referenced
+  /// classes have no harness, in which case it also lists them in \p errs.
+  int emit(const std::vector<std::string> &sources, llvm::raw_ostream &outh,
+           llvm::raw_ostream &outc, llvm::raw_ostream &errs) const;
+
+  /// Like emit() above, but spreads the definitions over the (non-empty) \p
+  /// outc, each a separate translation unit that can be compiled in parallel.
+  /// Each class's definitions go to outc[shard(qname, outc.size())], so a
+  /// class stays in the same output as long as the number of outputs doesn't
+  /// change; within an output, classes keep the order they were added in.
+  int emit(const std::vector<std::string> &sources, llvm::raw_ostream &outh,
+           llvm::ArrayRef<llvm::raw_ostream *> outc,
+           llvm::raw_ostream &errs) const;
+
+  /// Drops all added classes that aren't reachable from the roots, so emit()
+  /// skips them.  The roots are the classes whose qualified names are in \p
+  /// roots or match the regex \p include, except those matching the regex \p
+  /// exclude.  (Empty regexes match nothing.)  If both \p roots and \p include
+  /// are empty, all classes not matching \p exclude are roots.  A class is
+  /// reachable if it's a root, or its harness is used by the harness of a
+  /// reachable class, or it's a subclass of a reachable class.  Excluded
+  /// subclasses are left out of their superclasses' submakers, but an excluded
+  /// class is still kept if some kept harness uses it.  Returns the elements
+  /// of \p roots that name no added class.  The regexes must be valid.
+  std::vector<std::string> prune(const std::vector<std::string> &roots,
+                                 const std::string &include,
+                                 const std::string &exclude);
+
+  /// Makes emit() explicitly instantiate the harnesses of \p types (eg,
+  /// "ns::Vec<int>"), each in one of the outc, and declare those instantiations
+  /// extern in outh, so translation units that #include outh don't instantiate
+  /// them again.  The class templates of \p types are also roots for prune().
+  /// Returns the elements of \p types whose class template wasn't added; those
+  /// are ignored.
+  std::vector<std::string> instantiate(const std::vector<std::string> &types);
+
+  /// Classes whose harnesses are referenced in the emitted code but weren't
+  /// added.
+  std::vector<std::string> missingClasses() const;
+
+private:
+  /// Emits the definition of member submakers for each added class into outh
+  /// (for templates) or the class's shard of outc.
+  void gen_submakers_defs(llvm::raw_ostream &outh,
+                          llvm::ArrayRef<llvm::raw_ostream *> outc) const;
+
+  /// Subclasses of \p cls that its harness's submakers can make.
+  std::vector<ClassDetails> submakable(const ClassDetails &cls) const;
+
+  std::vector<ClassCode> classes;   ///< In the order they were added.
+  std::set<ClassDetails> processed; ///< Classes in classes.
+  Inheritance inheritance;          ///< Merged, without duplicates.
+  std::vector<std::string> instances; ///< Types passed to instantiate().
+};
+
+/// Which of \p shards outputs the definitions for class or enum \p name go
+/// into.  Depends only on name and shards.
+unsigned shard(const std::string &name, size_t shards);
+
+/// Writes \p content into file \p fname, unless the file already has exactly
+/// that content.  Leaving unchanged files alone keeps their timestamps, so
+/// builds depending on them needn't redo any work.  Returns false on failure.
+bool write_if_changed(const std::string &fname, const std::string &content);
+
+} // namespace ramfuzz
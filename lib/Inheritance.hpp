@@ -25,9 +25,6 @@
 
 namespace ramfuzz {
 
-/// Maps a class to all subclasses that inherit from it directly.
-using Inheritance = std::map<ClassDetails, std::vector<ClassDetails>>;
-
 /// Builds up an Inheritance object by analyzing all non-anonymous classes in
 /// some source code.  Can be used standalone via process() or within an
 /// existing ClangTool via tackOnto().
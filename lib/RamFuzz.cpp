@@ -14,7 +14,11 @@
 
 #include "RamFuzz.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
 #include <iterator>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -22,11 +26,22 @@
 #include <unordered_map>
 #include <vector>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "AliasTable.hpp"
+#include "GenCache.hpp"
+#include "Generated.hpp"
 #include "Inheritance.hpp"
 #include "Util.hpp"
+#include "clang/AST/Attr.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/CompilerInstance.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
 
 using namespace ramfuzz;
 using namespace std;
@@ -217,15 +232,17 @@ private:
   const PrintingPolicy &prtpol;
 };
 
-/// Generates RamFuzz code into an ostream.  The user can tack a RamFuzz
-/// instance onto a MatchFinder for running it via a frontend action.  After the
-/// frontend action completes, the user must call finish().
+/// Generates RamFuzz code for each class it matches.  The user can tack a
+/// RamFuzz instance onto a MatchFinder for running it via a frontend action.
+/// After the frontend action completes, the user collects the generated code
+/// via takeClasses() and emits it via Generated.
 class RamFuzz : public MatchFinder::MatchCallback {
 public:
-  /// Prepares for emitting RamFuzz code into outh and outc.
-  RamFuzz(raw_ostream &outh, raw_ostream &outc)
-      : outh(outh), outc(outc), prtpol(RFPP()), tparam_names(default_typename) {
-  }
+  /// Spins harness methods as often as \p weights say; see GenOptions.  The
+  /// weights must outlive *this.
+  explicit RamFuzz(const Weights &weights)
+      : outh(hbuf), outc(cbuf), prtpol(RFPP()), tparam_names(default_typename),
+        weights(weights) {}
 
   /// Match callback.  Expects Result to have a CXXRecordDecl* binding for
   /// "class".
@@ -234,23 +251,19 @@ public:
   /// Adds to MF a matcher that will generate RamFuzz code (capturing *this).
   void tackOnto(MatchFinder &MF);
 
-  /// Calculates which classes under test need their harness specialization but
-  /// don't have it yet.  This happens when a harness class is referenced in
-  /// RamFuzz output code, but its generation hasn't been triggered.
-  vector<string> missingClasses();
-
-  /// Emits aditional code required for correct compilation.
-  void finish(const Inheritance &);
+  /// Returns the code generated for all classes matched so far, in the order
+  /// they were matched, and forgets it.
+  vector<ClassCode> takeClasses() { return move(classes); }
 
 private:
   /// If C is abstract, generates an inner class that's a concrete subclass of
   /// C.
   void gen_concrete_impl(const CXXRecordDecl *C, const ASTContext &ctx);
 
-  /// If ty is an enum, adds it to referenced_enums.
+  /// If ty is an enum, adds it to current.enums.
   void register_enum(const Type &ty);
 
-  /// If ty is a class, adds it to referenced_classes.
+  /// If ty is a class, adds it to current.referenced.
   void register_class(const Type &ty);
 
   void reg(const Type &ty) {
@@ -283,20 +296,31 @@ private:
                      unsigned size            ///< Size of croulette.
   );
 
-  /// Generates the declaration and definition of member mroulette.
+  /// Generates the declaration and definition of member mroulette, listing
+  /// mutating methods, then field setters, then observers.  If the mutators
+  /// that gen spins aren't all equally weighted, also generates their alias
+  /// table (members wprob and walias).
   void gen_mroulette(
       const ClassDetails &cls, ///< Class under test.
-      const unordered_map<string, unsigned>
-          &namecount ///< Method-name histogram of the class under test.
+      const map<string, unsigned>
+          &namecount, ///< Method-name histogram of the class under test.
+      const set<string>
+          &observers, ///< Harness methods that call const methods under test.
+      const set<string> &setters, ///< Harness methods that set public fields.
+      const map<string, double>
+          &hweights, ///< Harness methods' weights; absent means 1.
+      bool fill      ///< True iff the harness has fill(), so gen won't spin
+                     ///< the setters.
   );
 
+  /// The weight of the harness method for \p D, a method or field of class
+  /// \p cls: from the weights file if it names D, otherwise from D's
+  /// ramfuzz_weight annotation, otherwise 1.
+  double weight(const ClassDetails &cls, const NamedDecl &D) const;
+
   /// Generates the declaration of cls member submakers.
   void gen_submakers_decl(const ClassDetails &cls);
 
-  /// Generates the definition of member submakers for each of the classes
-  /// processed so far.
-  void gen_submakers_defs(const Inheritance &);
-
   /// True iff M's harness method may recursively call itself.  For example, a
   /// copy constructor's harness needs to construct another object of the same
   /// type, which involves a second harness that may itself call the copy
@@ -320,11 +344,15 @@ private:
       bool may_recurse ///< True iff generated body may recursively call itself.
   );
 
-  /// Where to output generated declarations (typically a header file).
-  raw_ostream &outh;
+  /// Buffers for outh and outc.
+  string hbuf, cbuf;
+
+  /// Where to output generated declarations of the current class (see
+  /// ClassCode::decl).
+  raw_string_ostream outh;
 
-  /// Where to output generated code (typically a C++ source file).
-  raw_ostream &outc;
+  /// Where to output generated code of the current class (see ClassCode::defs).
+  raw_string_ostream outc;
 
   /// Where to output generated definitions of possibly templated code.
   unique_ptr<raw_string_ostream> outt;
@@ -332,18 +360,15 @@ private:
   /// Policy for printing to outh and outc.
   PrintingPolicy prtpol;
 
-  /// Classes under test that were referenced in generated code.
-  set<ClassDetails> referenced_classes;
+  /// Code for the class being processed.
+  ClassCode current;
 
-  /// Qualified names of classes under test whose harness specializations have
-  /// been generated.
-  set<ClassDetails> processed_classes;
-
-  /// Enum types for which parameters have been generated.  Maps the enum name
-  /// to its values.
-  unordered_map<string, vector<string>> referenced_enums;
+  /// Code for all classes processed so far.
+  vector<ClassCode> classes;
 
   NameGetter tparam_names; ///< Gets template-parameter names.
+
+  const Weights &weights; ///< Weights from the user; see GenOptions.
 };
 
 /// Valid identifier from a CXXMethodDecl name.
@@ -391,25 +416,29 @@ string class_under_test(const CXXRecordDecl *C, NameGetter& ng) {
   return strm.str();
 }
 
-} // anonymous namespace
-
-vector<string> RamFuzz::missingClasses() {
-  vector<ClassDetails> diff;
-  set_difference(referenced_classes.cbegin(), referenced_classes.cend(),
-                 processed_classes.cbegin(), processed_classes.cend(),
-                 inserter(diff, diff.begin()));
-  vector<string> names;
-  for (const auto &d : diff)
-    names.push_back(d.qname());
-  return names;
+/// True iff all of C's state is in public fields that its harness can set,
+/// so setting them all after any constructor yields any possible C value.
+bool fillable(const CXXRecordDecl *C) {
+  if (C->getNumBases() || C->field_empty())
+    return false;
+  for (const auto f : C->fields()) {
+    const auto ty = f->getType();
+    if (f->getAccess() != AS_public || ty.isConstQualified() ||
+        ty->getAsCXXRecordDecl() || ty->isReferenceType())
+      return false;
+  }
+  return true;
 }
 
+} // anonymous namespace
+
 void RamFuzz::register_enum(const Type &ty) {
   if (const auto et = ty.getAs<EnumType>()) {
     const auto decl = et->getDecl();
-    const string name = decl->getQualifiedNameAsString();
+    auto &values = current.enums[decl->getQualifiedNameAsString()];
+    values.clear();
     for (const auto c : decl->enumerators())
-      referenced_enums[name].push_back(c->getQualifiedNameAsString());
+      values.push_back(c->getQualifiedNameAsString());
   }
 }
 
@@ -419,7 +448,7 @@ void RamFuzz::register_class(const Type &ty) {
     return;
   if (const auto t = dyn_cast<ClassTemplateSpecializationDecl>(rec))
     rec = t->getSpecializedTemplate()->getTemplatedDecl();
-  referenced_classes.insert(ClassDetails(*rec, tparam_names));
+  current.referenced.insert(ClassDetails(*rec, tparam_names));
 }
 
 void RamFuzz::gen_concrete_methods(const CXXRecordDecl *C, const string &cls,
@@ -496,36 +525,106 @@ void RamFuzz::gen_croulette(const ClassDetails &cls, unsigned size) {
   outh << "  using cptr = " << cls << "* (harness::*)();\n";
   outh << "  static constexpr unsigned ccount = " << size << ";\n";
   outh << "  static const cptr croulette[ccount];\n";
+  outh << "  // Same as (this->*croulette[idx])(), but without an indirect "
+          "call.\n";
+  outh << "  " << cls << "* construct(unsigned idx);\n";
 
+  const auto name = valident(cls.name());
   *outt << cls.tpreamble() << "const typename harness<" << cls
         << ">::cptr harness<" << cls << ">::croulette[] = {\n  ";
   for (unsigned i = 0; i < size; ++i)
-    *outt << (i ? ", " : "") << "&harness<" << cls
-          << ">::" << valident(cls.name()) << i;
+    *outt << (i ? ", " : "") << "&harness<" << cls << ">::" << name << i;
   *outt << "\n};\n";
+  *outt << cls.tpreamble() << cls << "* harness<" << cls
+        << ">::construct(unsigned idx) {\n";
+  *outt << "  switch (idx) {\n";
+  for (unsigned i = 0; i < size; ++i)
+    *outt << "  case " << i << ": return " << name << i << "();\n";
+  *outt << "  default: return nullptr;\n";
+  *outt << "  }\n}\n";
 }
 
 void RamFuzz::gen_mroulette(const ClassDetails &cls,
-                            const unordered_map<string, unsigned> &namecount) {
-  unsigned mroulette_size = 0;
-  *outt << cls.tpreamble() << "const typename harness<" << cls
-        << ">::mptr harness<" << cls << ">::mroulette[] = {\n  ";
+                            const map<string, unsigned> &namecount,
+                            const set<string> &observers,
+                            const set<string> &setters,
+                            const map<string, double> &hweights, bool fill) {
+  vector<string> methods, setting, observing;
   const auto name = valident(cls.name());
-  size_t idx = 0;
   for (const auto &nc : namecount) {
     if (nc.first == name)
       continue; // Skip methods corresponding to constructors under test.
     for (unsigned i = 0; i < nc.second; ++i) {
-      *outt << (idx++ ? ", " : "") << "&harness<" << cls << ">::" << nc.first
-            << i;
-      mroulette_size++;
+      const auto m = nc.first + to_string(i);
+      (observers.count(m) ? observing : setters.count(m) ? setting : methods)
+          .push_back(m);
     }
   }
+  const auto spun = fill ? methods.size() : methods.size() + setting.size();
+  methods.insert(methods.end(), setting.cbegin(), setting.cend());
+  const auto mutcount = methods.size();
+  methods.insert(methods.end(), observing.cbegin(), observing.cend());
+
+  vector<double> w;
+  for (size_t i = 0; i < spun; ++i) {
+    const auto found = hweights.find(methods[i]);
+    w.push_back(found == hweights.end() ? 1. : found->second);
+  }
+  if (!w.empty() && none_of(w.cbegin(), w.cend(),
+                            [](double x) { return x > 0.; })) {
+    outh << "  // All spun methods have weight 0, so none is spun.\n";
+    outh << "  static constexpr bool nospin = true;\n";
+  } else if (any_of(w.cbegin(), w.cend(), [](double x) { return x != 1.; })) {
+    const AliasTable table(w);
+    outh << "  // Alias table for spinning mroulette[0.." << spun
+         << ") by weight.\n";
+    outh << "  static const unsigned wprob[" << spun << "], walias[" << spun
+         << "];\n";
+    for (const auto &col : {make_pair("wprob", &table.prob),
+                            make_pair("walias", &table.alias)}) {
+      *outt << cls.tpreamble() << "const unsigned harness<" << cls
+            << ">::" << col.first << "[] = {";
+      for (size_t i = 0; i < spun; ++i)
+        *outt << (i ? ", " : "") << (*col.second)[i];
+      *outt << "};\n";
+    }
+  }
+
+  *outt << cls.tpreamble() << "const typename harness<" << cls
+        << ">::mptr harness<" << cls << ">::mroulette[] = {\n  ";
+  for (size_t i = 0; i < methods.size(); ++i)
+    *outt << (i ? ", " : "") << "&harness<" << cls << ">::" << methods[i];
   *outt << "\n};\n";
+  *outt << cls.tpreamble() << "void harness<" << cls
+        << ">::invoke_method(unsigned idx) {\n";
+  *outt << "  switch (idx) {\n";
+  for (size_t i = 0; i < methods.size(); ++i)
+    *outt << "  case " << i << ": " << methods[i] << "(); break;\n";
+  *outt << "  }\n}\n";
 
   outh << "  using mptr = void (harness::*)();\n";
-  outh << "  static constexpr unsigned mcount = " << mroulette_size << ";\n";
+  outh << "  static constexpr unsigned mcount = " << methods.size() << ";\n";
   outh << "  static const mptr mroulette[mcount];\n";
+  outh << "  // mroulette[0..mutcount) may change obj; the rest are const.\n";
+  outh << "  static constexpr unsigned mutcount = " << mutcount << ";\n";
+  outh << "  // mroulette[mutcount-setcount..mutcount) set public fields.\n";
+  outh << "  static constexpr unsigned setcount = " << setting.size() << ";\n";
+  outh << "  // Same as (this->*mroulette[idx])(), but without an indirect "
+          "call.\n";
+  outh << "  void invoke_method(unsigned idx);\n";
+}
+
+double RamFuzz::weight(const ClassDetails &cls, const NamedDecl &D) const {
+  const auto found = weights.find(cls.qname() + "::" + D.getNameAsString());
+  if (found != weights.end())
+    return found->second;
+  for (const auto a : D.specific_attrs<AnnotateAttr>()) {
+    StringRef ann = a->getAnnotation();
+    double w;
+    if (ann.consume_front("ramfuzz_weight=") && !ann.getAsDouble(w) && w >= 0.)
+      return w;
+  }
+  return 1.;
 }
 
 void RamFuzz::gen_submakers_decl(const ClassDetails &cls) {
@@ -536,42 +635,6 @@ void RamFuzz::gen_submakers_decl(const ClassDetails &cls) {
   outh << "  static " << cls << " *(*const submakers[])(runtime::gen &);\n";
 }
 
-void RamFuzz::gen_submakers_defs(const Inheritance &sc) {
-  auto next_maker_fn = 0u;
-  for (const auto &cls : processed_classes) {
-    const auto name = cls.qname() + cls.tparams();
-    const auto &tmpl_preamble = cls.tpreamble();
-    string stemp;
-    outt.reset(new raw_string_ostream(stemp));
-    const auto found = sc.find(cls);
-    if (found == sc.end() || found->second.empty()) {
-      *outt << tmpl_preamble << "const size_t harness<" << name
-            << ">::subcount = 0;\n";
-      *outt << tmpl_preamble << name << "*(*const harness<" << name
-            << ">::submakers[])(runtime::gen&) = {};\n";
-    } else {
-      const auto first_maker_fn = next_maker_fn;
-      *outt << "namespace {\n";
-      for (const auto &subcls : found->second)
-        if (!subcls.is_template() && subcls.is_visible()) {
-          *outt << tmpl_preamble << name << "* submakerfn" << next_maker_fn++
-                << "(runtime::gen& g) { return g.make<" << subcls.qname()
-                << ">(true); }\n";
-          referenced_classes.insert(subcls);
-        }
-      *outt << "} // anonymous namespace\n";
-      *outt << tmpl_preamble << name << "*(*const harness<" << name
-            << ">::submakers[])(runtime::gen&) = { ";
-      for (auto i = first_maker_fn; i < next_maker_fn; ++i)
-        *outt << (i == first_maker_fn ? "" : ",") << "submakerfn" << i;
-      *outt << " };\n";
-      *outt << tmpl_preamble << "const size_t harness<" << name
-            << ">::subcount = " << next_maker_fn - first_maker_fn << ";\n\n";
-    }
-    (tmpl_preamble.empty() ? outc : outh) << outt->str();
-  }
-}
-
 bool RamFuzz::harness_may_recurse(const CXXMethodDecl *M,
                                   const ASTContext &ctx) {
   for (const auto &ram : M->parameters()) {
@@ -589,10 +652,9 @@ void RamFuzz::gen_method(const Twine &hname, const CXXMethodDecl *M,
   *outt << hname << "() {\n";
   if (isa<CXXConstructorDecl>(M)) {
     if (may_recurse) {
-      *outt << "  if (++calldepth >= depthlimit && safectr) {\n";
-      *outt << "    --calldepth;\n";
+      *outt << "  const runtime::depth_guard depth(calldepth);\n";
+      *outt << "  if (calldepth >= depthlimit && safectr)\n";
       *outt << "    return (this->*safectr)();\n";
-      *outt << "  }\n";
     }
     const auto parent = M->getParent();
     *outt << "  auto r = new ";
@@ -602,10 +664,9 @@ void RamFuzz::gen_method(const Twine &hname, const CXXMethodDecl *M,
       *outt << class_under_test(parent, tparam_names) << "(";
   } else {
     if (may_recurse) {
-      *outt << "  if (++calldepth >= depthlimit) {\n";
-      *outt << "    --calldepth;\n";
+      *outt << "  const runtime::depth_guard depth(calldepth);\n";
+      *outt << "  if (calldepth >= depthlimit)\n";
       *outt << "    return;\n";
-      *outt << "  }\n";
     }
     *outt << "  obj->" << method_streamer(*M, prtpol) << "(";
   }
@@ -643,8 +704,6 @@ void RamFuzz::gen_method(const Twine &hname, const CXXMethodDecl *M,
     register_enum(*valty);
   }
   *outt << ");\n";
-  if (may_recurse)
-    *outt << "  --calldepth;\n";
   if (isa<CXXConstructorDecl>(M))
     *outt << "  return r;\n";
   *outt << "}\n\n";
@@ -657,6 +716,8 @@ void RamFuzz::run(const MatchFinder::MatchResult &Result) {
     string stemp;
     outt.reset(new raw_string_ostream(stemp));
     ClassDetails cls(*C, tparam_names);
+    current = ClassCode();
+    current.cls = cls;
     const auto tmpl = C->getDescribedClassTemplate();
     outh << cls.tpreamble();
     if (cls.tpreamble().empty())
@@ -683,7 +744,10 @@ void RamFuzz::run(const MatchFinder::MatchResult &Result) {
     outh << "  " << cls << "* obj; // Object under test.\n";
     outh << "  // True if obj was successfully internally created.\n";
     outh << "  operator bool() const { return obj; }\n";
-    unordered_map<string, unsigned> namecount;
+    // Ordered, so mroulette is the same on every run.
+    map<string, unsigned> namecount;
+    set<string> observers;
+    map<string, double> hweights;
     size_t ccount = 0;
     string safectr;
     for (auto M : C->methods()) {
@@ -711,6 +775,10 @@ void RamFuzz::run(const MatchFinder::MatchResult &Result) {
                  may_recurse);
       if (safectr.empty() && !may_recurse && isa<CXXConstructorDecl>(M))
         safectr = name + to_string(namecount[name]);
+      if (M->isConst())
+        observers.insert(name + to_string(namecount[name]));
+      if (!isa<CXXConstructorDecl>(M))
+        hweights[name + to_string(namecount[name])] = weight(cls, *M);
       namecount[name]++;
     }
     if (C->needsImplicitDefaultConstructor()) {
@@ -725,23 +793,36 @@ void RamFuzz::run(const MatchFinder::MatchResult &Result) {
       outh << "; }\n";
       ccount++;
     }
+    set<string> setters;
+    string fill; // Body of fill().
     for (const auto f : C->fields()) {
       const auto ty = f->getType();
       if (f->getAccess() == AS_public && !ty.isConstQualified() &&
           !ty->getAsCXXRecordDecl()) {
         StringRef fname = f->getName(); // Keep StringRef existing.
         const Twine name = Twine("random_") + fname;
-        outh << "  void " << name << namecount[name.str()] << "();\n";
-        *outt << cls.tpreamble() << "void harness<" << cls << ">::" << name
-              << namecount[name.str()] << "() {\n";
+        const auto setter = name.str() + to_string(namecount[name.str()]);
+        outh << "  void " << setter << "();\n";
+        *outt << cls.tpreamble() << "void harness<" << cls << ">::" << setter
+              << "() {\n";
         *outt << "  obj->" << *f << " = *g.make<" << type_streamer(ty, prtpol)
               << ">();\n";
         reg(*ty);
         *outt << "}\n";
+        fill += "  " + setter + "();\n";
+        setters.insert(setter);
+        hweights[setter] = weight(cls, *f);
         namecount[name.str()]++;
       }
     }
-    gen_mroulette(cls, namecount);
+    const bool has_fill = fillable(C);
+    gen_mroulette(cls, namecount, observers, setters, hweights, has_fill);
+    if (has_fill) {
+      outh << "  // Sets all of obj's fields, which hold all of its state.\n";
+      outh << "  void fill();\n";
+      *outt << cls.tpreamble() << "void harness<" << cls << ">::fill() {\n"
+            << fill << "}\n";
+    }
     if (ccount) {
       gen_croulette(cls, ccount);
       outh << "  // Ctr safe from depthlimit; won't call another harness "
@@ -755,7 +836,7 @@ void RamFuzz::run(const MatchFinder::MatchResult &Result) {
       *outt
           << cls.tpreamble() << "harness<" << cls
           << ">::harness(runtime::gen& g)\n"
-          << "  : g(g), obj((this->*croulette[g.between(0u,ccount-1)])()) {}\n";
+          << "  : g(g), obj(construct(g.between(0u,ccount-1))) {}\n";
     } else
       outh << "  // No public constructors -- user must provide this:\n";
     outh << "  harness(runtime::gen& g);\n";
@@ -763,31 +844,14 @@ void RamFuzz::run(const MatchFinder::MatchResult &Result) {
     outh << "};\n";
     *outt << "\n";
     (tmpl ? outh : outc) << outt->str();
-    processed_classes.insert(cls);
+    current.decl = move(outh.str());
+    current.defs = move(outc.str());
+    hbuf.clear();
+    cbuf.clear();
+    classes.push_back(move(current));
   }
 }
 
-void RamFuzz::finish(const Inheritance &sc) {
-  for (auto e : referenced_enums) {
-    outh << "  namespace runtime {\n";
-    outh << "    template<> " << e.first << "* gen::make<"
-         << e.first << ">(bool);\n";
-    outh << "  } // namespace runtime\n";
-    outc << "template<> " << e.first << "* ramfuzz::runtime::gen::make<"
-         << e.first << ">(bool) {\n";
-    outc << "  static " << e.first << " a[] = {\n    ";
-    int comma = 0;
-    for (const auto &n : e.second)
-      outc << (comma++ ? "," : "") << n;
-    outc << "  };\n";
-    outc << "  return &a[between(std::size_t(0), sizeof(a)/sizeof(a[0]) - "
-            "1)];\n";
-    outc << "}\n";
-  }
-
-  gen_submakers_defs(sc);
-}
-
 void RamFuzz::tackOnto(MatchFinder &MF) {
   static const auto matcher =
       cxxRecordDecl(isExpansionInMainFile(), isDefinition(),
@@ -797,42 +861,260 @@ void RamFuzz::tackOnto(MatchFinder &MF) {
   MF.addMatcher(matcher, this);
 }
 
-namespace ramfuzz {
+namespace {
 
-int genTests(ClangTool &tool, const vector<string> &sources, raw_ostream &outh,
-             raw_ostream &outc, raw_ostream &errs) {
-  outh << "#include <memory>\n";
-  for (const auto &f : sources)
-    outh << "#include \"" << f << "\"\n";
-  outh << "#include \"ramfuzz-rt.hpp\"\n";
-  outh << "\nnamespace ramfuzz {\n\n";
-  outc << R"(#include <cstddef>
-#include <iostream>
-#include <string>
+/// Records every file read while processing each source, for GenCache.
+class DepCollector : public SourceFileCallbacks {
+public:
+  bool handleBeginSource(CompilerInstance &CI) override {
+    ci = &CI;
+    return true;
+  }
 
-namespace ramfuzz {
+  void handleEndSource() override {
+    const auto &sm = ci->getSourceManager();
+    for (auto it = sm.fileinfo_begin(); it != sm.fileinfo_end(); ++it) {
+      // ClangTool may have changed the working directory; see ClangTool::run().
+      SmallString<256> path(it->first->getName());
+      llvm::sys::fs::make_absolute(path);
+      const auto name = path.str().str();
+      // Digest the contents Clang parsed, not what the file holds by now.
+      const auto buf = it->second->getRawBuffer();
+      deps[name] = buf ? GenCache::digest_contents(buf->getBuffer())
+                       : GenCache::digest(name);
+    }
+  }
 
-)";
+  /// Absolute file names, mapped to digests of their contents as read.
+  map<string, string> deps;
+
+private:
+  CompilerInstance *ci = nullptr;
+};
+
+/// Runs RamFuzz over all of tool's sources and puts the result into code.
+/// Returns the result of tool.run().
+int process(ClangTool &tool, SourceCode &code,
+            SourceFileCallbacks *callbacks = nullptr,
+            const Weights &weights = Weights()) {
   MatchFinder mf;
-  RamFuzz rf(outh, outc);
+  RamFuzz rf(weights);
   rf.tackOnto(mf);
   InheritanceBuilder inh;
   inh.tackOnto(mf);
-  const int run_error = tool.run(newFrontendActionFactory(&mf).get());
-  rf.finish(inh.getInheritance());
-  outc << "} // namespace ramfuzz\n";
-  outh << "} // namespace ramfuzz\n";
-  if (run_error)
-    return 1;
-  const auto missing = rf.missingClasses();
-  if (!missing.empty()) {
-    errs << "RamFuzz code will likely not compile, because the following "
-            "required classes \nwere not processed:\n";
-    for (const auto cls : missing)
-      errs << cls << '\n';
-    return 2;
-  }
-  return 0;
+  const int run_error =
+      tool.run(newFrontendActionFactory(&mf, callbacks).get());
+  code.classes = rf.takeClasses();
+  code.inheritance = inh.getInheritance();
+  return run_error;
+}
+
+/// All of db's commands for compiling source, concatenated.
+string commands(const CompilationDatabase &db, const string &source) {
+  string res;
+  for (const auto &cmd : db.getCompileCommands(getAbsolutePath(source))) {
+    res += cmd.Directory;
+    for (const auto &arg : cmd.CommandLine)
+      res.append(1, '\0').append(arg);
+    res += '\n';
+  }
+  return res;
+}
+
+/// Part of the cache key that captures \p weights, which change the generated
+/// code just like the compile commands do.
+string describe(const Weights &weights) {
+  string res;
+  for (const auto &w : weights) {
+    res.append(1, '\0').append(w.first).append(1, '\0');
+    res.append(reinterpret_cast<const char *>(&w.second), sizeof(w.second));
+  }
+  return res;
+}
+
+/// Generates code for source \p src, whose cache key is \p cmd, into \p code.
+/// Stores the result in \p cache, if that's non-null.  Returns the result of
+/// ClangTool::run().
+int generate(const CompilationDatabase &db, const string &src,
+             const string &cmd, const Weights &weights, GenCache *cache,
+             SourceCode &code) {
+  map<string, string> deps;
+  const int run_error = genSource(db, src, code, deps, weights);
+  if (!run_error && cache)
+    cache->store(src, cmd, deps, code);
+  return run_error;
+}
+
+/// Like generate(), but for each sources[i] with i in \p todo, putting the
+/// result into codes[i].  Runs up to \p jobs child processes at a time, each
+/// handling one source.  (Threads won't do, because ClangTool::run() changes
+/// the working directory of the whole process.)  Returns true iff all sources
+/// were processed successfully.
+bool generate_parallel(const CompilationDatabase &db,
+                       const vector<string> &sources,
+                       const vector<string> &cmds, const vector<size_t> &todo,
+                       unsigned jobs, const Weights &weights, GenCache *cache,
+                       vector<SourceCode> &codes) {
+  struct Child {
+    size_t idx;     ///< Index of the child's source.
+    string outfile; ///< Where the child writes the source's SourceCode.
+  };
+  map<pid_t, Child> running;
+  bool ok = true;
+  size_t next = 0;
+  llvm::outs().flush();
+  while (next < todo.size() || !running.empty()) {
+    while (next < todo.size() && running.size() < jobs) {
+      const auto i = todo[next++];
+      SmallString<128> outfile;
+      int fd;
+      if (llvm::sys::fs::createTemporaryFile("ramfuzz", "rfg", fd, outfile)) {
+        ok &= !generate(db, sources[i], cmds[i], weights, cache, codes[i]);
+        continue;
+      }
+      close(fd);
+      const pid_t pid = fork();
+      if (pid == 0) {
+        const int run_error =
+            generate(db, sources[i], cmds[i], weights, cache, codes[i]);
+        {
+          ofstream out(outfile.str(), ios::binary);
+          codes[i].write(out);
+        }
+        _exit(run_error ? 1 : 0);
+      }
+      if (pid < 0) {
+        llvm::sys::fs::remove(outfile);
+        ok &= !generate(db, sources[i], cmds[i], weights, cache, codes[i]);
+        continue;
+      }
+      running[pid] = Child{i, outfile.str()};
+    }
+    if (running.empty())
+      continue;
+    int wstatus;
+    const pid_t pid = waitpid(-1, &wstatus, 0);
+    if (pid < 0 && errno != EINTR) {
+      llvm::errs() << "Lost track of child processes\n";
+      return false;
+    }
+    const auto child = running.find(pid);
+    if (child == running.end())
+      continue;
+    const auto i = child->second.idx;
+    ifstream in(child->second.outfile, ios::binary);
+    if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) || !codes[i].read(in)) {
+      ok = false;
+      if (!WIFEXITED(wstatus))
+        llvm::errs() << "Crashed while processing " << sources[i] << '\n';
+    }
+    in.close();
+    llvm::sys::fs::remove(child->second.outfile);
+    running.erase(child);
+  }
+  return ok;
+}
+
+} // anonymous namespace
+
+namespace ramfuzz {
+
+int genTests(ClangTool &tool, const vector<string> &sources, raw_ostream &outh,
+             raw_ostream &outc, raw_ostream &errs) {
+  SourceCode code;
+  const int run_error = process(tool, code);
+  Generated gen;
+  gen.add(code);
+  const int missing =
+      gen.emit(sources, outh, outc, run_error ? llvm::nulls() : errs);
+  return run_error ? 1 : missing;
+}
+
+int genTests(const CompilationDatabase &db, const vector<string> &sources,
+             const GenOptions &opts, raw_ostream &outh,
+             ArrayRef<raw_ostream *> outc, raw_ostream &errs) {
+  unique_ptr<GenCache> cache;
+  if (!opts.cachedir.empty())
+    cache.reset(new GenCache(opts.cachedir, opts.generator));
+  vector<string> cmds;
+  vector<SourceCode> codes(sources.size());
+  vector<size_t> todo;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    cmds.push_back(commands(db, sources[i]) + describe(opts.weights));
+    if (!cache || !cache->lookup(sources[i], cmds[i], codes[i]))
+      todo.push_back(i);
+  }
+  bool run_error = false;
+  if (opts.jobs > 1 && todo.size() > 1)
+    run_error =
+        !generate_parallel(db, sources, cmds, todo, opts.jobs, opts.weights,
+                           cache.get(), codes);
+  else
+    for (const auto i : todo)
+      if (generate(db, sources[i], cmds[i], opts.weights, cache.get(),
+                   codes[i]))
+        run_error = true;
+  // Merging in source order makes the output independent of which child
+  // finished first.
+  Generated gen;
+  for (const auto &code : codes)
+    gen.add(code);
+  const int status = emitTests(gen, sources, opts, outh, outc,
+                               run_error ? llvm::nulls() : errs);
+  return run_error ? 1 : status;
+}
+
+bool readWeights(const string &fname, Weights &weights, raw_ostream &errs) {
+  ifstream f(fname);
+  if (!f) {
+    errs << "Cannot read " << fname << '\n';
+    return false;
+  }
+  unsigned lineno = 0;
+  for (string line; getline(f, line);) {
+    ++lineno;
+    const auto trimmed = StringRef(line).trim();
+    const auto sep = trimmed.find_first_of(" \t");
+    const auto name = trimmed.substr(0, sep), rest = trimmed.substr(sep);
+    if (name.empty() || name.startswith("#"))
+      continue;
+    double w;
+    if (rest.trim().getAsDouble(w) || w < 0.) {
+      errs << fname << ':' << lineno << ": expected a name and a weight\n";
+      return false;
+    }
+    weights[name.str()] = w;
+  }
+  return true;
+}
+
+int genSource(const CompilationDatabase &db, const string &src,
+              SourceCode &code, map<string, string> &deps,
+              const Weights &weights) {
+  ClangTool tool(db, src);
+  DepCollector collector;
+  const int run_error = process(tool, code, &collector, weights);
+  deps = move(collector.deps);
+  const auto path = getAbsolutePath(src);
+  if (!deps.count(path))
+    deps[path] = GenCache::digest(path);
+  return run_error;
+}
+
+int emitTests(Generated &gen, const vector<string> &sources,
+              const GenOptions &opts, raw_ostream &outh,
+              ArrayRef<raw_ostream *> outc, raw_ostream &errs) {
+  int status = 0;
+  for (const auto &type : gen.instantiate(opts.instances)) {
+    errs << "Class template of " << type << " was not processed\n";
+    status = 2;
+  }
+  if (!opts.roots.empty() || !opts.include.empty() || !opts.exclude.empty())
+    for (const auto &root : gen.prune(opts.roots, opts.include, opts.exclude)) {
+      errs << "Root class " << root << " was not processed\n";
+      status = 2;
+    }
+  return max(status, gen.emit(sources, outh, outc, errs));
 }
 
 } // namespace ramfuzz
@@ -15,16 +15,22 @@
 #pragma once
 
 #include <iostream>
+#include <map>
 #include <string>
 #include <vector>
 
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace ramfuzz {
+class Generated;
+struct SourceCode;
+
 /// Runs RamFuzz action in a ClangTool.
 ///
-/// @return the result of tool.run().
+/// @return 1 if tool.run() failed, 2 if the generated code references classes
+/// that weren't processed, and 0 otherwise.
 int genTests(
     clang::tooling::ClangTool &tool, ///< Tool to run.
     const std::vector<std::string>
@@ -33,4 +39,77 @@ int genTests(
     llvm::raw_ostream &outc, ///< Where to output generated code.
     llvm::raw_ostream &errs  ///< Where to output errors.
     );
+
+/// How often gen spins each harness method, relative to the others in the same
+/// harness, keyed by the qualified name of the method or field under test (eg,
+/// "ns::C::insert"), which covers all overloads.  The default weight is 1, and
+/// 0 means never.  Only the methods gen spins while making objects are
+/// affected.  A method or field can also carry its weight in the source, as
+/// __attribute__((annotate("ramfuzz_weight=2.5"))); the Weights entry wins.
+using Weights = std::map<std::string, double>;
+
+/// Reads \p weights from file \p fname.  Each line holds a name and its
+/// weight, separated by whitespace; blank lines and lines starting with '#'
+/// are skipped.  Returns false after writing a message to \p errs if the file
+/// can't be read or has a malformed line.
+bool readWeights(const std::string &fname, Weights &weights,
+                 llvm::raw_ostream &errs);
+
+/// Options for genTests() below.
+struct GenOptions {
+  /// Directory in which to cache the code generated from each source (see
+  /// GenCache.hpp).  Empty means no caching.
+  std::string cachedir;
+
+  /// Identifies the generator build; cache entries from other builds are
+  /// ignored.
+  std::string generator;
+
+  /// How many sources to parse at the same time, each in its own process.
+  unsigned jobs = 1;
+
+  /// If any of these are non-empty, only classes reachable from the roots
+  /// they select are emitted; see Generated::prune().  The regexes must be
+  /// valid.
+  std::vector<std::string> roots;
+  std::string include, exclude;
+
+  /// Harness-method weights; see Weights.
+  Weights weights;
+
+  /// Specializations of class templates (eg, "ns::Vec<int>") whose harnesses
+  /// to instantiate once in outc instead of in every includer of outh; see
+  /// Generated::instantiate().
+  std::vector<std::string> instances;
+};
+
+/// Like genTests() above, but processes each source with its own ClangTool
+/// built from \p db, so that sources can be cached individually and parsed in
+/// parallel (see GenOptions).  Classes found in several sources are emitted
+/// once, as generated from the first of those sources.  Spreads the generated
+/// code over all of \p outc (see Generated::emit()).  Return value is the
+/// same, except that 2 is also returned when some of opts.roots or the
+/// templates of opts.instances aren't found.
+int genTests(const clang::tooling::CompilationDatabase &db,
+             const std::vector<std::string> &sources, const GenOptions &opts,
+             llvm::raw_ostream &outh,
+             llvm::ArrayRef<llvm::raw_ostream *> outc,
+             llvm::raw_ostream &errs);
+
+/// Generates code for the classes defined in \p src into \p code, parsing
+/// src with a ClangTool built from \p db.  Fills \p deps with the absolute
+/// names of all files read in the process, including src, each mapped to the
+/// digest (see GenCache::digest()) of the contents that were read.  Doesn't
+/// use any cache.  Returns the result of ClangTool::run().
+int genSource(const clang::tooling::CompilationDatabase &db,
+              const std::string &src, SourceCode &code,
+              std::map<std::string, std::string> &deps,
+              const Weights &weights = Weights());
+
+/// The last step of genTests() above: prunes \p gen as \p opts say and emits
+/// it.  Returns 2 if some classes or templates are missing, otherwise 0.
+int emitTests(Generated &gen, const std::vector<std::string> &sources,
+              const GenOptions &opts, llvm::raw_ostream &outh,
+              llvm::ArrayRef<llvm::raw_ostream *> outc,
+              llvm::raw_ostream &errs);
 } // anonymous namespace
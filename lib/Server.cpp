@@ -0,0 +1,240 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Server.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "RamFuzz.hpp"
+#include "llvm/Support/Path.h"
+
+using namespace ramfuzz;
+using namespace std;
+
+using clang::tooling::CompilationDatabase;
+
+namespace {
+
+volatile sig_atomic_t interrupted = 0;
+
+void interrupt(int) { interrupted = 1; }
+
+/// Sends all of \p s to socket \p fd, as far as possible.
+void send_all(int fd, const string &s) {
+  for (size_t done = 0; done < s.size();) {
+    const auto n = send(fd, s.data() + done, s.size() - done, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return;
+    done += n;
+  }
+}
+
+/// Reads one line from socket \p fd, without the newline.
+string receive_line(int fd) {
+  string line;
+  char c;
+  while (line.size() < 256) {
+    const auto n = recv(fd, &c, 1, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0 || c == '\n')
+      break;
+    line += c;
+  }
+  if (!line.empty() && line.back() == '\r')
+    line.pop_back();
+  return line;
+}
+
+} // anonymous namespace
+
+namespace ramfuzz {
+
+Server::Server(const CompilationDatabase &db, vector<string> names,
+               Output output, Weights weights)
+    : db(db), output(move(output)), weights(move(weights)) {
+  for (auto &n : names) {
+    sources.emplace_back();
+    sources.back().name = move(n);
+  }
+}
+
+Server::~Server() {
+  if (inotify >= 0)
+    close(inotify);
+  if (listener >= 0)
+    close(listener);
+}
+
+int Server::run(const string &path) {
+#ifdef __linux__
+  inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+  if (inotify < 0) {
+    llvm::errs() << "Cannot watch files for changes\n";
+    return 1;
+  }
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    llvm::errs() << "Socket name too long: " << path << '\n';
+    return 1;
+  }
+  strcpy(addr.sun_path, path.c_str());
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(path.c_str());
+  if (listener < 0 ||
+      bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) ||
+      listen(listener, 16)) {
+    llvm::errs() << "Cannot listen on " << path << ": " << strerror(errno)
+                 << '\n';
+    return 1;
+  }
+  signal(SIGINT, interrupt);
+  signal(SIGTERM, interrupt);
+  regenerate();
+  for (bool quit = false; !quit && !interrupted;) {
+    pollfd fds[] = {{listener, POLLIN, 0}, {inotify, POLLIN, 0}};
+    // Editors and checkouts often change several files in a row, so wait for
+    // a quiet moment before regenerating.
+    const int n = poll(fds, 2, dirty() ? settle_ms : -1);
+    if (n < 0 && errno != EINTR)
+      break;
+    if (n == 0)
+      regenerate();
+    if (n <= 0)
+      continue;
+    if (fds[1].revents & POLLIN)
+      drain_events();
+    if (fds[0].revents & POLLIN)
+      quit = serve_one();
+  }
+  unlink(path.c_str());
+  return 0;
+}
+
+bool Server::serve_one() {
+  const int fd = accept(listener, nullptr, nullptr);
+  if (fd < 0)
+    return false;
+  // Don't let a stuck client hang the daemon.
+  timeval timeout{1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  const auto request = receive_line(fd);
+  bool quit = false;
+  if (request == "generate") {
+    drain_events();
+    if (dirty())
+      regenerate();
+    send_all(fd, to_string(status) + "\n" + messages);
+  } else if (request == "status") {
+    send_all(fd, to_string(status) + "\n" + messages);
+  } else if (request == "quit") {
+    send_all(fd, "0\n");
+    quit = true;
+  } else {
+    send_all(fd, "1\nUnknown request: " + request + "\n");
+  }
+  close(fd);
+  return quit;
+}
+
+void Server::regenerate() {
+  bool run_error = false;
+  for (auto &s : sources) {
+    if (s.dirty) {
+      // Watch the known dependencies first, so that changes made during
+      // parsing aren't missed.
+      for (const auto &d : s.deps)
+        watch(d.first);
+      s.code = SourceCode();
+      s.run_error = genSource(db, s.name, s.code, s.deps, weights);
+      s.dirty = false;
+      for (const auto &d : s.deps)
+        watch(d.first);
+    }
+    run_error |= s.run_error;
+  }
+  Generated gen;
+  for (const auto &s : sources)
+    gen.add(s.code);
+  messages.clear();
+  llvm::raw_string_ostream errs(messages);
+  const int emitted = output(gen, run_error ? llvm::nulls() : errs);
+  errs.flush();
+  status = run_error ? 1 : emitted;
+  llvm::errs() << messages;
+}
+
+void Server::drain_events() {
+#ifdef __linux__
+  alignas(inotify_event) char buf[4096];
+  for (ssize_t len; (len = read(inotify, buf, sizeof(buf))) > 0;) {
+    for (auto p = buf; p < buf + len;) {
+      const auto ev = reinterpret_cast<const inotify_event *>(p);
+      p += sizeof(inotify_event) + ev->len;
+      if (ev->mask & IN_Q_OVERFLOW) {
+        for (auto &s : sources)
+          s.dirty = true;
+        continue;
+      }
+      const auto dir = watched.find(ev->wd);
+      if (dir == watched.end() || !ev->len)
+        continue;
+      const auto file = dir->second + "/" + ev->name;
+      for (auto &s : sources)
+        if (s.deps.count(file))
+          s.dirty = true;
+    }
+  }
+#endif
+}
+
+void Server::watch(const string &file) {
+#ifdef __linux__
+  // Watch directories rather than files, because editors often replace a file
+  // instead of writing into it.
+  const auto dir = llvm::sys::path::parent_path(file).str();
+  if (dir.empty() || !watched_dirs.insert(dir).second)
+    return;
+  const int wd =
+      inotify_add_watch(inotify, dir.c_str(),
+                        IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                            IN_MOVED_TO);
+  if (wd >= 0)
+    watched[wd] = dir;
+#endif
+}
+
+bool Server::dirty() const {
+  for (const auto &s : sources)
+    if (s.dirty)
+      return true;
+  return false;
+}
+
+} // namespace ramfuzz
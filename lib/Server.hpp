@@ -0,0 +1,115 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file The generator daemon behind `ramfuzz --serve`.
+///
+/// Running ramfuzz from scratch means starting Clang and parsing every input
+/// file with all its #includes.  The daemon instead keeps the code generated
+/// from each input file in memory and watches (via inotify) all files each
+/// input file's parse read.  When any of them change, it parses only the
+/// affected input files again and re-emits the output.
+///
+/// Clients talk to the daemon over a Unix-domain socket, sending one request
+/// line per connection:
+///
+/// generate: waits until the output is up to date, then replies with the exit
+///           status ramfuzz would have had on the first line, followed by any
+///           error messages about the generated code.
+/// status:   replies like generate, but without checking for changes.
+/// quit:     replies with status 0 and stops the daemon.
+///
+/// The daemon also regenerates on its own shortly after files change, so the
+/// output is usually up to date before anyone asks.
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Generated.hpp"
+#include "RamFuzz.hpp"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace ramfuzz {
+
+class Server {
+public:
+  /// Emits \p gen and writes the output files.  Returns the exit status
+  /// ramfuzz would have (see main.cpp), writing error messages to \p errs.
+  using Output = std::function<int(Generated &gen, llvm::raw_ostream &errs)>;
+
+  /// Prepares to serve the code generated from \p sources, parsed with
+  /// commands from \p db and weighted by \p weights, by passing it to \p
+  /// output.
+  Server(const clang::tooling::CompilationDatabase &db,
+         std::vector<std::string> sources, Output output,
+         Weights weights = Weights());
+
+  ~Server();
+
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+
+  /// Generates the output, then serves requests on the Unix-domain socket
+  /// named \p path until asked to quit or interrupted by a signal.  Returns 0
+  /// after quitting and 1 if the socket or the file watch can't be set up.
+  int run(const std::string &path);
+
+  /// How long to wait for file changes to settle before regenerating.
+  static constexpr int settle_ms = 100;
+
+private:
+  /// An input file and what was generated from it.
+  struct Source {
+    std::string name;
+    SourceCode code;
+    /// Absolute names of all files read, with digests of their contents.
+    std::map<std::string, std::string> deps;
+    bool run_error = false; ///< Parsing failed.
+    bool dirty = true;      ///< Must be parsed again.
+  };
+
+  /// Parses all dirty sources again and writes the output.
+  void regenerate();
+
+  /// Marks dirty all sources affected by the file changes reported so far.
+  void drain_events();
+
+  /// Makes sure changes to \p file will be reported.
+  void watch(const std::string &file);
+
+  /// True iff some source is dirty.
+  bool dirty() const;
+
+  /// Accepts a connection and answers its request.  Returns true iff the
+  /// request was to quit.
+  bool serve_one();
+
+  const clang::tooling::CompilationDatabase &db;
+  std::vector<Source> sources;
+  Output output;
+  Weights weights;
+  int status = 0;                     ///< Of the latest output.
+  std::string messages;               ///< Of the latest output.
+  int inotify = -1;                   ///< inotify instance.
+  int listener = -1;                  ///< Listening socket.
+  std::map<int, std::string> watched; ///< Directory of each watch.
+  std::set<std::string> watched_dirs; ///< All directories in watched.
+};
+
+} // namespace ramfuzz
@@ -14,8 +14,10 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 
+#include "ClassDetails.hpp"
 #include "clang/AST/Decl.h"
 #include "clang/AST/DeclCXX.h"
 #include "clang/AST/DeclTemplate.h"
@@ -50,56 +52,6 @@ private:
   unsigned watermark = 0;
 };
 
-/// Keeps class details permanently, even after AST is deleted.  Has enough
-/// information to allow various ways of referencing the class in generated
-/// code.  Examples:
-/// - a simple class A is referenced by just its name (if visible)
-/// - a class in a namespace is referenced by its qualified name
-/// - a class template is referenced by its name and template parameters, eg:
-///   A<T1, T2>. But this requires a preamble like `template<class T1, class
-///   T2>` somewhere before the reference.
-class ClassDetails {
-public:
-  ClassDetails() = default;
-
-  /// Parameters needn't survive past this constructor.
-  explicit ClassDetails(const clang::CXXRecordDecl &, NameGetter &);
-
-  /// The class's fully qualified name.  Meant to uniquely identify this object.
-  const std::string &qname() const { return qname_; };
-
-  /// Unqualified class name.
-  const std::string &name() const { return name_; };
-
-  /// Template preamble, eg, `template<typename T1, int n>`.  Empty if the class
-  /// is not a template.
-  const std::string &tpreamble() const { return prefix_; }
-
-  /// Template parameters, eg, `<T1, n>`.  Empty if the class is not a template.
-  const std::string &tparams() const { return suffix_; }
-
-  bool operator<(const ClassDetails &that) const {
-    return this->qname_ < that.qname_;
-  }
-
-  ClassDetails &operator=(const ClassDetails &that) = default;
-
-  bool is_template() const { return is_template_; }
-
-  bool is_visible() const { return is_visible_; }
-
-private:
-  std::string name_, qname_, prefix_, suffix_;
-  bool is_template_; ///< True iff this is a class template.
-  ///< True iff this class is visible from the outermost scope.
-  bool is_visible_;
-};
-
-inline llvm::raw_ostream &operator<<(llvm::raw_ostream &os,
-                                     const ClassDetails &cd) {
-  return os << cd.qname() << cd.tparams();
-}
-
 /// Default template parameter name.
 constexpr char default_typename[] = "ramfuzz_typename_placeholder";
 
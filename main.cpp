@@ -26,6 +26,40 @@
 /// and fuzz.hpp #includes each of the input files to access the class
 /// declarations in the generated code.
 ///
+/// With --cache=<dir>, ramfuzz remembers the code generated from each input
+/// file in directory <dir> and reuses it as long as the file, the headers it
+/// #includes, the clang options, and the ramfuzz executable are unchanged.  So
+/// rerunning ramfuzz after a small change only parses the affected input
+/// files.  Either way, fuzz.hpp and fuzz.cpp are rewritten only if their
+/// contents change, which keeps the build from recompiling them needlessly.
+///
+/// With --shards=<n> (n > 1), the definitions are spread over files
+/// fuzz-0.cpp, ..., fuzz-<n-1>.cpp instead of fuzz.cpp, so they can be compiled
+/// in parallel.  Each class always lands in the same file for a given n, so
+/// changing one class recompiles only its file.  The names of these files are
+/// listed, one per line, in fuzz.shards for the build system to read.  Files
+/// left over from a previous run with a larger n are removed.
+///
+/// With -j<n>, up to n input files are parsed at the same time, each in a
+/// separate process.  The output is the same as without -j.
+///
+/// By default, ramfuzz generates a harness for every class in the input files.
+/// With --root=<class> (repeatable) or --include=<regex>, it generates only
+/// the harnesses needed to make the named classes (and the classes whose
+/// qualified names match the regex): theirs, those of the classes they use,
+/// and those of their subclasses, transitively.  With --exclude=<regex>,
+/// matching classes aren't used as roots or subclasses; they still get
+/// harnesses if other harnesses need them.  Without --root or --include, all
+/// other classes are roots.  A --root that isn't found in the input files is
+/// reported like a missing class (exit code 2, see below).
+///
+/// With --serve=<socket>, ramfuzz generates the output and then keeps running
+/// as a daemon: whenever an input file or a header it #includes changes, it
+/// parses the affected input files again and rewrites the output.  Clients
+/// can ask it to bring the output up to date, report its status, or quit via
+/// the Unix-domain socket <socket>; see lib/Server.hpp for the protocol.  The
+/// daemon ignores --cache and -j.
+///
 /// After the "--" argument, ramfuzz takes clang options necessary to parse the
 /// input files.  These typically include -I, -std, and -xc++ (to force .h files
 /// to be treated as C++ instead of C).
@@ -60,24 +94,37 @@
 /// 2 if Foo's definition exists but is #included.  The remedy is to add Foo's
 /// header to the list of ramfuzz input files.
 
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
 #include <iostream>
-#include <system_error>
+#include <memory>
+#include <string>
+#include <vector>
 
+#include "lib/GenCache.hpp"
+#include "lib/Generated.hpp"
 #include "lib/RamFuzz.hpp"
+#include "lib/Server.hpp"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Regex.h"
 
-using clang::tooling::ClangTool;
 using clang::tooling::CommonOptionsParser;
 using llvm::cl::OptionCategory;
+using llvm::cl::cat;
+using llvm::cl::desc;
 using llvm::cl::extrahelp;
-using llvm::raw_fd_ostream;
-using llvm::sys::fs::OpenFlags;
+using llvm::cl::opt;
+using llvm::cl::value_desc;
+using llvm::raw_string_ostream;
 using std::cerr;
 using std::endl;
-using std::error_code;
+using std::string;
 
 // Apply a custom category to all command-line options so that they are the
 // only ones displayed.
@@ -88,30 +135,157 @@ static OptionCategory MyToolCategory("ramfuzz options");
 // It's nice to have this help message in all tools.
 static extrahelp CommonHelp(CommonOptionsParser::HelpMessage);
 
+static opt<string> CacheDir("cache",
+                            desc("Reuse code generated by previous runs"),
+                            value_desc("directory"), cat(MyToolCategory));
+
+static opt<unsigned>
+    Shards("shards", desc("Split definitions into this many .cpp files"),
+           value_desc("n"), llvm::cl::init(1), cat(MyToolCategory));
+
+static opt<unsigned>
+    Jobs("j", desc("How many input files to parse in parallel"),
+         value_desc("n"), llvm::cl::init(1), cat(MyToolCategory));
+
+static llvm::cl::list<string>
+    Roots("root", desc("Only generate harnesses this class needs"),
+          value_desc("class"), cat(MyToolCategory));
+
+static opt<string>
+    Include("include", desc("Like --root, for all classes matching a regex"),
+            value_desc("regex"), cat(MyToolCategory));
+
+static opt<string>
+    Exclude("exclude", desc("Don't use classes matching a regex as roots or "
+                            "subclasses"),
+            value_desc("regex"), cat(MyToolCategory));
+
+static opt<string> WeightsFile("weights",
+                               desc("Spin harness methods as often as this "
+                                    "file says"),
+                               value_desc("file"), cat(MyToolCategory));
+
+static llvm::cl::list<string>
+    Instances("instantiate",
+              desc("Instantiate this template specialization's harness once, "
+                   "in the generated .cpp"),
+              value_desc("type"), cat(MyToolCategory));
+
+static opt<string>
+    Serve("serve", desc("Run as a daemon, regenerating when inputs change"),
+          value_desc("socket"), cat(MyToolCategory));
+
 static extrahelp RamFuzzHelp(R"(
 Generates test code that creates random instances of classes defined in input
 files.  This is useful for unit tests that wish to fuzz parameter values for
 code under test.  Parameter fuzzing = ramfuzz.
 
 Outputs fuzz.hpp and fuzz.cpp with the declarations and definitions of test
-code.
+code.  With --shards, outputs fuzz-0.cpp, fuzz-1.cpp, ... instead of fuzz.cpp,
+and lists them in fuzz.shards.
 )");
 
+/// Any function in this executable, for finding the executable's file.
+static void anchor() {}
+
+/// Writes content into file fname if it differs from the file's current
+/// contents.  Returns false on failure.
+static bool output(const string &fname, const string &content) {
+  if (ramfuzz::write_if_changed(fname, content))
+    return true;
+  cerr << "Cannot write " << fname << endl;
+  return false;
+}
+
+/// Names of the files listed in the shard manifest \p fname.
+static std::vector<string> manifest(const string &fname) {
+  std::vector<string> names;
+  std::ifstream f(fname);
+  for (string line; std::getline(f, line);)
+    if (!line.empty())
+      names.push_back(line);
+  return names;
+}
+
+/// Writes the output files, generating their contents by gen(outh, outc),
+/// where outc has a stream for each shard.  Returns gen's result, or 1 if an
+/// output file can't be written.
+static int write_outputs(
+    const std::function<int(llvm::raw_ostream &outh,
+                            llvm::ArrayRef<llvm::raw_ostream *> outc)> &gen) {
+  const unsigned shards = Shards > 1 ? Shards : 1;
+  std::vector<string> cnames;
+  if (shards == 1)
+    cnames.push_back("fuzz.cpp");
+  else
+    for (unsigned i = 0; i < shards; ++i)
+      cnames.push_back("fuzz-" + std::to_string(i) + ".cpp");
+  string h;
+  raw_string_ostream outh(h);
+  std::vector<string> cs(shards);
+  std::vector<std::unique_ptr<raw_string_ostream>> outcs;
+  std::vector<llvm::raw_ostream *> outc;
+  for (auto &c : cs) {
+    outcs.emplace_back(new raw_string_ostream(c));
+    outc.push_back(outcs.back().get());
+    *outc.back() << "#include \"fuzz.hpp\"\n";
+  }
+  const int status = gen(outh, outc);
+  if (!output("fuzz.hpp", outh.str()))
+    return 1;
+  for (unsigned i = 0; i < shards; ++i)
+    if (!output(cnames[i], outcs[i]->str()))
+      return 1;
+  if (shards > 1) {
+    for (const auto &old : manifest("fuzz.shards"))
+      if (std::find(cnames.cbegin(), cnames.cend(), old) == cnames.cend())
+        llvm::sys::fs::remove(old);
+    string m;
+    for (const auto &n : cnames)
+      m += n + "\n";
+    if (!output("fuzz.shards", m))
+      return 1;
+  }
+  return status;
+}
+
 int main(int argc, const char **argv) {
   CommonOptionsParser OptionsParser(argc, argv, MyToolCategory);
-  const auto &sources = OptionsParser.getSourcePathList();
-  ClangTool Tool(OptionsParser.getCompilations(), sources);
-  error_code ec;
-  raw_fd_ostream outh("fuzz.hpp", ec, OpenFlags::F_Text);
-  if (ec) {
-    cerr << "Cannot open fuzz.hpp: " << ec.message() << endl;
-    return 1;
+  ramfuzz::GenOptions opts;
+  opts.cachedir = CacheDir;
+  if (!opts.cachedir.empty())
+    opts.generator = ramfuzz::GenCache::digest(
+        llvm::sys::fs::getMainExecutable(argv[0], (void *)(intptr_t)anchor));
+  opts.jobs = Jobs;
+  opts.roots = Roots;
+  opts.include = Include;
+  opts.exclude = Exclude;
+  opts.instances = Instances;
+  for (const auto &re : {opts.include, opts.exclude}) {
+    string error;
+    if (!llvm::Regex(re).isValid(error)) {
+      cerr << "Invalid regex " << re << ": " << error << endl;
+      return 1;
+    }
   }
-  raw_fd_ostream outc("fuzz.cpp", ec, OpenFlags::F_Text);
-  if (ec) {
-    cerr << "Cannot open fuzz.cpp: " << ec.message() << endl;
+  if (!WeightsFile.empty() &&
+      !ramfuzz::readWeights(WeightsFile, opts.weights, llvm::errs()))
     return 1;
+  const auto &db = OptionsParser.getCompilations();
+  const auto &sources = OptionsParser.getSourcePathList();
+  if (!Serve.empty()) {
+    ramfuzz::Server server(
+        db, sources, [&](ramfuzz::Generated &gen, llvm::raw_ostream &errs) {
+          return write_outputs([&](llvm::raw_ostream &outh,
+                                   llvm::ArrayRef<llvm::raw_ostream *> outc) {
+            return ramfuzz::emitTests(gen, sources, opts, outh, outc, errs);
+          });
+        },
+        opts.weights);
+    return server.run(Serve);
   }
-  outc << "#include \"fuzz.hpp\"\n";
-  return ramfuzz::genTests(Tool, sources, outh, outc, llvm::errs());
+  return write_outputs(
+      [&](llvm::raw_ostream &outh, llvm::ArrayRef<llvm::raw_ostream *> outc) {
+        return ramfuzz::genTests(db, sources, opts, outh, outc, llvm::errs());
+      });
 }
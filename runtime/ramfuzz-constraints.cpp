@@ -0,0 +1,79 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ramfuzz-constraints.hpp"
+
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+using std::ifstream;
+using std::isdigit;
+using std::istringstream;
+using std::numeric_limits;
+using std::ofstream;
+using std::setprecision;
+using std::string;
+using std::to_string;
+
+namespace ramfuzz {
+namespace runtime {
+
+void constraints::load(const string &fname) {
+  ifstream f(fname);
+  if (!f)
+    throw file_error("Cannot open " + fname);
+  auto res = ranges;
+  unsigned lineno = 0;
+  for (string line; getline(f, line);) {
+    ++lineno;
+    istringstream is(line);
+    string first;
+    if (!(is >> first) || first[0] == '#')
+      continue;
+    istringstream locs(first);
+    size_t loc;
+    range r{0, 0, 1};
+    bool ok = isdigit(static_cast<unsigned char>(first[0])) && locs >> loc &&
+              locs.eof() && is >> r.lo >> r.hi;
+    double weight;
+    if (ok && is >> weight)
+      r.weight = weight;
+    else
+      ok = ok && is.eof(); // Weight omitted.
+    string extra;
+    if (!ok || is >> extra || !(r.lo <= r.hi) || !(r.weight >= 0))
+      throw file_error(fname + ":" + to_string(lineno) +
+                       ": expected <location> <lo> <hi> [<weight>]");
+    res[loc].push_back(r);
+  }
+  ranges.swap(res);
+}
+
+void constraints::save(const string &fname) const {
+  ofstream f(fname);
+  if (!f)
+    throw file_error("Cannot open " + fname);
+  f << setprecision(numeric_limits<double>::max_digits10);
+  for (const auto &l : ranges)
+    for (const auto &r : l.second)
+      f << l.first << ' ' << r.lo << ' ' << r.hi << ' ' << r.weight << '\n';
+  if (!f)
+    throw file_error("Cannot write " + fname);
+}
+
+} // namespace runtime
+} // namespace ramfuzz
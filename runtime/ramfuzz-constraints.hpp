@@ -0,0 +1,84 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file Per-location constraints that guide value generation.
+///
+/// Tools that learn which values make tests valid (see ../sci/ramfuzz.md) can
+/// hand their knowledge back to gen as a constraints file.  For each location
+/// ID, the file lists ranges of values to generate there, with relative
+/// weights; a preferred value is simply a range with lo equal to hi.  When gen
+/// generates a value at a constrained location, it picks one of the ranges
+/// overlapping the requested bounds (by weight) and generates a value in it.
+/// The value is logged as usual, so replay doesn't need the constraints.
+///
+/// The file is text, one range per line:
+///
+///   <location> <lo> <hi> [<weight>]
+///
+/// The weight defaults to 1.  Blank lines and lines starting with '#' are
+/// ignored.  Like ramfuzz-log.hpp, this doesn't depend on libunwind.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ramfuzz-log.hpp"
+
+namespace ramfuzz {
+namespace runtime {
+
+/// Allowed ranges of generated values, by location.
+class constraints {
+public:
+  /// Values from lo to hi, inclusive, chosen weight times as often as a range
+  /// of weight 1 at the same location.
+  struct range {
+    double lo, hi, weight;
+  };
+
+  /// Adds a range at location \p loc.
+  void add(size_t loc, double lo, double hi, double weight = 1.) {
+    ranges[loc].push_back(range{lo, hi, weight});
+  }
+
+  /// The ranges at location \p loc, or null if loc is unconstrained.
+  const std::vector<range> *at(size_t loc) const {
+    const auto found = ranges.find(loc);
+    return found == ranges.end() ? nullptr : &found->second;
+  }
+
+  bool empty() const { return ranges.empty(); }
+
+  /// All constrained locations and their ranges.
+  const std::unordered_map<size_t, std::vector<range>> &all() const {
+    return ranges;
+  }
+
+  /// Adds the ranges in file \p fname.  Throws file_error if the file can't be
+  /// read or has a malformed line, leaving *this unchanged.
+  void load(const std::string &fname);
+
+  /// Writes all ranges into file \p fname in the format load() reads.  Throws
+  /// file_error on failure.
+  void save(const std::string &fname) const;
+
+private:
+  std::unordered_map<size_t, std::vector<range>> ranges;
+};
+
+} // namespace runtime
+} // namespace ramfuzz
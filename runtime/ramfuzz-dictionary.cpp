@@ -0,0 +1,88 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ramfuzz-dictionary.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+using std::ifstream;
+using std::isdigit;
+using std::istringstream;
+using std::string;
+using std::to_string;
+using std::vector;
+
+namespace {
+
+/// The type tag whose type_name() is \p name, or -1 if there's none.
+int tag_named(const string &name) {
+  for (int tag = 0; ramfuzz::runtime::valsize(tag); ++tag)
+    if (name == ramfuzz::runtime::type_name(tag))
+      return tag;
+  return -1;
+}
+
+} // anonymous namespace
+
+namespace ramfuzz {
+namespace runtime {
+
+constexpr char dictionary::any_type;
+
+void dictionary::load(const string &fname) {
+  ifstream f(fname);
+  if (!f)
+    throw file_error("Cannot open " + fname);
+  auto res = *this;
+  unsigned lineno = 0;
+  for (string line; getline(f, line);) {
+    ++lineno;
+    istringstream is(line);
+    vector<string> words;
+    for (string w; is >> w;)
+      words.push_back(w);
+    if (words.empty() || words[0][0] == '#')
+      continue;
+    // The value is the last word; everything before it names where it goes.
+    string where = words[0];
+    for (size_t i = 1; i + 1 < words.size(); ++i)
+      where += ' ' + words[i];
+    // strtod(), unlike operator>>, reads "nan" and "inf".
+    const char *const text = words.back().c_str();
+    char *end;
+    const double value = std::strtod(text, &end);
+    const bool ok = words.size() > 1 && end != text && !*end;
+    istringstream locs(where);
+    size_t loc;
+    int tag;
+    if (ok && where == "*")
+      res.add(any_type, value);
+    else if (ok && isdigit(static_cast<unsigned char>(where[0])) &&
+             locs >> loc && locs.eof())
+      res.add_at(loc, value);
+    else if (ok && (tag = tag_named(where)) >= 0)
+      res.add(char(tag), value);
+    else
+      throw file_error(fname + ":" + to_string(lineno) +
+                       ": expected <location>, <type>, or * followed by "
+                       "<value>");
+  }
+  *this = std::move(res);
+}
+
+} // namespace runtime
+} // namespace ramfuzz
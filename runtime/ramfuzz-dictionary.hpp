@@ -0,0 +1,146 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file Interesting values that gen mixes into the values it generates.
+///
+/// Drawn uniformly from their type's whole range, numbers like 0, -1, powers of
+/// two, the type's limits, or NaN practically never come up, yet they're where
+/// code under test most often breaks.  So when gen makes a number (see
+/// gen::interesting()), it sometimes picks one from a dictionary instead: the
+/// values built into RamFuzz for the number's type (builtin_values() below),
+/// the values the user added for that type, or those added for the number's
+/// location.  The value is logged as usual, so replay doesn't need the
+/// dictionary.
+///
+/// Dictionary files are text, one value per line:
+///
+///   <location> <value>
+///   <type> <value>
+///   * <value>
+///
+/// where <type> is a name type_name() returns (eg, "unsigned long") and '*'
+/// means all types.  Values are read as doubles, so "nan" and "-inf" work, but
+/// integers beyond 2^53 may be rounded.  Blank lines and lines starting with
+/// '#' are ignored.  Like ramfuzz-log.hpp, this doesn't depend on libunwind.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "ramfuzz-log.hpp"
+
+namespace ramfuzz {
+namespace runtime {
+
+/// User-supplied interesting values, by type tag and by location.
+class dictionary {
+public:
+  /// Pseudo type tag for values of all types.
+  static constexpr char any_type = -1;
+
+  /// Adds \p value for the type with tag \p tag (see typetag() in
+  /// ramfuzz-rt.hpp), or for all types if tag is any_type.
+  void add(char tag, double value) { bytype[tag].push_back(value); }
+
+  /// Adds \p value at location \p loc.
+  void add_at(size_t loc, double value) { byloc[loc].push_back(value); }
+
+  /// The values for type tag \p tag, or null if there are none.  Values for
+  /// all types aren't included; they're under any_type.
+  const std::vector<double> *of_type(char tag) const {
+    const auto found = bytype.find(tag);
+    return found == bytype.end() ? nullptr : &found->second;
+  }
+
+  /// The values at location \p loc, or null if there are none.
+  const std::vector<double> *at(size_t loc) const {
+    const auto found = byloc.find(loc);
+    return found == byloc.end() ? nullptr : &found->second;
+  }
+
+  bool empty() const { return bytype.empty() && byloc.empty(); }
+
+  /// All values by type tag.
+  const std::unordered_map<char, std::vector<double>> &types() const {
+    return bytype;
+  }
+
+  /// All values by location.
+  const std::unordered_map<size_t, std::vector<double>> &locations() const {
+    return byloc;
+  }
+
+  /// Adds the values in file \p fname.  Throws file_error if the file can't be
+  /// read or has a malformed line, leaving *this unchanged.
+  void load(const std::string &fname);
+
+private:
+  std::unordered_map<char, std::vector<double>> bytype;
+  std::unordered_map<size_t, std::vector<double>> byloc;
+};
+
+/// Values of integral type T worth trying in any test: 0, 1, -1, T's limits
+/// and their neighbours, and the powers of two, each also minus one and
+/// negated.  Empty for bool, which has no interesting values to add.
+template <typename T>
+const typename std::enable_if<std::is_integral<T>::value,
+                              std::vector<T>>::type &
+builtin_values() {
+  static const auto values = [] {
+    using lim = std::numeric_limits<T>;
+    std::vector<T> v;
+    if (std::is_same<T, bool>::value)
+      return v;
+    v = {T(0), T(1), lim::min(), T(lim::min() + 1), lim::max(),
+         T(lim::max() - 1)};
+    if (lim::is_signed)
+      v.push_back(T(-1));
+    for (int k = 1; k < lim::digits; ++k) {
+      const auto p = T(T(1) << k);
+      v.push_back(p);
+      v.push_back(T(p - 1));
+      if (lim::is_signed)
+        v.push_back(T(-p));
+    }
+    std::sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+    return v;
+  }();
+  return values;
+}
+
+/// Values of floating-point type T worth trying in any test: signed zeros and
+/// ones, halves, T's limits, the smallest normal and denormal values, epsilon,
+/// infinities, and NaN.
+template <typename T>
+const typename std::enable_if<std::is_floating_point<T>::value,
+                              std::vector<T>>::type &
+builtin_values() {
+  using lim = std::numeric_limits<T>;
+  static const std::vector<T> values = {
+      T(0),       -T(0),         T(1),           T(-1),
+      T(.5),      T(-.5),        lim::min(),     -lim::min(),
+      lim::max(), lim::lowest(), lim::epsilon(), lim::denorm_min(),
+      lim::infinity(), -lim::infinity(), lim::quiet_NaN()};
+  return values;
+}
+
+} // namespace runtime
+} // namespace ramfuzz
@@ -0,0 +1,169 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ramfuzz-linear.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+
+using std::fabs;
+using std::map;
+using std::max;
+using std::min;
+using std::move;
+using std::numeric_limits;
+using std::vector;
+
+namespace {
+
+using row = ramfuzz::runtime::linear_system::row;
+
+/// Coefficients this small relative to the row's largest are rounding noise
+/// left over from elimination.
+constexpr double epsilon = 1e-12;
+
+/// Accumulates inequalities, keeping only the tightest of parallel ones and
+/// dropping those that always hold.
+class pruner {
+public:
+  explicit pruner(size_t max_rows) : max_rows(max_rows) {}
+
+  /// Adds r, unless the limit on distinct inequalities has been reached.
+  void add(row r) {
+    double m = 0;
+    for (const auto x : r.w)
+      m = max(m, fabs(x));
+    if (m == 0 && r.b >= 0)
+      return; // Always holds.
+    if (m != 0) {
+      for (auto &x : r.w)
+        x = fabs(x) < epsilon * m ? 0 : x / m;
+      r.b /= m;
+    }
+    const auto found = tightest.find(r.w);
+    if (found != tightest.end())
+      found->second = min(found->second, r.b);
+    else if (tightest.size() < max_rows)
+      tightest.emplace(move(r.w), r.b);
+  }
+
+  vector<row> rows() const {
+    vector<row> res;
+    for (const auto &t : tightest)
+      res.push_back(row{t.first, t.second});
+    return res;
+  }
+
+private:
+  size_t max_rows;
+  map<vector<double>, double> tightest; ///< Coefficients to the least b.
+};
+
+/// Eliminates the last variable from rows, all of which have the same number
+/// of coefficients, and returns the pruned result.
+vector<row> eliminate(const vector<row> &rows, size_t max_rows) {
+  pruner res(max_rows);
+  vector<row> pos, neg; // Scaled so the last coefficient is 1 or -1.
+  for (auto r : rows) {
+    const auto a = r.w.back();
+    r.w.pop_back();
+    if (a == 0) {
+      res.add(move(r));
+      continue;
+    }
+    for (auto &x : r.w)
+      x /= fabs(a);
+    r.b /= fabs(a);
+    (a > 0 ? pos : neg).push_back(move(r));
+  }
+  // Each pair bounds the last variable from both sides, so the lower bound
+  // must not exceed the upper.
+  for (const auto &p : pos)
+    for (const auto &n : neg) {
+      row sum{p.w, p.b + n.b};
+      for (size_t i = 0; i < sum.w.size(); ++i)
+        sum.w[i] += n.w[i];
+      res.add(move(sum));
+    }
+  return res.rows();
+}
+
+} // anonymous namespace
+
+namespace ramfuzz {
+namespace runtime {
+
+constexpr size_t linear_system::default_max_rows;
+
+void linear_system::add(row r) {
+  r.w.resize(vars_);
+  rows.push_back(move(r));
+  projected = false;
+}
+
+bool linear_system::bounds(double &lo, double &hi) {
+  if (done())
+    return false;
+  project();
+  const auto k = next();
+  lo = -numeric_limits<double>::infinity();
+  hi = numeric_limits<double>::infinity();
+  for (const auto &r : proj[k]) {
+    const auto a = r.w[k];
+    if (a > 0)
+      lo = max(lo, -r.b / a);
+    else if (a < 0)
+      hi = min(hi, -r.b / a);
+    else if (r.b < 0)
+      return false;
+  }
+  return lo <= hi;
+}
+
+void linear_system::fix(double val) {
+  if (done())
+    return;
+  if (projected)
+    substitute(next(), val);
+  fixed.push_back(val);
+}
+
+void linear_system::project() {
+  if (projected)
+    return;
+  proj.assign(vars_, {});
+  pruner all(max_rows_);
+  for (const auto &r : rows)
+    all.add(r);
+  auto cur = all.rows();
+  for (size_t k = vars_; k-- > 0;) {
+    proj[k] = cur;
+    if (k)
+      cur = eliminate(cur, max_rows_);
+  }
+  for (size_t j = 0; j < fixed.size(); ++j)
+    substitute(j, fixed[j]);
+  projected = true;
+}
+
+void linear_system::substitute(size_t j, double val) {
+  for (size_t k = j + 1; k < vars_; ++k)
+    for (auto &r : proj[k])
+      r.b += r.w[j] * val;
+}
+
+} // namespace runtime
+} // namespace ramfuzz
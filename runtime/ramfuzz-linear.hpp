@@ -0,0 +1,107 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file Sampling values that satisfy a system of linear inequalities.
+///
+/// A model trained on RamFuzz logs (see ../ai/solver.py) can describe the
+/// values of successful runs as linear inequalities over the sequence of
+/// values a run generates: x[0] is the first value between() returns, x[1] the
+/// second, and so on.  To generate x[k], gen needs the interval of x[k] values
+/// for which the inequalities can still be satisfied, given x[0..k).
+///
+/// linear_system computes that by Fourier-Motzkin elimination.  Eliminating
+/// x[n-1], then x[n-2], etc., yields a projection of the system onto x[0..k]
+/// for each k; they are computed once, pruned of duplicate and redundant
+/// inequalities as they go.  As each value is fixed, it's substituted into the
+/// projections of the later variables, so finding the next interval only
+/// takes one pass over the next projection.  Like ramfuzz-log.hpp, this
+/// doesn't depend on libunwind.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace ramfuzz {
+namespace runtime {
+
+/// Linear inequalities over the values x[0], x[1], ... that a run generates,
+/// which are fixed one by one.
+class linear_system {
+public:
+  /// Inequality w[0]*x[0] + w[1]*x[1] + ... + b >= 0.
+  struct row {
+    std::vector<double> w;
+    double b;
+  };
+
+  /// Default cap on the size of each projection; see max_rows().
+  static constexpr size_t default_max_rows = 4096;
+
+  /// A system over variables x[0..vars), with no inequalities.
+  explicit linear_system(size_t vars = 0) : vars_(vars) {}
+
+  /// Adds inequality \p r, whose r.w has at most vars() elements (missing ones
+  /// are 0).
+  void add(row r);
+
+  size_t vars() const { return vars_; }
+
+  /// Index of the next variable to fix.
+  size_t next() const { return fixed.size(); }
+
+  /// True iff all variables are fixed.
+  bool done() const { return fixed.size() >= vars_; }
+
+  /// Puts into [lo, hi] the values of x[next()] that still let all the
+  /// inequalities hold, as far as elimination can tell; a side may be
+  /// infinite.  Returns false if no value does, or if done().
+  bool bounds(double &lo, double &hi);
+
+  /// Fixes x[next()] at \p val and moves on to the next variable.  Has no
+  /// effect if done().
+  void fix(double val);
+
+  /// Limits each projection to the first \p n inequalities (after pruning).
+  /// Dropping inequalities only widens the intervals bounds() reports, but it
+  /// keeps the elimination from blowing up combinatorially.
+  void max_rows(size_t n) {
+    max_rows_ = n;
+    projected = false;
+  }
+
+  /// The inequalities over x[0..k] that bounds() uses for x[k], with the fixed
+  /// variables already substituted into their b.
+  const std::vector<row> &projection(size_t k) {
+    project();
+    return proj[k];
+  }
+
+private:
+  /// Computes proj from rows, unless already done.
+  void project();
+
+  /// Substitutes x[j] = val into the projections of later variables.
+  void substitute(size_t j, double val);
+
+  size_t vars_;
+  std::vector<double> fixed; ///< Values of x[0..next()).
+  size_t max_rows_ = default_max_rows;
+  std::vector<row> rows;              ///< As added.
+  bool projected = false;             ///< True iff proj matches rows.
+  std::vector<std::vector<row>> proj; ///< proj[k] is over x[0..k].
+};
+
+} // namespace runtime
+} // namespace ramfuzz
@@ -0,0 +1,346 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ramfuzz-log.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+
+using std::ifstream;
+using std::ios;
+using std::istream;
+using std::min;
+using std::numeric_limits;
+using std::ofstream;
+using std::ostream;
+using std::setprecision;
+using std::string;
+using std::vector;
+
+namespace {
+
+/// Magic bytes at the beginning of every index file.
+constexpr char index_magic[4] = {'R', 'F', 'X', '1'};
+
+void put64(ofstream &f, uint64_t x) {
+  f.write(reinterpret_cast<const char *>(&x), sizeof(x));
+}
+
+bool get64(ifstream &f, uint64_t &x) {
+  return bool(f.read(reinterpret_cast<char *>(&x), sizeof(x)));
+}
+
+/// True iff \p n 64-bit words fit in what's left of \p f, which is \p size
+/// bytes long.  Guards allocations sized by counts read from the file, which
+/// may be corrupt.
+bool fits(ifstream &f, uint64_t size, uint64_t n) {
+  const auto pos = uint64_t(f.tellg());
+  return pos <= size && n <= (size - pos) / sizeof(uint64_t);
+}
+
+/// Prints a floating-point value precisely enough to be read back exactly.
+template <typename RealT> ostream &print_real(ostream &os, RealT val) {
+  const auto old = os.precision();
+  os << setprecision(numeric_limits<RealT>::max_digits10) << val;
+  os.precision(old);
+  return os;
+}
+
+/// Size of the read-ahead buffer in logreader.
+constexpr size_t bufsize = 1 << 16;
+
+} // anonymous namespace
+
+namespace ramfuzz {
+namespace runtime {
+
+// The following must match the specializations of typetag in ramfuzz-rt.cpp.
+
+size_t valsize(char tag) {
+  switch (tag) {
+  case 0:
+    return sizeof(bool);
+  case 1:
+    return sizeof(char);
+  case 2:
+    return sizeof(unsigned char);
+  case 3:
+    return sizeof(short);
+  case 4:
+    return sizeof(unsigned short);
+  case 5:
+    return sizeof(int);
+  case 6:
+    return sizeof(unsigned int);
+  case 7:
+    return sizeof(long);
+  case 8:
+    return sizeof(unsigned long);
+  case 9:
+    return sizeof(long long);
+  case 10:
+    return sizeof(unsigned long long);
+  case 11:
+    return sizeof(float);
+  case 12:
+    return sizeof(double);
+  default:
+    return 0;
+  }
+}
+
+const char *type_name(char tag) {
+  static const char *const names[] = {
+      "bool", "char", "unsigned char", "short", "unsigned short", "int",
+      "unsigned int", "long", "unsigned long", "long long",
+      "unsigned long long", "float", "double"};
+  return valsize(tag) ? names[size_t(tag)] : "unknown";
+}
+
+double logentry::value() const {
+  switch (tag) {
+  case 0:
+    return as<bool>();
+  case 1:
+    return as<char>();
+  case 2:
+    return as<unsigned char>();
+  case 3:
+    return as<short>();
+  case 4:
+    return as<unsigned short>();
+  case 5:
+    return as<int>();
+  case 6:
+    return as<unsigned int>();
+  case 7:
+    return as<long>();
+  case 8:
+    return as<unsigned long>();
+  case 9:
+    return as<long long>();
+  case 10:
+    return as<unsigned long long>();
+  case 11:
+    return as<float>();
+  case 12:
+    return as<double>();
+  default:
+    return 0.;
+  }
+}
+
+ostream &print_value(ostream &os, const logentry &e) {
+  switch (e.tag) {
+  case 0:
+    return os << int(e.as<bool>());
+  case 1:
+    return os << int(e.as<char>());
+  case 2:
+    return os << unsigned(e.as<unsigned char>());
+  case 3:
+    return os << e.as<short>();
+  case 4:
+    return os << e.as<unsigned short>();
+  case 5:
+    return os << e.as<int>();
+  case 6:
+    return os << e.as<unsigned int>();
+  case 7:
+    return os << e.as<long>();
+  case 8:
+    return os << e.as<unsigned long>();
+  case 9:
+    return os << e.as<long long>();
+  case 10:
+    return os << e.as<unsigned long long>();
+  case 11:
+    return print_real(os, e.as<float>());
+  case 12:
+    return print_real(os, e.as<double>());
+  default:
+    return os << '?';
+  }
+}
+
+void write_entry(ostream &os, const logentry &e) {
+  os.put(e.tag);
+  os.write(reinterpret_cast<const char *>(&e.bits), valsize(e.tag));
+  os.write(reinterpret_cast<const char *>(&e.loc), sizeof(e.loc));
+}
+
+bool read_entry(istream &is, logentry &e) {
+  if (!is.get(e.tag))
+    return false;
+  const auto vsz = valsize(e.tag);
+  e.bits = 0;
+  return vsz && is.read(reinterpret_cast<char *>(&e.bits), vsz) &&
+         is.read(reinterpret_cast<char *>(&e.loc), sizeof(e.loc));
+}
+
+const vector<size_t> &logindex::positions(size_t loc) const {
+  static const vector<size_t> none;
+  const auto found = postings.find(loc);
+  return found == postings.end() ? none : found->second;
+}
+
+void logindex::save(const string &fname) const {
+  ofstream f(fname, ios::binary);
+  if (!f)
+    throw file_error("Cannot open " + fname);
+  f.write(index_magic, sizeof(index_magic));
+  put64(f, stride_);
+  put64(f, entries_);
+  put64(f, logsize_);
+  put64(f, checkpoints.size());
+  for (auto off : checkpoints)
+    put64(f, off);
+  put64(f, postings.size());
+  for (const auto &p : postings) {
+    put64(f, p.first);
+    put64(f, p.second.size());
+    for (auto n : p.second)
+      put64(f, n);
+  }
+  if (!f)
+    throw file_error("Cannot write " + fname);
+}
+
+bool logindex::load(const string &fname) {
+  ifstream f(fname, ios::binary | ios::ate);
+  const uint64_t size = f.tellg();
+  f.seekg(0);
+  char magic[sizeof(index_magic)];
+  if (!f.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), index_magic))
+    return false;
+  logindex res;
+  uint64_t stride, entries, logsize, count;
+  if (!get64(f, stride) || !stride || !get64(f, entries) ||
+      !get64(f, logsize) || !get64(f, count) ||
+      count != (entries + stride - 1) / stride || !fits(f, size, count))
+    return false;
+  res.stride_ = stride;
+  res.entries_ = entries;
+  res.logsize_ = logsize;
+  res.checkpoints.resize(count);
+  for (auto &off : res.checkpoints)
+    if (!get64(f, off))
+      return false;
+  if (!get64(f, count))
+    return false;
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t loc, n;
+    if (!get64(f, loc) || !get64(f, n) || n > entries || !fits(f, size, n))
+      return false;
+    auto &pos = res.postings[loc];
+    pos.resize(n);
+    for (auto &p : pos) {
+      uint64_t x;
+      if (!get64(f, x))
+        return false;
+      p = x;
+    }
+  }
+  *this = std::move(res);
+  return true;
+}
+
+logreader::logreader(const string &logname)
+    : file(logname, ios::binary), has_index(false) {
+  if (!file)
+    throw file_error("Cannot open " + logname);
+  file.seekg(0, ios::end);
+  const uint64_t size = file.tellg();
+  file.seekg(0);
+  logindex idx;
+  if (idx.load(indexname(logname)) && idx.logsize() == size) {
+    index = std::move(idx);
+    has_index = true;
+  }
+  complete = has_index;
+}
+
+bool logreader::fill(size_t n) {
+  if (buf.size() - bufpos >= n)
+    return true;
+  buf.erase(buf.begin(), buf.begin() + bufpos);
+  bufpos = 0;
+  const auto have = buf.size();
+  buf.resize(std::max(bufsize, n));
+  file.read(&buf[have], buf.size() - have);
+  buf.resize(have + file.gcount());
+  return buf.size() >= n;
+}
+
+void logreader::jump(uint64_t off, size_t n) {
+  file.clear();
+  file.seekg(off);
+  buf.clear();
+  bufpos = 0;
+  offset = off;
+  entryno = n;
+}
+
+bool logreader::next(logentry &e) {
+  if (!fill(1))
+    return false;
+  const char tag = buf[bufpos];
+  const auto vsz = valsize(tag);
+  const auto width = 1 + vsz + sizeof(e.loc);
+  if (!vsz || !fill(width))
+    return false;
+  e.tag = tag;
+  e.bits = 0;
+  std::memcpy(&e.bits, &buf[bufpos + 1], vsz);
+  std::memcpy(&e.loc, &buf[bufpos + 1 + vsz], sizeof(e.loc));
+  // Without an index file, build the index as we go, so we can seek back.
+  if (!has_index && entryno == index.entries())
+    index.add(e.loc, offset, width);
+  bufpos += width;
+  offset += width;
+  ++entryno;
+  return true;
+}
+
+bool logreader::seek(size_t n) {
+  if (index.entries()) {
+    const auto known = min(n, index.entries() - 1);
+    const auto cp = known / index.stride() * index.stride();
+    if (n < entryno || cp > entryno)
+      jump(index.checkpoint(known), cp);
+  } else if (n < entryno)
+    jump(0, 0);
+  logentry e;
+  while (entryno < n)
+    if (!next(e)) {
+      complete = true;
+      return false;
+    }
+  return true;
+}
+
+vector<size_t> logreader::positions(size_t loc) {
+  if (!complete) {
+    const auto off = offset;
+    const auto n = entryno;
+    seek(numeric_limits<size_t>::max());
+    jump(off, n);
+  }
+  return index.positions(loc);
+}
+
+} // namespace runtime
+} // namespace ramfuzz
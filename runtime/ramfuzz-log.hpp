@@ -0,0 +1,202 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file Reading and indexing RamFuzz logs.
+///
+/// A RamFuzz log is a flat sequence of entries, each consisting of a one-byte
+/// type tag (see typetag() in ramfuzz-rt.hpp), the value's bytes, and the
+/// size_t ID of the location where the value was generated.  Because the
+/// value's width depends on its tag, entries are of varying width, and finding
+/// the Nth entry requires decoding all entries before it.  To avoid that, a log
+/// can have an index written next to it (see logindex), which logreader uses
+/// to seek quickly.
+///
+/// Unlike ramfuzz-rt.hpp, this file doesn't depend on libunwind, so tools that
+/// merely process logs can use it without linking the rest of the runtime.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ramfuzz {
+namespace runtime {
+
+/// Exception thrown when there's a file-access error.
+struct file_error : public std::runtime_error {
+  explicit file_error(const std::string &s) : runtime_error(s) {}
+  explicit file_error(const char *s) : runtime_error(s) {}
+};
+
+/// How many bytes a value with type tag \p tag occupies in the log.  Returns 0
+/// for unknown tags.
+size_t valsize(char tag);
+
+/// The C++ name of the type with tag \p tag (eg, "unsigned long").  Returns
+/// "unknown" for unknown tags.
+const char *type_name(char tag);
+
+/// A decoded log entry.
+struct logentry {
+  char tag;      ///< Value's type tag.
+  uint64_t bits; ///< Value's bytes exactly as logged, zero-extended.
+  size_t loc;    ///< ID of the location where the value was generated.
+
+  /// The value converted to double, the way ../pymod hands it to Python.
+  double value() const;
+
+  /// The value as a T, which must match tag.
+  template <typename T> T as() const {
+    T val;
+    std::memcpy(&val, &bits, sizeof(val));
+    return val;
+  }
+
+  /// Total width of this entry in the log, in bytes.
+  size_t width() const { return 1 + valsize(tag) + sizeof(loc); }
+
+  /// True iff the two entries have identical tags and value bits.  Locations
+  /// aren't compared.
+  bool same_value(const logentry &that) const {
+    return tag == that.tag && bits == that.bits;
+  }
+};
+
+/// Prints e's value in its natural C++ type (eg, integers without rounding).
+std::ostream &print_value(std::ostream &os, const logentry &e);
+
+/// Appends e to the log being written into os, exactly as gen would log it.
+void write_entry(std::ostream &os, const logentry &e);
+
+/// Reads the next entry of the log being read from is into e.  Returns false at
+/// the end of the log or if the entry is malformed.
+bool read_entry(std::istream &is, logentry &e);
+
+/// Name of the index file for the log named \p logname.
+inline std::string indexname(const std::string &logname) {
+  return logname + ".idx";
+}
+
+/// Random-access index of a RamFuzz log.  Records the byte offset of every
+/// stride-th entry and, for each location, the numbers of all entries
+/// generated there.  Entry numbers start at 0.
+///
+/// On disk, the index is a separate file (named by indexname()) so that the
+/// log itself stays readable by every existing tool.  The index remembers the
+/// log's size and is ignored by logreader if the log doesn't match it.
+class logindex {
+public:
+  static constexpr size_t default_stride = 64;
+
+  explicit logindex(size_t stride = default_stride)
+      : stride_(stride ? stride : 1) {}
+
+  /// Records the next entry, which begins at offset \p off in the log and has
+  /// location \p loc.
+  void add(size_t loc, uint64_t off, size_t width) {
+    if (entries_ % stride_ == 0)
+      checkpoints.push_back(off);
+    postings[loc].push_back(entries_++);
+    logsize_ = off + width;
+  }
+
+  /// How many entries the indexed log has.
+  size_t entries() const { return entries_; }
+
+  /// Size of the indexed log in bytes.
+  uint64_t logsize() const { return logsize_; }
+
+  size_t stride() const { return stride_; }
+
+  /// Byte offset of the last checkpoint at or before entry n, which is entry
+  /// number (n / stride()) * stride().
+  uint64_t checkpoint(size_t n) const { return checkpoints[n / stride_]; }
+
+  /// Numbers of all entries at location \p loc, in increasing order.
+  const std::vector<size_t> &positions(size_t loc) const;
+
+  /// All indexed locations and their entry numbers.
+  const std::unordered_map<size_t, std::vector<size_t>> &locations() const {
+    return postings;
+  }
+
+  /// Writes the index to file \p fname.  Throws file_error on failure.
+  void save(const std::string &fname) const;
+
+  /// Replaces *this with the index read from \p fname.  Returns false (leaving
+  /// *this unchanged) if the file can't be read or isn't a valid index.
+  bool load(const std::string &fname);
+
+private:
+  size_t stride_;
+  size_t entries_ = 0;
+  uint64_t logsize_ = 0;
+  std::vector<uint64_t> checkpoints; ///< Offsets of entries 0, stride, ...
+  std::unordered_map<size_t, std::vector<size_t>> postings;
+};
+
+/// Reads entries from a RamFuzz log.  If the log has a valid index, seek() and
+/// positions() use it; otherwise, they scan the log (and seek() remembers what
+/// it learned, so repeated seeks stay cheap).
+class logreader {
+public:
+  /// Opens the log named \p logname and its index, if one exists.  Throws
+  /// file_error if the log can't be opened.
+  explicit logreader(const std::string &logname);
+
+  /// Reads the next entry into \p e.  Returns false at the end of the log or
+  /// if the entry is malformed.
+  bool next(logentry &e);
+
+  /// Positions the reader so the next call to next() reads entry \p n.  Returns
+  /// false if the log has fewer than n entries, leaving the reader at the end.
+  bool seek(size_t n);
+
+  /// Number of the entry next() will read.
+  size_t tell() const { return entryno; }
+
+  /// Numbers of all entries at location \p loc.  Leaves the reader's position
+  /// unchanged.
+  std::vector<size_t> positions(size_t loc);
+
+  /// True iff a valid index was found for this log.
+  bool indexed() const { return has_index; }
+
+private:
+  /// Makes sure at least \p n unread bytes are in buf, if the file has them.
+  bool fill(size_t n);
+
+  /// Moves the reader to byte offset \p off, which is entry number \p n.
+  void jump(uint64_t off, size_t n);
+
+  std::ifstream file;
+  std::vector<char> buf; ///< Read-ahead buffer.
+  size_t bufpos = 0;     ///< Position of the next unread byte in buf.
+  uint64_t offset = 0;   ///< File offset of buf[bufpos].
+  size_t entryno = 0;    ///< Number of the entry at offset.
+  logindex index;        ///< Loaded from disk or built while reading.
+  bool has_index;        ///< True iff index was loaded from disk.
+  bool complete;         ///< True iff index covers the whole log.
+};
+
+} // namespace runtime
+} // namespace ramfuzz
@@ -0,0 +1,121 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ramfuzz-model.hpp"
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <utility>
+
+using std::ifstream;
+using std::isfinite;
+using std::isdigit;
+using std::istringstream;
+using std::numeric_limits;
+using std::ofstream;
+using std::setprecision;
+using std::string;
+using std::to_string;
+using std::unordered_map;
+using std::vector;
+
+namespace ramfuzz {
+namespace runtime {
+
+constexpr unsigned linear_model::default_occurrences;
+
+void linear_model::set(size_t loc, unsigned occurrence, double w) {
+  auto &ws = weights[loc];
+  const auto n = clip(occurrence);
+  if (ws.size() <= n)
+    ws.resize(n + 1);
+  ws[n] = w;
+}
+
+double linear_model::score(const vector<logentry> &log) const {
+  double s = bias_;
+  unordered_map<size_t, unsigned> seen;
+  for (const auto &e : log) {
+    const auto w = weight(e.loc, seen[e.loc]++), v = e.value();
+    if (isfinite(v))
+      s += w * v;
+  }
+  return s;
+}
+
+void linear_model::load(const string &fname) {
+  ifstream f(fname);
+  if (!f)
+    throw file_error("Cannot open " + fname);
+  linear_model res;
+  unsigned lineno = 0;
+  for (string line; getline(f, line);) {
+    ++lineno;
+    istringstream is(line);
+    string first;
+    if (!(is >> first) || first[0] == '#')
+      continue;
+    bool ok;
+    if (first == "bias") {
+      ok = bool(is >> res.bias_);
+    } else if (first == "occurrences") {
+      string count;
+      unsigned n;
+      ok = is >> count && isdigit(static_cast<unsigned char>(count[0])) &&
+           istringstream(count) >> n && n > 0;
+      if (ok)
+        res.occurrences(n);
+    } else {
+      istringstream locs(first);
+      size_t loc;
+      unsigned occurrence;
+      double w;
+      ok = isdigit(static_cast<unsigned char>(first[0])) && locs >> loc &&
+           locs.eof() && is >> occurrence >> w;
+      if (ok)
+        res.set(loc, occurrence, w);
+    }
+    string extra;
+    if (!ok || is >> extra)
+      throw file_error(fname + ":" + to_string(lineno) +
+                       ": expected bias, occurrences, or <location> "
+                       "<occurrence> <weight>");
+  }
+  *this = std::move(res);
+}
+
+void linear_model::save(const string &fname) const {
+  const auto tmp = fname + ".tmp";
+  ofstream f(tmp);
+  if (!f)
+    throw file_error("Cannot open " + tmp);
+  f << setprecision(numeric_limits<double>::max_digits10);
+  f << "bias " << bias_ << '\n';
+  f << "occurrences " << occurrences_ << '\n';
+  for (const auto &l : weights)
+    for (size_t n = 0; n < l.second.size(); ++n)
+      if (l.second[n] != 0)
+        f << l.first << ' ' << n << ' ' << l.second[n] << '\n';
+  f.close();
+  if (!f || std::rename(tmp.c_str(), fname.c_str()))
+    throw file_error("Cannot write " + fname);
+}
+
+} // namespace runtime
+} // namespace ramfuzz
@@ -0,0 +1,113 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file A linear model of run outcomes, over the values a run logs.
+///
+/// The model predicts that a run succeeds iff its score is non-negative, where
+/// the score is the model's bias plus, for every value the run logs, the value
+/// times the weight of its feature.  A value's feature is its location and its
+/// occurrence: how many values were logged at that location before it in the
+/// same run.  Occurrences past occurrences()-1 share the last occurrence's
+/// weight.  Non-finite values count as occurrences but add nothing to the
+/// score, as they carry no features in training.  Because the score is a
+/// plain sum, it can be computed as the run goes.
+///
+/// The weights are effective weights, in the sense of effective_weights() in
+/// ../ai/solver.py: they apply to raw values, with any normalization done in
+/// training already folded in.  ../tools/ramfuzz-train.cpp trains such models
+/// on a corpus.
+///
+/// The file is text.  It has a line "bias <b>", a line "occurrences <n>", and
+/// one line per nonzero weight:
+///
+///   <location> <occurrence> <weight>
+///
+/// Blank lines and lines starting with '#' are ignored.  Like ramfuzz-log.hpp,
+/// this doesn't depend on libunwind.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ramfuzz-log.hpp"
+
+namespace ramfuzz {
+namespace runtime {
+
+/// Weights of a linear model of run outcomes, by location and occurrence.
+class linear_model {
+public:
+  static constexpr unsigned default_occurrences = 16;
+
+  double bias() const { return bias_; }
+  void bias(double b) { bias_ = b; }
+
+  /// How many occurrences at each location have distinct weights.
+  unsigned occurrences() const { return occurrences_; }
+  void occurrences(unsigned n) { occurrences_ = n ? n : 1; }
+
+  /// The occurrence whose weight applies to occurrence \p n.
+  unsigned clip(unsigned n) const {
+    return n < occurrences_ ? n : occurrences_ - 1;
+  }
+
+  /// Sets the weight of the value logged at location \p loc after \p occurrence
+  /// others were logged there.
+  void set(size_t loc, unsigned occurrence, double w);
+
+  /// The weight of the value logged at location \p loc after \p occurrence
+  /// others were logged there; 0 if the model has none.
+  double weight(size_t loc, unsigned occurrence) const {
+    const auto found = weights.find(loc);
+    if (found == weights.end())
+      return 0;
+    const auto n = clip(occurrence);
+    return n < found->second.size() ? found->second[n] : 0;
+  }
+
+  /// True iff no location has a weight.
+  bool empty() const { return weights.empty(); }
+
+  /// All weights, by location and then occurrence.
+  const std::unordered_map<size_t, std::vector<double>> &all() const {
+    return weights;
+  }
+
+  /// The score of a run that logged \p log.
+  double score(const std::vector<logentry> &log) const;
+
+  /// The probability of success that score \p s stands for.
+  static double probability(double s) { return 1. / (1. + std::exp(-s)); }
+
+  /// Replaces *this with the model in file \p fname.  Throws file_error if the
+  /// file can't be read or has a malformed line, leaving *this unchanged.
+  void load(const std::string &fname);
+
+  /// Writes the model into file \p fname in the format load() reads.  The file
+  /// is replaced atomically, so processes loading it concurrently see either
+  /// the old or the new model, never a mix.  Throws file_error on failure.
+  void save(const std::string &fname) const;
+
+private:
+  double bias_ = 0;
+  unsigned occurrences_ = default_occurrences;
+  std::unordered_map<size_t, std::vector<double>> weights;
+};
+
+} // namespace runtime
+} // namespace ramfuzz
@@ -15,11 +15,19 @@
 #include "ramfuzz-rt.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cmath>
 #include <cstddef>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <unistd.h>
 
 using std::cout;
 using std::endl;
@@ -33,18 +41,31 @@ using std::ranlux24;
 using std::size_t;
 using std::streamsize;
 using std::string;
+using std::to_string;
 using std::vector;
 using std::uniform_int_distribution;
 using std::uniform_real_distribution;
 
 namespace {
 
+/// The modification time of the file described by \p st.
+const timespec &modified(const struct stat &st) {
+#ifdef __APPLE__
+  return st.st_mtimespec;
+#else
+  return st.st_mtim;
+#endif
+}
+
 template <typename IntegralT>
 IntegralT ibetween(IntegralT lo, IntegralT hi, ranlux24 &gen) {
   return uniform_int_distribution<IntegralT>{lo, hi}(gen);
 }
 
 template <typename RealT> RealT rbetween(RealT lo, RealT hi, ranlux24 &gen) {
+  // When hi-lo overflows (eg, from lowest() to max()), draw at half scale.
+  if (!std::isfinite(hi - lo))
+    return 2 * uniform_real_distribution<RealT>{lo / 2, hi / 2}(gen);
   return uniform_real_distribution<RealT>{lo, hi}(gen);
 }
 
@@ -79,15 +100,13 @@ namespace ramfuzz {
 namespace runtime {
 
 gen::gen(const string &ologname)
-    : runmode(generate), olog(ologname), base_pc(get_pc()) {
-  if (!olog)
-    throw file_error("Cannot open " + ologname);
+    : runmode(generate), ologname(ologname), base_pc(get_pc()) {
+  open_output();
 }
 
 gen::gen(const string &ilogname, const string &ologname)
-    : runmode(replay), olog(ologname), ilog(ilogname), base_pc(get_pc()) {
-  if (!olog)
-    throw file_error("Cannot open " + ologname);
+    : runmode(replay), ologname(ologname), ilog(ilogname), base_pc(get_pc()) {
+  open_output();
   if (!ilog)
     throw file_error("Cannot open " + ilogname);
 }
@@ -99,15 +118,182 @@ gen::gen(int argc, const char *const *argv, size_t k) : base_pc(get_pc()) {
     ilog.open(argstr);
     if (!ilog)
       throw file_error("Cannot open " + argstr);
-    olog.open(argstr + "+");
-    if (!olog)
-      throw file_error("Cannot open " + argstr + "+");
+    ologname = argstr + "+";
+    const char *env = getenv("RAMFUZZ_REPLAY");
+    if (env && string(env) == "location")
+      replay_by_location();
   } else {
     runmode = generate;
-    olog.open("fuzzlog");
-    if (!olog)
-      throw file_error("Cannot open fuzzlog");
+    const char *env = getenv("RAMFUZZ_LOG");
+    ologname = env && *env ? env : "fuzzlog";
+  }
+  const char *cons = getenv("RAMFUZZ_CONSTRAINTS");
+  if (cons && *cons)
+    constrain(cons);
+  const char *dict_file = getenv("RAMFUZZ_DICTIONARY");
+  if (dict_file && *dict_file)
+    interesting(dict_file);
+  const char *chance = getenv("RAMFUZZ_INTERESTING");
+  if (chance && *chance)
+    interesting_chance(std::atof(chance));
+  const char *budget_spec = getenv("RAMFUZZ_BUDGET");
+  if (budget_spec && *budget_spec)
+    limits.parse(budget_spec);
+  const char *model = getenv("RAMFUZZ_MODEL");
+  if (model && *model) {
+    const char *below = getenv("RAMFUZZ_ABORT_BELOW");
+    follow(model, below && *below ? std::atof(below) : 0.05);
+  }
+  open_output();
+}
+
+gen::~gen() {
+  olog.flush();
+  if (!oindex || oshm)
+    return;
+  ofile.close();
+  try {
+    oindex->save(indexname(ologname));
+  } catch (const file_error &) {
+    // A missing index only makes reading slower; don't throw from destructor.
+  }
+}
+
+void gen::replay_by_location() {
+  if (runmode != replay)
+    return;
+  runmode = locreplay;
+  logentry e;
+  while (read_entry(ilog, e))
+    ibyloc[e.loc].entries.push_back(e);
+}
+
+void gen::predict(linear_model m, double threshold) {
+  if (runmode != generate)
+    return;
+  model = std::move(m);
+  predicting = !model.empty() || model.bias() != 0;
+  cutoff = threshold <= 0 ? -numeric_limits<double>::infinity()
+                          : threshold >= 1
+                                ? numeric_limits<double>::infinity()
+                                : std::log(threshold / (1 - threshold));
+  score = model.bias();
+  occurrences.clear();
+}
+
+void gen::follow(const string &fname, double threshold) {
+  if (runmode != generate)
+    return;
+  followed = fname;
+  follow_threshold = threshold;
+  std::fill_n(followed_id, 4, 0);
+  refresh();
+}
+
+void gen::refresh() {
+  struct stat st;
+  if (followed.empty() || stat(followed.c_str(), &st))
+    return;
+  // Nanoseconds, too: a trainer may rewrite the model several times a second.
+  const auto &mtime = modified(st);
+  const uint64_t id[] = {uint64_t(st.st_ino), uint64_t(st.st_size),
+                         uint64_t(mtime.tv_sec), uint64_t(mtime.tv_nsec)};
+  if (std::equal(id, id + 4, followed_id))
+    return;
+  linear_model m;
+  try {
+    m.load(followed);
+  } catch (const file_error &) {
+    return; // Keep the current model, and retry on the next restart().
+  }
+  std::copy(id, id + 4, followed_id);
+  predict(std::move(m), follow_threshold);
+}
+
+void gen::restart() {
+  if (runmode != generate)
+    return;
+  olog.flush();
+  if (oshm)
+    oshm->abandon();
+  else
+    ofile.close();
+  open_output();
+  if (oindex)
+    oindex.reset(new logindex(oindex->stride()));
+  opos = 0;
+  storage.clear();
+  linear = linear_start;
+  score = model.bias();
+  occurrences.clear();
+  spent = 0;
+  refresh();
+}
+
+void gen::open_output() {
+  if (ologname.compare(0, 4, "shm:") == 0) {
+    static std::atomic<unsigned> rings(0);
+    oshm.reset(new shmbuf(ologname.substr(4) + "." + to_string(getpid()) +
+                          "." + to_string(rings++)));
+    olog.rdbuf(oshm.get());
+  } else {
+    ofile.open(ologname);
+    if (!ofile)
+      throw file_error("Cannot open " + ologname);
+    olog.rdbuf(ofile.rdbuf());
+  }
+}
+
+uint64_t gen::draw_size(uint64_t span) {
+  if (limits.sizes == budget::geometric) {
+    if (!(limits.mean > 0))
+      return 0;
+    const double p = 1. / (1. + limits.mean);
+    return std::min<uint64_t>(
+        span, std::geometric_distribution<uint64_t>(p)(rgen));
+  }
+  // Log-uniform: pick how many bits the size has, then the size.
+  unsigned bits = 0;
+  while (bits < 64 && span >> bits)
+    ++bits;
+  const auto b = ibetween(0u, bits, rgen);
+  const uint64_t top = b == 64 ? ~0ull : (1ull << b) - 1;
+  return ibetween<uint64_t>(0, std::min(span, top), rgen);
+}
+
+void budget::parse(const string &spec) {
+  budget res = *this;
+  std::istringstream is(spec);
+  for (string item; getline(is, item, ',');) {
+    const auto eq = item.find('=');
+    const auto key = item.substr(0, eq);
+    const auto value = eq == string::npos ? "" : item.substr(eq + 1);
+    std::istringstream vs(value);
+    bool ok;
+    if (key == "sizes") {
+      ok = true;
+      if (value == "uniform")
+        res.sizes = uniform;
+      else if (value == "geometric")
+        res.sizes = geometric;
+      else if (value == "small")
+        res.sizes = small;
+      else
+        ok = false;
+    } else if (key == "mean") {
+      ok = vs >> res.mean && vs.eof() && res.mean >= 0;
+    } else if (key == "size" || key == "total") {
+      auto &field = key == "size" ? res.size : res.total;
+      ok = !value.empty() &&
+           std::isdigit(static_cast<unsigned char>(value[0])) &&
+           vs >> field && vs.eof();
+    } else {
+      ok = false;
+    }
+    if (!ok)
+      throw std::invalid_argument("Malformed budget item \"" + item + "\"");
   }
+  *this = res;
 }
 
 size_t gen::valueid() {
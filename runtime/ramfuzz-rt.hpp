@@ -16,14 +16,17 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <exception>
 #include <fstream>
 #include <functional>
 #include <limits>
+#include <memory>
 #include <ostream>
 #include <random>
+#include <stdexcept>
 #include <sstream>
 #include <string>
 #include <type_traits>
@@ -35,6 +38,13 @@
 #define UNW_LOCAL_ONLY
 #include <libunwind.h>
 
+#include "ramfuzz-constraints.hpp"
+#include "ramfuzz-dictionary.hpp"
+#include "ramfuzz-linear.hpp"
+#include "ramfuzz-log.hpp"
+#include "ramfuzz-model.hpp"
+#include "ramfuzz-shm.hpp"
+
 namespace ramfuzz {
 
 /// RamFuzz harness for testing C objects.
@@ -56,14 +66,30 @@ namespace ramfuzz {
 ///
 /// The count of constructor harness methods is kept in a member named ccount.
 /// There is also a member named croulette; it's an array of ccount method
-/// pointers, one for each constructor method.  The harness class itself has a
+/// pointers, one for each constructor method.  Generated harnesses also have a
+/// method construct(unsigned idx) that calls the same method as croulette[idx]
+/// directly.  The harness class itself has a
 /// constructor that constructs a C instance using a randomly chosen C
 /// constructor.  This constructor takes a runtime::gen reference as a
 /// parameter.
 ///
 /// The count of non-constructor harness methods is kept in a member named
 /// mcount.  There is also a member named mroulette; it's an array of mcount
-/// method pointers, one for each non-constructor harness method.
+/// method pointers, one for each non-constructor harness method.  Generated
+/// harnesses also have a method invoke_method(unsigned idx) that calls the same
+/// method as mroulette[idx] directly, via a switch; gen prefers it, since calls
+/// through it can be inlined.  In generated harnesses, mroulette lists the
+/// mutators (harness methods for C's non-const methods and fields) first: the
+/// first mutcount elements are those, and the rest are observers that invoke
+/// const methods.  When making a random C object, gen only calls mutators,
+/// while tests can explore an object's state by calling observers.  The last
+/// setcount mutators set C's public fields, one each.  If those fields hold all
+/// of C's state, the harness also has a method fill() that sets them all, and
+/// gen calls it instead of spinning the setters.  When the mutators gen spins
+/// aren't all equally likely (see --weights in ../main.cpp), the harness has
+/// their alias table in members wprob and walias; see gen::pick().  If their
+/// weights are all 0, the harness instead has a member nospin that's true, and
+/// gen spins none of them.
 ///
 /// A member named subcount contains the number of C's direct subclasses.  A
 /// member named submakers is an array of subcount pointers to functions of type
@@ -77,15 +103,51 @@ namespace runtime {
 /// RamFuzz classes.  Should be defined in user's code.
 extern unsigned spinlimit;
 
-/// Exception thrown when there's a file-access error.
-struct file_error : public std::runtime_error {
-  explicit file_error(const std::string &s) : runtime_error(s) {}
-  explicit file_error(const char *s) : runtime_error(s) {}
-};
+/// Probabilities in harness alias tables (see gen::pick()) are fractions of
+/// this.  Must equal AliasTable::scale in ../lib/AliasTable.hpp.
+constexpr unsigned alias_scale = 1u << 16;
 
 /// Returns T's type tag to put into RamFuzz logs.
 template <typename T> char typetag(T);
 
+/// Exception thrown by gen when it gives up on a run predicted to fail (see
+/// gen::predict()).
+struct abandoned : public std::runtime_error {
+  abandoned() : runtime_error("RamFuzz run abandoned as likely to fail") {}
+};
+
+/// Limits on the sizes of the containers, strings, and buffers a gen makes,
+/// and how those sizes are distributed (see gen::limit()).  A vector of class
+/// objects, each with containers of its own, can take seconds to generate
+/// when sizes are drawn uniformly up to the hundreds; budgets bound that.
+struct budget {
+  /// How sizes are drawn from their allowed range [lo, hi]: uniformly;
+  /// geometrically, with mean lo+mean; or log-uniformly, ie, with an equal
+  /// chance for each power of two, which favours small sizes yet still reaches
+  /// hi.
+  enum distribution { uniform, geometric, small };
+
+  /// Most elements in any one container or string, and bytes in any one
+  /// buffer.  Harnesses' own limits (eg, 1000 for vectors) still apply.
+  size_t size = std::numeric_limits<size_t>::max();
+
+  /// Most elements and bytes in all containers, strings, and buffers of a
+  /// run together; 0 means no limit.  Once the run spends it, every further
+  /// size is its minimum.
+  size_t total = 0;
+
+  distribution sizes = uniform;
+
+  /// Mean of the geometric distribution, above lo.
+  double mean = 8;
+
+  /// Reads a budget from \p spec, a comma-separated list of key=value pairs,
+  /// eg "size=100,total=10000,sizes=geometric,mean=4".  Keys not in \p spec
+  /// keep their current values.  Throws std::invalid_argument if \p spec is
+  /// malformed.
+  void parse(const std::string &spec);
+};
+
 /// Generates values for RamFuzz code.  Can be used in the "generate" or
 /// "replay" mode.  In "generate" mode, values are created at random and logged.
 /// In "replay" mode, values are read from a previously generated log.  This
@@ -106,9 +168,16 @@ template <typename T> char typetag(T);
 /// which the value is generated.  Different program runs may generate different
 /// values at the same location; this is useful for AI analysis of the logs and
 /// program outcomes.
+///
+/// An output log name of the form "shm:<prefix>" makes the log go into a
+/// shared-memory ring named "<prefix>.<pid>.<n>" instead of a file (see
+/// ramfuzz-shm.hpp).  The ring is drained by ramfuzz-collect, which stores the
+/// log in its corpus.  The prefix must begin with '/' and contain no other
+/// slashes, eg "shm:/ramfuzz".
 class gen {
-  /// Are we generating values or replaying a previous run?
-  enum { generate, replay } runmode;
+  /// Are we generating values or replaying a previous run?  In "locreplay"
+  /// mode, replayed values are matched by location (see replay_by_location()).
+  enum { generate, replay, locreplay } runmode;
 
 public:
   /// Values will be generated and logged in ologname.
@@ -120,13 +189,149 @@ public:
   /// Interprets kth command-line argument.  If the argument exists (ie, k <
   /// argc), values will be replayed from file named argv[k] and logged in
   /// argv[k]+"+".  If the argument doesn't exist, values will be generated and
-  /// logged in "fuzzlog".
+  /// logged in "fuzzlog" or, if the environment variable RAMFUZZ_LOG is set,
+  /// in the log it names (eg, "shm:/ramfuzz").  If the environment variable
+  /// RAMFUZZ_REPLAY is "location", replay is by location, as if
+  /// replay_by_location() were called.  If the environment variable
+  /// RAMFUZZ_CONSTRAINTS is set, the constraints file it names is loaded as if
+  /// by constrain().  If the environment variable RAMFUZZ_MODEL is set when
+  /// generating, the model file it names is followed as if by follow(), with
+  /// the threshold in RAMFUZZ_ABORT_BELOW (default 0.05).  If the environment
+  /// variable RAMFUZZ_BUDGET is set, it's parsed by budget::parse() and passed
+  /// to limit().  If the environment variable RAMFUZZ_DICTIONARY is set, the
+  /// dictionary file it names is loaded as if by interesting(), and
+  /// RAMFUZZ_INTERESTING, if set, is passed to interesting_chance().
   ///
   /// This makes it convenient for main(argc, argv) to invoke gen(argc, argv),
   /// yielding a program that either generates its values (if no command-line
   /// arguments) or replays the log file named by its first argument.
   gen(int argc, const char *const *argv, size_t k = 1);
 
+  /// Writes the output log's index, if index_log() was called.  Closes the
+  /// shared-memory ring, if logging into one.
+  ~gen();
+
+  /// Makes the output log randomly accessible: when this gen is destroyed, it
+  /// will write a logindex with the given stride into a file named
+  /// indexname(<output log name>).  See ramfuzz-log.hpp.  Has no effect when
+  /// logging into shared memory.  Must be called before the first value is
+  /// logged (or right after restart()), since the index must cover the whole
+  /// log; throws std::logic_error otherwise.
+  void index_log(size_t stride = logindex::default_stride) {
+    if (opos)
+      throw std::logic_error("index_log() called after values were logged");
+    oindex.reset(new logindex(stride));
+  }
+
+  /// Makes replay tolerant of changes in the code under test.  Normally, replay
+  /// is positional: the Nth value requested gets the Nth input-log entry, so a
+  /// single extra or missing value derails the rest of the replay.  After this
+  /// call, each value is instead taken from the earliest unused input-log entry
+  /// with the same location ID and type, provided it's within the requested
+  /// bounds.  Values with no such entry are generated randomly.  Reads the
+  /// whole remaining input log.  Has no effect in "generate" mode.
+  void replay_by_location();
+
+  /// Makes between() generate values within the ranges that \p c has for their
+  /// locations (see ramfuzz-constraints.hpp), adding to any constraints
+  /// already in effect.  Replayed values aren't affected.
+  void constrain(const constraints &c) {
+    for (const auto &l : c.all())
+      for (const auto &r : l.second)
+        guide.add(l.first, r.lo, r.hi, r.weight);
+  }
+
+  /// Like constrain() above, with constraints read from file \p fname.
+  /// Throws file_error if the file can't be loaded.
+  void constrain(const std::string &fname) { guide.load(fname); }
+
+  /// Makes the values between() returns from now on satisfy the inequalities
+  /// in \p s, whose x[0] is the next value (see ramfuzz-linear.hpp).  Each
+  /// value is generated within the interval that s allows it, intersected with
+  /// the requested bounds; if that's empty, the constraint is ignored for that
+  /// value.  Replaces any previous linear_system.
+  void constrain(linear_system s) {
+    linear = s;
+    linear_start = std::move(s);
+  }
+
+  /// Limits the sizes of containers, strings, and buffers made from now on,
+  /// and sets their distribution, as \p b says.  Only generated sizes are
+  /// affected; replay reproduces the logged ones whatever the budget.  The
+  /// run's spending starts anew at restart().
+  void limit(const budget &b) { limits = b; }
+
+  /// Adds the values in \p d to those make() sometimes picks instead of
+  /// random numbers (see ramfuzz-dictionary.hpp), once interesting_chance()
+  /// is positive.  The built-in values of each type are always among them.
+  /// Replayed values aren't affected.
+  void interesting(const dictionary &d) {
+    for (const auto &t : d.types())
+      for (auto v : t.second)
+        dict.add(t.first, v);
+    for (const auto &l : d.locations())
+      for (auto v : l.second)
+        dict.add_at(l.first, v);
+  }
+
+  /// Like interesting() above, with the dictionary read from file \p fname.
+  /// Throws file_error if the file can't be loaded.
+  void interesting(const std::string &fname) { dict.load(fname); }
+
+  /// Sets the probability that make() picks an interesting value instead of a
+  /// random number, when one fits the bounds and constraints.  The default is
+  /// 0, which turns interesting values off; .05 is a reasonable start.
+  void interesting_chance(double p) { interest = p > 0 ? std::min(p, 1.) : 0; }
+
+  /// Makes between() score the run as it goes by model \p m (see
+  /// ramfuzz-model.hpp) and throw abandoned as soon as the predicted
+  /// probability of success drops below \p threshold.  The test can then end
+  /// the run early, or call restart() and try again.  The prediction counts
+  /// only the values generated so far, starting from the model's bias, so the
+  /// threshold should be well below the probability of an average run.  Has no
+  /// effect outside "generate" mode, since replays must run to the end.
+  void predict(linear_model m, double threshold);
+
+  /// Like predict() above, with the model read from file \p fname.  Throws
+  /// file_error if the file can't be loaded.
+  void predict(const std::string &fname, double threshold) {
+    linear_model m;
+    m.load(fname);
+    predict(std::move(m), threshold);
+  }
+
+  /// Like predict() above, with the model read from file \p fname, but the
+  /// file is read again by each restart() after it changes, so a trainer like
+  /// ramfuzz-collect --learn can keep improving the model while the test runs.
+  /// Until the file exists, or while it can't be loaded, the last model loaded
+  /// (if any) stays in effect.  The file should be replaced atomically, as
+  /// linear_model::save() does.  Has no effect outside "generate" mode.
+  void follow(const std::string &fname, double threshold);
+
+  /// The probability of success the model given to predict() assigns to the
+  /// values generated so far.
+  double success_probability() const {
+    return linear_model::probability(score);
+  }
+
+  /// Starts a new run in "generate" mode: empties the output log and forgets
+  /// all values made so far, so the log ends up as if the run had started
+  /// afresh.  When logging into shared memory, the current ring is marked
+  /// abandoned, and ramfuzz-collect discards it; the new run gets a new ring.
+  /// Reloads the model given to follow(), if its file changed.  Has no effect
+  /// in replay modes.
+  void restart();
+
+  /// Records whether the test run succeeded, so ramfuzz-collect can label the
+  /// log accordingly.  Has no effect unless logging into shared memory.  If
+  /// never called, the collector labels the log by the process's exit status
+  /// (when it launched the process) or as a failure (when the process died
+  /// without closing the ring).
+  void set_outcome(bool succeeded) {
+    if (oshm)
+      oshm->set_outcome(succeeded);
+  }
+
   /// Returns an unconstrained value of type T and logs it.  The value is random
   /// in "generate" mode but read from the input log in "replay" mode.
   ///
@@ -145,28 +350,83 @@ public:
   /// Handy name for invoking make<T>(or_subclass).
   static constexpr bool or_subclass = true;
 
+  /// What a number between() generates stands for, which decides how it's
+  /// drawn: a choice among alternatives (drawn uniformly), a size (see
+  /// length()), or a value handed to the code under test (see interesting()).
+  enum class source { choice, size, value };
+
   /// Returns a value of numeric type T between lo and hi, inclusive, and logs
-  /// it.  The value is random in "generate" mode but read from the input log in
-  /// "replay" mode.
-  template <typename T> T between(T lo, T hi) {
+  /// it.  The value is random in "generate" mode (within the constraints for
+  /// its location, if any) but read from the input log in "replay" mode.  When
+  /// generated, sizes without constraints are drawn from the budget's size
+  /// distribution, and values are sometimes interesting ones rather than
+  /// random.
+  template <typename T> T between(T lo, T hi, source from = source::choice) {
     T val;
-    if (runmode == generate)
-      val = uniform_random(lo, hi);
-    else
+    const auto id = valueid();
+    if (runmode == replay)
       input(val);
-    output(val, valueid());
+    else if (runmode == generate || !input(id, lo, hi, val)) {
+      narrow(lo, hi);
+      if (from != source::value ||
+          !pick_interesting(id, lo, hi, val, std::is_arithmetic<T>()))
+        val = from == source::size && limits.sizes != budget::uniform &&
+                      !guided(id)
+                  ? T(lo + draw_size(uint64_t(hi - lo)))
+                  : guided_random(id, lo, hi);
+    }
+    output(val, id);
+    if (!linear.done())
+      linear.fix(val);
+    if (predicting)
+      foresee(id, val);
     return val;
   }
 
+  /// Returns the size of a new container, string, or buffer, between lo and
+  /// hi inclusive, and logs it like between() does.  Within the budget given
+  /// to limit(), the size is at most the budget's size and what's left of its
+  /// total, but at least lo.  The size is charged against the total.  T must
+  /// be an integral type, and lo must be non-negative.
+  template <typename T> T length(T lo, T hi) {
+    auto cap = limits.size;
+    if (limits.total)
+      cap = std::min(cap, limits.total > spent ? limits.total - spent : 0);
+    if (uint64_t(hi) > cap)
+      hi = std::max(lo, T(cap));
+    const auto n = between(lo, hi, source::size);
+    spent += n;
+    return n;
+  }
+
 private:
   /// Logs val and id to olog.
   template <typename U> void output(U val, size_t id) {
+    const auto width = 1 + sizeof(val) + sizeof(id);
+    if (oindex)
+      oindex->add(id, opos, width);
+    opos += width;
     olog.put(typetag(val));
     olog.write(reinterpret_cast<char *>(&val), sizeof(val));
     olog.write(reinterpret_cast<char *>(&id), sizeof(id));
     olog.flush();
   }
 
+  /// Reloads the followed model if its file changed since it was last loaded.
+  void refresh();
+
+  /// Adds value \p val, generated at location \p id, to the run's score.
+  /// Throws abandoned if the score falls below cutoff.  Non-finite values
+  /// count as occurrences but don't score (see ramfuzz-model.hpp).
+  void foresee(size_t id, double val) {
+    const auto w = model.weight(id, occurrences[id]++);
+    if (!std::isfinite(val))
+      return;
+    score += w * val;
+    if (score < cutoff)
+      throw abandoned();
+  }
+
   /// Reads val from ilog and advances ilog to the beginning of the next value.
   template <typename T> void input(T &val) {
     const char ty = ilog.get();
@@ -176,6 +436,27 @@ private:
     ilog.read(reinterpret_cast<char *>(&id), sizeof(id));
   }
 
+  /// Reads val from the input-log entries at location id (see
+  /// replay_by_location()).  Returns false, leaving val unchanged, if there is
+  /// no suitable entry.
+  template <typename T> bool input(size_t id, T lo, T hi, T &val) {
+    const auto found = ibyloc.find(id);
+    if (found == ibyloc.end())
+      return false;
+    auto &q = found->second;
+    while (q.next < q.entries.size()) {
+      const auto &e = q.entries[q.next++];
+      if (e.tag != typetag(val))
+        continue;
+      const auto v = e.as<T>();
+      if (within(v, lo, hi)) {
+        val = v;
+        return true;
+      }
+    }
+    return false;
+  }
+
   /// Stores p as the newest element in T's storage.  Returns p.
   template <typename T> T *store(T *p) {
     storage[std::type_index(typeid(T))].push_back(p);
@@ -191,6 +472,79 @@ private:
                                T>::type>::type>::value;
   };
 
+  /// Provides a static const member named `value` that's true iff harness H has
+  /// a method invoke_method(unsigned).
+  template <typename H, typename = void>
+  struct has_invoke_method : std::false_type {};
+  template <typename H>
+  struct has_invoke_method<
+      H, decltype(std::declval<H &>().invoke_method(0u))>
+      : std::true_type {};
+
+  /// Invokes h's method number idx.  Uses h.invoke_method() if it exists, which
+  /// unlike mroulette lets the compiler inline the harness method.
+  template <typename H> static void invoke(H &h, unsigned idx, std::true_type) {
+    h.invoke_method(idx);
+  }
+  template <typename H>
+  static void invoke(H &h, unsigned idx, std::false_type) {
+    // Constant condition, so an empty mroulette isn't referenced at all; some
+    // harnesses in this file don't define theirs out of line.
+    if (H::mcount)
+      (h.*h.mroulette[idx])();
+  }
+
+  /// How many of harness H's methods may change the object under test.  Those
+  /// are mroulette's first elements.  Harnesses without a mutcount member are
+  /// assumed to have only such methods.
+  template <typename H>
+  static constexpr auto mutcount(int) -> decltype(H::mutcount + 0u) {
+    return H::mutcount;
+  }
+  template <typename H> static constexpr unsigned mutcount(long) {
+    return H::mcount;
+  }
+
+  /// Provides a static const member named `value` that's true iff harness H has
+  /// a method fill().
+  template <typename H, typename = void> struct has_fill : std::false_type {};
+  template <typename H>
+  struct has_fill<H, decltype(std::declval<H &>().fill())> : std::true_type {};
+
+  /// Readies h.obj for spinning the method roulette.  Returns how many of h's
+  /// methods are worth spinning afterwards.  If h has fill(), calls it, after
+  /// which setting individual fields is no longer worth it.
+  template <typename H> static unsigned prepare(H &h, std::true_type) {
+    h.fill();
+    return H::mutcount - H::setcount;
+  }
+  template <typename H> static unsigned prepare(H &, std::false_type) {
+    return mutcount<H>(0);
+  }
+
+  /// Returns n, or 0 if harness H has a true nospin member.
+  template <typename H>
+  static constexpr auto spinnable(unsigned n, int) -> decltype(H::nospin, 0u) {
+    return H::nospin ? 0 : n;
+  }
+  template <typename H> static constexpr unsigned spinnable(unsigned n, long) {
+    return n;
+  }
+
+  /// Draws which of harness H's first n methods to spin.  If H has an alias
+  /// table for them, draws by their weights, still in constant time and with a
+  /// single logged value: the row and the chance of keeping it.  Otherwise,
+  /// draws uniformly.
+  template <typename H>
+  auto pick(unsigned n, int) -> decltype(H::walias[0] + 0u) {
+    const auto r = between(size_t{0}, size_t{n} * alias_scale - 1);
+    const unsigned row = r / alias_scale;
+    return r % alias_scale < H::wprob[row] ? row : H::walias[row];
+  }
+  template <typename H> unsigned pick(unsigned n, long) {
+    return between(0u, n - 1);
+  }
+
   /// Like the public make(), but creates a brand new object and never returns
   /// previously created ones.
   ///
@@ -200,8 +554,12 @@ private:
   T *makenew(typename std::enable_if<std::is_arithmetic<T>::value ||
                                          std::is_enum<T>::value,
                                      bool>::type allow_subclass = false) {
-    return store(new T(
-        between(std::numeric_limits<T>::min(), std::numeric_limits<T>::max())));
+    using lim = std::numeric_limits<T>;
+    return store(new T(between(lim::lowest(), lim::max(),
+                               std::is_arithmetic<T>::value &&
+                                       !std::is_same<T, bool>::value
+                                   ? source::value
+                                   : source::choice)));
   }
 
   template <typename T>
@@ -214,9 +572,11 @@ private:
           *this);
     } else {
       harness<T> h(*this);
-      if (h.mcount) {
+      // Const methods can't change h.obj, so spinning them would be a waste.
+      if (const auto n = spinnable<harness<T>>(
+              prepare(h, has_fill<harness<T>>()), 0)) {
         for (auto i = 0u, e = between(0u, runtime::spinlimit); i < e; ++i)
-          (h.*h.mroulette[between(0u, h.mcount - 1)])();
+          invoke(h, pick<harness<T>>(n, 0), has_invoke_method<harness<T>>());
       }
       return store(h.obj);
     }
@@ -225,7 +585,7 @@ private:
   template <typename T>
   T *makenew(
       typename std::enable_if<std::is_void<T>::value, bool>::type = false) {
-    return store<void>(new char[between(1, 4196)]);
+    return store<void>(new char[length(1, 4196)]);
   }
 
   template <typename T>
@@ -243,7 +603,7 @@ private:
   T *makenew(typename std::enable_if<is_char_ptr<T>::value, bool>::type
                  allow_subclass = false) {
     auto r = new char *;
-    const auto sz = between(0u, 1000u);
+    const auto sz = length(0u, 1000u);
     *r = new char[sz + 1];
     (*r)[sz] = '\0';
     for (size_t i = 0; i < sz; ++i)
@@ -265,6 +625,152 @@ private:
   /// Logs the value in olog.
   template <typename T> T uniform_random(T lo, T hi);
 
+  /// Narrows [lo, hi] to its intersection with r, rounded inwards to T's
+  /// values.  Returns false, leaving lo and hi unspecified, if the
+  /// intersection is empty.
+  template <typename T>
+  static bool clip(const constraints::range &r, T &lo, T &hi) {
+    const bool integral = std::is_integral<T>::value;
+    const double rlo = integral ? std::ceil(r.lo) : r.lo;
+    const double rhi = integral ? std::floor(r.hi) : r.hi;
+    if (rlo > rhi || rhi < double(lo) || rlo > double(hi))
+      return false;
+    // Compared as doubles, but assigned only when rlo and rhi are strictly
+    // inside [lo, hi], so the conversions to T can't overflow.
+    if (rlo > double(lo))
+      lo = rlo < double(hi) ? T(rlo) : hi;
+    if (rhi < double(hi))
+      hi = rhi > double(lo) ? T(rhi) : lo;
+    return lo <= hi;
+  }
+
+  /// Narrows [lo, hi] to the values linear allows for the next value, if
+  /// there are any.
+  template <typename T> void narrow(T &lo, T &hi) {
+    double l, h;
+    if (linear.done() || !linear.bounds(l, h))
+      return;
+    T nlo = lo, nhi = hi;
+    if (clip(constraints::range{l, h, 1}, nlo, nhi)) {
+      lo = nlo;
+      hi = nhi;
+    }
+  }
+
+  /// Returns a random value between lo and hi, inclusive.  If guide has ranges
+  /// for location id, picks one of those overlapping [lo, hi] by weight, and
+  /// returns a uniformly distributed value in the overlap.  Otherwise, the
+  /// value is uniformly distributed in [lo, hi].
+  template <typename T> T guided_random(size_t id, T lo, T hi) {
+    const auto ranges = guide.empty() ? nullptr : guide.at(id);
+    if (!ranges)
+      return uniform_random(lo, hi);
+    double total = 0;
+    for (const auto &r : *ranges) {
+      T l = lo, h = hi;
+      if (clip(r, l, h))
+        total += r.weight;
+    }
+    if (total > 0) {
+      auto x = std::uniform_real_distribution<double>(0, total)(rgen);
+      for (const auto &r : *ranges) {
+        T l = lo, h = hi;
+        if (clip(r, l, h) && (x -= r.weight) < 0)
+          return uniform_random(l, h);
+      }
+    }
+    return uniform_random(lo, hi);
+  }
+
+  /// True iff v is between lo and hi, inclusive.  A floating-point v may also
+  /// be an infinity or NaN if [lo, hi] spans all finite values of T, as
+  /// makenew() asks for.
+  template <typename T>
+  static typename std::enable_if<!std::is_floating_point<T>::value, bool>::type
+  within(T v, T lo, T hi) {
+    return lo <= v && v <= hi;
+  }
+  template <typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+  within(T v, T lo, T hi) {
+    using lim = std::numeric_limits<T>;
+    return (lo <= v && v <= hi) ||
+           (!std::isfinite(v) && lo == lim::lowest() && hi == lim::max());
+  }
+
+  /// Converts dictionary value \p d to T in v.  Returns false if d is outside
+  /// [lo, hi] (save for infinities and NaN, which only floating-point types
+  /// take) or d isn't whole while T is integral.
+  template <typename T> static bool convert(double d, T lo, T hi, T &v) {
+    if (!std::isfinite(d)) {
+      if (!std::is_floating_point<T>::value)
+        return false;
+      v = T(d);
+      return true;
+    }
+    if ((std::is_integral<T>::value && d != std::trunc(d)) || d < double(lo) ||
+        d > double(hi))
+      return false;
+    // As in clip(), converts only values strictly inside [lo, hi].
+    v = d == double(lo) ? lo : d == double(hi) ? hi : T(d);
+    return true;
+  }
+
+  /// With probability interest, tries to set val to a value from dict or
+  /// builtin_values<T>() that's within [lo, hi] and guide's ranges for
+  /// location id.  The value's source (the location's values, its type's, all
+  /// types', or the built-in ones) is chosen uniformly among those that have
+  /// values, then the value uniformly within the source.  Returns false,
+  /// leaving val unchanged, if it didn't pick a value or the value doesn't
+  /// fit.
+  template <typename T>
+  bool pick_interesting(size_t id, T lo, T hi, T &val, std::true_type) {
+    if (!(interest > 0) || !std::bernoulli_distribution(interest)(rgen))
+      return false;
+    const std::vector<double> *lists[3];
+    size_t n = 0;
+    if (!dict.empty())
+      for (auto l : {dict.at(id), dict.of_type(typetag(lo)),
+                     dict.of_type(dictionary::any_type)})
+        if (l && !l->empty())
+          lists[n++] = l;
+    const auto &builtin = builtin_values<T>();
+    const size_t sources = n + !builtin.empty();
+    if (!sources)
+      return false;
+    const auto index = [this](size_t size) {
+      return std::uniform_int_distribution<size_t>(0, size - 1)(rgen);
+    };
+    const auto k = index(sources);
+    T v;
+    if (k == n)
+      v = builtin[index(builtin.size())];
+    else if (!convert((*lists[k])[index(lists[k]->size())], lo, hi, v))
+      return false;
+    if (!within(v, lo, hi))
+      return false;
+    if (guided(id)) {
+      const auto &ranges = *guide.at(id);
+      if (std::none_of(ranges.cbegin(), ranges.cend(),
+                       [v](const constraints::range &r) {
+                         return r.lo <= double(v) && double(v) <= r.hi;
+                       }))
+        return false;
+    }
+    val = v;
+    return true;
+  }
+  template <typename T>
+  bool pick_interesting(size_t, T, T, T &, std::false_type) {
+    return false;
+  }
+
+  /// True iff guide has ranges for location id.
+  bool guided(size_t id) const { return !guide.empty() && guide.at(id); }
+
+  /// A random size in [0, span], drawn from the budget's size distribution.
+  uint64_t draw_size(uint64_t span);
+
   /// Whether make() should reuse a previously created value or create a fresh
   /// one.  Decided randomly.
   bool reuse() { return between(false, true); }
@@ -277,12 +783,86 @@ private:
   /// Used for random value generation.
   std::ranlux24 rgen = std::ranlux24(std::random_device{}());
 
-  /// Output log.
-  std::ofstream olog;
+  /// Opens the output log named ologname: either a file or, for "shm:" names,
+  /// a shared-memory ring.
+  void open_output();
+
+  /// Output log file, unless logging into shared memory.
+  std::ofstream ofile;
+
+  /// Output ring, if logging into shared memory.
+  std::unique_ptr<shmbuf> oshm;
+
+  /// Output log; writes into either ofile or oshm.
+  std::ostream olog{nullptr};
+
+  /// Output log's file name.
+  std::string ologname;
+
+  /// Index of olog, if requested by index_log().
+  std::unique_ptr<logindex> oindex;
+
+  /// Current size of olog.
+  uint64_t opos = 0;
 
   /// Input log in replay mode.
   std::ifstream ilog;
 
+  /// Input-log entries at one location, in log order, and the next unused one.
+  struct locqueue {
+    std::vector<logentry> entries;
+    size_t next = 0;
+  };
+
+  /// Input-log entries by location, in "locreplay" mode.
+  std::unordered_map<size_t, locqueue> ibyloc;
+
+  /// Constraints on generated values; see constrain().
+  constraints guide;
+
+  /// Linear constraints on the sequence of generated values; see constrain().
+  linear_system linear;
+
+  /// linear as given to constrain(), for restart().
+  linear_system linear_start;
+
+  /// True iff between() scores values by model; see predict().
+  bool predicting = false;
+
+  /// Model that predicts the run's outcome.
+  linear_model model;
+
+  /// Scores below this mean the predicted probability is below threshold.
+  double cutoff;
+
+  /// The model's score of values generated so far.
+  double score = 0;
+
+  /// Name of the model file given to follow(), if any.
+  std::string followed;
+
+  /// Threshold given to follow().
+  double follow_threshold;
+
+  /// The followed file's inode, size, and modification time (seconds and
+  /// nanoseconds) when it was last loaded.
+  uint64_t followed_id[4] = {};
+
+  /// How many values were generated at each location, while predicting.
+  std::unordered_map<size_t, unsigned> occurrences;
+
+  /// Limits on sizes; see limit().
+  budget limits;
+
+  /// Sum of sizes returned by length() in this run.
+  size_t spent = 0;
+
+  /// User's interesting values; see interesting().
+  dictionary dict;
+
+  /// Probability of picking an interesting value; see interesting_chance().
+  double interest = 0;
+
   /// Stores all values generated by makenew().
   std::unordered_map<std::type_index, std::vector<void *>> storage;
 
@@ -298,6 +878,20 @@ private:
 /// value or the depthlimit member of any RamFuzz class.
 constexpr unsigned depthlimit = 20;
 
+/// Counts one more call in a generated RamFuzz method's call depth for as long
+/// as it lives.  Generated methods use it instead of a bare ++ and -- so the
+/// depth is restored even when generating a value throws (eg, abandoned).
+class depth_guard {
+public:
+  explicit depth_guard(unsigned &depth) : depth(depth) { ++depth; }
+  ~depth_guard() { --depth; }
+  depth_guard(const depth_guard &) = delete;
+  depth_guard &operator=(const depth_guard &) = delete;
+
+private:
+  unsigned &depth;
+};
+
 } // namespace runtime
 
 template <> class harness<std::exception> {
@@ -322,7 +916,7 @@ public:
   std::vector<Tp, Alloc> *obj;
 
   harness(runtime::gen &g)
-      : g(g), obj(new std::vector<Tp, Alloc>(g.between(0u, 1000u))) {
+      : g(g), obj(new std::vector<Tp, Alloc>(g.length(0u, 1000u))) {
     for (size_t i = 0; i < obj->size(); ++i)
       (*obj)[i] = *g.make<typename std::remove_cv<Tp>::type>();
   }
@@ -346,9 +940,9 @@ public:
   std::basic_string<CharT, Traits, Allocator> *obj;
   harness(runtime::gen &g)
       : g(g), obj(new std::basic_string<CharT, Traits, Allocator>(
-                  g.between(1u, 1000u), CharT())) {
+                  g.length(1u, 1000u), CharT())) {
     for (size_t i = 0; i < obj->size() - 1; ++i)
-      obj[i] = g.between<CharT>(1, std::numeric_limits<CharT>::max());
+      (*obj)[i] = g.between<CharT>(1, std::numeric_limits<CharT>::max());
     obj->back() = CharT(0);
   }
   operator bool() const { return true; }
@@ -0,0 +1,162 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ramfuzz-shm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ramfuzz-log.hpp"
+
+using std::min;
+using std::streamsize;
+using std::string;
+
+namespace {
+
+using ramfuzz::runtime::file_error;
+using ramfuzz::runtime::shmring;
+
+/// Maps the whole file fd, which is size bytes long.
+shmring *map(int fd, size_t size, const string &name) {
+  void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    throw file_error("Cannot map " + name);
+  return static_cast<shmring *>(p);
+}
+
+} // anonymous namespace
+
+namespace ramfuzz {
+namespace runtime {
+
+shmbuf::shmbuf(const string &name, size_t capacity)
+    : name_(name), mapsize(sizeof(shmring) + capacity) {
+  if (capacity < min_capacity)
+    throw std::invalid_argument("Ring capacity too small for " + name);
+  const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0)
+    throw file_error("Cannot create " + name);
+  if (ftruncate(fd, mapsize)) {
+    close(fd);
+    shm_unlink(name.c_str());
+    throw file_error("Cannot size " + name);
+  }
+  try {
+    ring = new (map(fd, mapsize, name)) shmring;
+  } catch (const file_error &) {
+    shm_unlink(name.c_str());
+    throw;
+  }
+  ring->pid = getpid();
+  ring->capacity = capacity;
+  ring->head = 0;
+  ring->tail = 0;
+  ring->state = shmring::running;
+  ring->outcome = shmring::unknown;
+  // The collector ignores rings whose magic isn't set yet.
+  std::atomic_thread_fence(std::memory_order_release);
+  ring->magic = shmring::magic_value;
+}
+
+shmbuf::~shmbuf() {
+  sync();
+  ring->state.store(shmring::closed, std::memory_order_release);
+  munmap(ring, mapsize);
+}
+
+shmbuf::int_type shmbuf::overflow(int_type c) {
+  if (traits_type::eq_int_type(c, traits_type::eof()))
+    return traits_type::not_eof(c);
+  const char ch = traits_type::to_char_type(c);
+  xsputn(&ch, 1);
+  return c;
+}
+
+streamsize shmbuf::xsputn(const char *s, streamsize n) {
+  const auto cap = ring->capacity;
+  for (streamsize done = 0; done < n;) {
+    auto room = cap - (written - ring->tail.load(std::memory_order_acquire));
+    if (room == 0) {
+      // Wait for the collector to make room.  Don't publish the bytes written
+      // so far, which may end mid-entry; the collector can still drain all
+      // entries before them, and those take up all but a fraction of the ring
+      // (see min_capacity).
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+      continue;
+    }
+    const auto at = written % cap;
+    const auto len = min<uint64_t>({room, uint64_t(n - done), cap - at});
+    std::memcpy(ring->data() + at, s + done, len);
+    written += len;
+    done += len;
+  }
+  return n;
+}
+
+int shmbuf::sync() {
+  ring->head.store(written, std::memory_order_release);
+  return 0;
+}
+
+shmreader::shmreader(const string &name) : name_(name) {
+  const int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0)
+    throw file_error("Cannot open " + name);
+  struct stat st;
+  if (fstat(fd, &st) || size_t(st.st_size) < sizeof(shmring)) {
+    close(fd);
+    throw file_error("Not a RamFuzz ring: " + name);
+  }
+  mapsize = st.st_size;
+  ring = map(fd, mapsize, name);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (ring->magic != shmring::magic_value ||
+      ring->capacity != mapsize - sizeof(shmring)) {
+    munmap(ring, mapsize);
+    throw file_error("Not a RamFuzz ring: " + name);
+  }
+}
+
+shmreader::~shmreader() { munmap(ring, mapsize); }
+
+size_t shmreader::drain(string &out) {
+  const auto cap = ring->capacity;
+  const auto head = ring->head.load(std::memory_order_acquire);
+  auto tail = ring->tail.load(std::memory_order_relaxed);
+  const size_t total = head - tail;
+  while (tail < head) {
+    const auto at = tail % cap;
+    const auto len = min<uint64_t>(head - tail, cap - at);
+    out.append(ring->data() + at, len);
+    tail += len;
+  }
+  ring->tail.store(tail, std::memory_order_release);
+  return total;
+}
+
+void shmreader::unlink() { shm_unlink(name_.c_str()); }
+
+} // namespace runtime
+} // namespace ramfuzz
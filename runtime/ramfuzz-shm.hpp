@@ -0,0 +1,145 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file Shared-memory transport for RamFuzz logs.
+///
+/// Instead of writing its log to a file, a gen can write it into a ring buffer
+/// in POSIX shared memory (see gen's "shm:" log names in ramfuzz-rt.hpp).  A
+/// single collector process (../tools/ramfuzz-collect.cpp) drains the rings of
+/// all fuzzing processes on the host and stores their logs in a corpus.  This
+/// takes file I/O off the fuzzing processes' critical path.
+///
+/// Each ring has exactly one producer (the gen) and one consumer (the
+/// collector).  When the ring is full, the producer waits for the consumer to
+/// drain it, so a slow collector throttles all producers.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <string>
+
+namespace ramfuzz {
+namespace runtime {
+
+/// Header of a shared-memory ring.  The ring's data immediately follows it.
+struct shmring {
+  static constexpr uint32_t magic_value = 0x52465352;
+
+  /// Values of state.
+  enum : uint32_t { running, closed };
+
+  /// Values of outcome.  An abandoned run was cut short by its producer and
+  /// shouldn't be stored.
+  enum : int32_t { unknown = -1, success = 0, failure = 1, abandoned = 2 };
+
+  uint32_t magic;               ///< magic_value once the ring is initialized.
+  uint32_t pid;                 ///< Producer's process ID.
+  uint64_t capacity;            ///< Size of the data area in bytes.
+  std::atomic<uint64_t> head;   ///< Total bytes published by the producer.
+  std::atomic<uint64_t> tail;   ///< Total bytes consumed by the consumer.
+  std::atomic<uint32_t> state;  ///< running or closed.
+  std::atomic<int32_t> outcome; ///< The run's outcome, if the producer knows.
+
+  char *data() { return reinterpret_cast<char *>(this + 1); }
+};
+
+/// A streambuf writing into a newly created shared-memory ring.  Bytes become
+/// visible to the consumer only on sync() (ie, when the ostream is flushed),
+/// never while waiting for room in a full ring.  gen flushes after every log
+/// entry, so the consumer never sees a partial one.
+class shmbuf : public std::streambuf {
+public:
+  static constexpr size_t default_capacity = 1 << 22;
+
+  /// Smallest capacity allowed.  A full ring must hold at least one published
+  /// entry, or the producer would wait forever for the consumer to drain it.
+  static constexpr size_t min_capacity = 64;
+
+  /// Creates a ring named \p name (a POSIX shared-memory name, like
+  /// "/ramfuzz.123") with a data area of \p capacity bytes.  Throws file_error
+  /// on failure, and std::invalid_argument if capacity is below
+  /// min_capacity.
+  explicit shmbuf(const std::string &name,
+                  size_t capacity = default_capacity);
+
+  /// Publishes all written bytes and marks the ring closed.  The consumer
+  /// unlinks the ring after draining it.
+  ~shmbuf();
+
+  /// Records the run's outcome for the consumer.
+  void set_outcome(bool succeeded) {
+    ring->outcome = succeeded ? shmring::success : shmring::failure;
+  }
+
+  /// Marks the run abandoned, so the consumer discards its log.
+  void abandon() { ring->outcome = shmring::abandoned; }
+
+  const std::string &name() const { return name_; }
+
+protected:
+  int_type overflow(int_type c) override;
+  std::streamsize xsputn(const char *s, std::streamsize n) override;
+  int sync() override;
+
+private:
+  std::string name_;
+  shmring *ring;
+  size_t mapsize;
+  uint64_t written = 0; ///< Total bytes written, including unpublished ones.
+};
+
+/// Consumer end of a shared-memory ring created by shmbuf.
+class shmreader {
+public:
+  /// Attaches to the existing ring named \p name.  Throws file_error if it
+  /// doesn't exist or isn't a valid ring.
+  explicit shmreader(const std::string &name);
+
+  /// Detaches from the ring, without unlinking it.
+  ~shmreader();
+
+  shmreader(const shmreader &) = delete;
+  shmreader &operator=(const shmreader &) = delete;
+
+  /// Appends all published and not yet consumed bytes to \p out and marks them
+  /// consumed.  Returns how many bytes were appended.
+  size_t drain(std::string &out);
+
+  /// True iff the producer closed the ring.  If so, and the ring was drained
+  /// after this returned true, all the producer's bytes have been consumed.
+  bool closed() const { return ring->state == shmring::closed; }
+
+  /// The outcome recorded by the producer: shmring::success, failure,
+  /// abandoned, or unknown.
+  int32_t outcome() const { return ring->outcome; }
+
+  /// Producer's process ID.
+  uint32_t pid() const { return ring->pid; }
+
+  /// Removes the ring's name, so it's freed once everyone detaches.
+  void unlink();
+
+  const std::string &name() const { return name_; }
+
+private:
+  std::string name_;
+  shmring *ring;
+  size_t mapsize;
+};
+
+} // namespace runtime
+} // namespace ramfuzz
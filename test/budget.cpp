@@ -0,0 +1,66 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fuzz.hpp"
+
+#include <set>
+#include <stdexcept>
+
+using namespace ramfuzz;
+using namespace std;
+
+/// Sizes of the fresh vectors among many made by g.
+vector<size_t> sizes(runtime::gen &g) {
+  set<vector<int> *> fresh;
+  vector<size_t> res;
+  for (int i = 0; i < 50; ++i) {
+    const auto v = g.make<vector<int>>();
+    if (fresh.insert(v).second)
+      res.push_back(v->size());
+  }
+  return res;
+}
+
+int main() {
+  runtime::budget b;
+  b.parse("size=20,total=100,sizes=small");
+  for (const char *bad : {"size=-1", "sizes=big", "bogus=1", "mean=x"}) {
+    try {
+      b.parse(bad);
+      return 1;
+    } catch (const invalid_argument &) {
+    }
+  }
+  if (b.size != 20 || b.total != 100 || b.sizes != runtime::budget::small)
+    return 1;
+  vector<size_t> generated;
+  {
+    runtime::gen g("fuzzlog1");
+    g.limit(b);
+    for (int run = 0; run < 5; ++run) {
+      if (run)
+        g.restart();
+      generated = sizes(g);
+      size_t total = 0;
+      for (auto n : generated)
+        if ((total += n) > 100 || n > 20)
+          return 1;
+    }
+  }
+  // Replay reproduces the sizes without the budget.
+  runtime::gen r("fuzzlog1", "fuzzlog2");
+  return sizes(r) != generated;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 3;
@@ -0,0 +1,47 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fuzz.hpp"
+
+using namespace ramfuzz;
+using namespace std;
+
+vector<int> C::seen;
+
+int main() {
+  runtime::constraints c;
+  for (int pass = 0; pass < 2; ++pass) {
+    runtime::gen g(pass ? "fuzzlog2" : "fuzzlog1");
+    if (pass)
+      g.constrain("constraints");
+    C::seen.clear();
+    for (int i = 0; i < 20; ++i)
+      g.make<C>();
+    if (pass)
+      break;
+    // Constrain the location where C's constructor argument was generated.
+    runtime::logreader log("fuzzlog1");
+    runtime::logentry e;
+    while (log.next(e) && e.tag != runtime::typetag(0))
+      ;
+    c.add(e.loc, 40, 42);
+    c.save("constraints");
+  }
+  for (int x : C::seen)
+    if (x < 40 || x > 42)
+      return 1;
+  return C::seen.empty();
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 3;
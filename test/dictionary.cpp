@@ -0,0 +1,88 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fuzz.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace ramfuzz;
+using namespace std;
+
+vector<int> C::ints;
+vector<double> C::doubles;
+
+/// Makes many Cs with g.
+void make_many(runtime::gen &g) {
+  C::ints.clear();
+  C::doubles.clear();
+  for (int i = 0; i < 1000; ++i)
+    g.make<C>();
+}
+
+int main() {
+  ofstream("bad.dict") << "int 1\nlong double 2\n";
+  try {
+    runtime::dictionary d;
+    d.load("bad.dict");
+    return 1;
+  } catch (const runtime::file_error &) {
+  }
+  runtime::logentry e;
+  vector<int> ints;
+  vector<double> doubles;
+  for (int pass = 0; pass < 3; ++pass) {
+    if (pass == 1) {
+      runtime::logreader log("fuzzlog1");
+      while (log.next(e) && e.tag != runtime::typetag(0))
+        ;
+    }
+    // Pass 0 finds the location of C's int, pass 1 uses a dictionary with a
+    // value for it, and pass 2 replays pass 1 without the dictionary.
+    unique_ptr<runtime::gen> g(pass == 0 ? new runtime::gen("fuzzlog1")
+                               : pass == 1
+                                   ? new runtime::gen("fuzzlog2")
+                                   : new runtime::gen("fuzzlog2", "fuzzlog3"));
+    if (pass == 1) {
+      runtime::dictionary d;
+      d.add_at(e.loc, 777);
+      d.add(runtime::dictionary::any_type, .25);
+      g->interesting(d);
+      g->interesting_chance(1);
+    }
+    make_many(*g);
+    if (pass == 1) {
+      ints = C::ints;
+      doubles = C::doubles;
+    }
+  }
+  // Replay reproduces every value, NaNs included.
+  if (ints != C::ints || doubles.size() != C::doubles.size() ||
+      memcmp(doubles.data(), C::doubles.data(),
+             doubles.size() * sizeof(double)))
+    return 1;
+  const auto &builtin = runtime::builtin_values<int>();
+  const auto n777 = count(ints.cbegin(), ints.cend(), 777);
+  const auto nbuiltin = count_if(ints.cbegin(), ints.cend(), [&](int i) {
+    return find(builtin.cbegin(), builtin.cend(), i) != builtin.cend();
+  });
+  const auto nquarter = count(doubles.cbegin(), doubles.cend(), .25);
+  const auto nnan = count_if(doubles.cbegin(), doubles.cend(),
+                             [](double d) { return std::isnan(d); });
+  return n777 < 10 || nbuiltin < 10 || nquarter < 10 || !nnan;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 3;
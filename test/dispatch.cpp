@@ -0,0 +1,49 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fuzz.hpp"
+
+using namespace ramfuzz;
+
+/// Checks that invoke_method(i) does what mroulette[i] does, and construct(i)
+/// what croulette[i] does.
+int main(int argc, char *argv[]) {
+  runtime::gen g(argc, argv);
+  for (unsigned i = 0; i < harness<C>::mcount; ++i) {
+    harness<C> direct(g), roulette(g);
+    direct.invoke_method(i);
+    (roulette.*roulette.mroulette[i])();
+    if (direct.obj->get() != roulette.obj->get())
+      return 1;
+  }
+  for (unsigned i = 0; i < harness<C>::ccount; ++i) {
+    harness<C> h(g);
+    C *direct = h.construct(i), *roulette = (h.*h.croulette[i])();
+    if (direct->made_by() != roulette->made_by())
+      return 1;
+  }
+  if (harness<C>(g).construct(harness<C>::ccount))
+    return 1;
+  for (unsigned i = 0; i < harness<D<int>>::mcount; ++i) {
+    harness<D<int>> direct(g), roulette(g);
+    const int before = direct.obj->get() - roulette.obj->get();
+    direct.invoke_method(i);
+    (roulette.*roulette.mroulette[i])();
+    if (direct.obj->get() - roulette.obj->get() != before)
+      return 1;
+  }
+  return 0;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 3;
@@ -0,0 +1,38 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+class C {
+  int sum = 0;
+  int ctr;
+
+public:
+  C() : ctr(1) {}
+  C(int) : ctr(2) {}
+  C(const char *) : ctr(3) {}
+  int get() const { return sum; }
+  int made_by() const { return ctr; }
+  void a() { sum |= 0x100; }
+  void b() { sum |= 0x20; }
+  void b(int) { sum |= 0x40; }
+  void c() { sum |= 0x3; }
+};
+
+template <typename T> class D {
+  T sum = 0;
+
+public:
+  T get() const { return sum; }
+  void a() { sum += 1; }
+  void b() { sum += 10; }
+};
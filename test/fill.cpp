@@ -0,0 +1,41 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fuzz.hpp"
+
+#include <type_traits>
+#include <utility>
+
+using namespace ramfuzz;
+
+template <typename H, typename = void> struct has_fill : std::false_type {};
+template <typename H>
+struct has_fill<H, decltype(std::declval<H &>().fill())> : std::true_type {};
+
+int main(int argc, char *argv[]) {
+  static_assert(has_fill<harness<P>>::value, "P should be fillable");
+  static_assert(!has_fill<harness<Q>>::value, "Q has private state");
+  static_assert(!has_fill<harness<R>>::value, "R has a base");
+  static_assert(harness<P>::setcount == 3 && harness<P>::mutcount == 3, "");
+  runtime::gen g(argc, argv);
+  // Spinning setters would often leave some fields 0.
+  for (int i = 0; i < 100; ++i) {
+    const auto p = g.make<P>();
+    if (!p->a || !p->b || !p->c)
+      return 1;
+  }
+  return 0;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 3;
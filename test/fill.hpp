@@ -0,0 +1,34 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Tests filling all fields of classes whose state is all in public fields.
+
+struct P {
+  int a = 0, b = 0;
+  unsigned c = 0;
+};
+
+/// Has private state, so setting its fields isn't enough.
+class Q {
+  int hidden = 0;
+
+public:
+  int a = 0;
+  int get() const { return hidden; }
+};
+
+/// Has a base, whose state may not be visible.
+struct R : P {
+  int d = 0;
+};
@@ -0,0 +1,79 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fuzz.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace ramfuzz;
+using namespace std;
+
+vector<int> C::seen;
+
+int main() {
+  std::remove("follow.model");
+  runtime::logentry e;
+  unsigned abandoned = 0;
+  size_t flipped = 0; // Size of C::seen when the model was flipped.
+  for (int pass = 0; pass < 2; ++pass) {
+    if (pass) {
+      runtime::logreader log("fuzzlog1");
+      while (log.next(e) && e.tag != runtime::typetag(0))
+        ;
+    }
+    runtime::gen g(pass ? "fuzzlog2" : "fuzzlog1");
+    g.follow("follow.model", 0.5);
+    for (int run = 0; run < 20; ++run) {
+      if (pass && run == 10) {
+        // Publish a model predicting success iff C's constructor argument is
+        // non-negative; the next run should pick it up.
+        runtime::linear_model m;
+        m.set(e.loc, 0, 10);
+        m.save("follow.model");
+        C::seen.clear();
+      }
+      if (pass && run == 15) {
+        // Flip the model, twice in quick succession: the last file may well
+        // match the one loaded at run 10 in inode, size, and second.  Only
+        // the timestamp's nanoseconds tell them apart, so let the filesystem
+        // clock tick first.
+        this_thread::sleep_for(chrono::milliseconds(50));
+        for (double w : {20, -1}) {
+          runtime::linear_model m;
+          m.set(e.loc, 0, w);
+          m.save("follow.model");
+        }
+        flipped = C::seen.size();
+      }
+      if (run)
+        g.restart();
+      try {
+        g.make<C>();
+      } catch (const runtime::abandoned &) {
+        // Nothing is abandoned before the model exists.
+        if (!pass || run < 10)
+          return 1;
+        ++abandoned;
+      }
+    }
+  }
+  for (size_t i = 0; i < C::seen.size(); ++i)
+    if (i < flipped ? C::seen[i] < 0 : C::seen[i] > 0)
+      return 1;
+  return C::seen.empty() || !abandoned;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 3;
@@ -0,0 +1,34 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fuzz.hpp"
+
+using namespace ramfuzz;
+
+int main(int argc, char *argv[]) {
+  runtime::gen g(argc, argv);
+  for (int i = 0; i < 100; ++i) {
+    // hi - lo - 10 >= 0 and 1000 - hi >= 0.
+    runtime::linear_system s(2);
+    s.add({{-1, 1}, -10});
+    s.add({{0, -1}, 1000});
+    g.constrain(s);
+    const Range r{g.between(-1000, 1000), g.between(-1000, 1000)};
+    if (!r.valid())
+      return 1;
+  }
+  return 0;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 3;
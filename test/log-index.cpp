@@ -0,0 +1,79 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "fuzz.hpp"
+
+using namespace ramfuzz::runtime;
+using namespace std;
+
+/// Checks that reading entry n from r yields expected[n].
+bool check_seek(logreader &r, const vector<logentry> &expected, size_t n) {
+  logentry e;
+  return r.seek(n) && r.next(e) && e.same_value(expected[n]) &&
+         e.loc == expected[n].loc;
+}
+
+int main() {
+  {
+    gen g("fuzzlog1");
+    g.index_log(3);
+    for (int i = 0; i < 10; ++i)
+      g.make<A>();
+    // Too late: the index would miss the entries already logged.
+    try {
+      g.index_log();
+      return 6;
+    } catch (const logic_error &) {
+    }
+  }
+  logreader r("fuzzlog1");
+  if (!r.indexed())
+    return 1;
+  vector<logentry> all;
+  logentry e;
+  while (r.next(e))
+    all.push_back(e);
+  if (all.empty() || r.seek(all.size() + 1))
+    return 2;
+  for (size_t n = all.size(); n-- > 0;)
+    if (!check_seek(r, all, n))
+      return 3;
+  for (size_t n = 0; n < all.size(); n += 7)
+    if (!check_seek(r, all, n))
+      return 4;
+  for (size_t n = 0; n < all.size(); ++n) {
+    const auto pos = r.positions(all[n].loc);
+    if (!binary_search(pos.cbegin(), pos.cend(), n))
+      return 5;
+  }
+  {
+    // A corrupt index claiming far more checkpoints than it holds must be
+    // rejected, not allocated.
+    const uint64_t huge = uint64_t(1) << 40, words[] = {1, huge, 0, huge};
+    ofstream f(indexname("fuzzlog1"), ios::binary);
+    f.write("RFX1", 4);
+    f.write(reinterpret_cast<const char *>(words), sizeof(words));
+  }
+  if (logreader("fuzzlog1").indexed())
+    return 7;
+  return 0;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 5;
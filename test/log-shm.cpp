@@ -0,0 +1,58 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include "fuzz.hpp"
+
+using namespace ramfuzz::runtime;
+using namespace std;
+
+void fuzz(gen &g) {
+  for (unsigned i = 0; i < 10; ++i)
+    g.make<A>();
+}
+
+int main() {
+  const string prefix = "/ramfuzz-test-log-shm";
+  {
+    gen g("shm:" + prefix);
+    fuzz(g);
+    g.set_outcome(true);
+  }
+  shmreader ring(prefix + "." + to_string(getpid()) + ".0");
+  ring.unlink();
+  if (!ring.closed() || ring.outcome() != shmring::success ||
+      ring.pid() != unsigned(getpid()))
+    return 1;
+  string log;
+  if (!ring.drain(log) || ring.drain(log))
+    return 2;
+  ofstream("fuzzlog1", ios::binary) << log;
+  {
+    // The log must be replayable.
+    gen g("fuzzlog1", "fuzzlog2");
+    fuzz(g);
+  }
+  logreader orig("fuzzlog1"), replayed("fuzzlog2");
+  logentry e1, e2;
+  while (orig.next(e1))
+    if (!replayed.next(e2) || !e1.same_value(e2))
+      return 3;
+  return replayed.next(e2) ? 4 : 0;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 5;
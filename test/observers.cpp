@@ -0,0 +1,36 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fuzz.hpp"
+
+using namespace ramfuzz;
+
+int C::observed = 0;
+
+int main(int argc, char *argv[]) {
+  runtime::gen g(argc, argv);
+  using H = harness<C>;
+  static_assert(H::mcount == 5 && H::mutcount == 3, "wrong classification");
+  for (int i = 0; i < 100; ++i)
+    g.make<C>();
+  if (C::observed)
+    return 1;
+  // Observers come last in mroulette.
+  H h(g);
+  for (auto i = H::mutcount; i < H::mcount; ++i)
+    h.invoke_method(i);
+  return C::observed != 2;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 10;
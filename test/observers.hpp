@@ -0,0 +1,33 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Counts calls to its const methods, which RamFuzz shouldn't call while
+/// making a C.
+class C {
+  int sum = 0;
+
+public:
+  static int observed;
+  int get() const {
+    ++observed;
+    return sum;
+  }
+  bool empty() const {
+    ++observed;
+    return !sum;
+  }
+  void inc() { ++sum; }
+  void add(int x) { sum += x & 0xf; }
+  int data; ///< Public field; setting it is a mutation.
+};
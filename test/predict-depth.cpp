@@ -0,0 +1,56 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fuzz.hpp"
+
+using namespace ramfuzz;
+
+unsigned B::from_a;
+
+int main() {
+  runtime::linear_model m;
+  runtime::logentry e;
+  unsigned abandoned = 0, late = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    runtime::gen g(pass ? "fuzzlog2" : "fuzzlog1");
+    if (pass)
+      g.predict(m, 0.5);
+    for (int run = 0; run < 200; ++run) {
+      if (run)
+        g.restart();
+      const auto before = B::from_a;
+      try {
+        g.make<B>();
+      } catch (const runtime::abandoned &) {
+        ++abandoned;
+      }
+      // Abandoning more runs than the depth limit must not keep B's harness
+      // from recursing afterwards.
+      if (pass && abandoned >= runtime::depthlimit && B::from_a > before)
+        ++late;
+      if (pass || B::from_a == before)
+        continue;
+      // Predict success iff the A that B was made from got a non-negative
+      // argument.
+      runtime::logreader log("fuzzlog1");
+      while (log.next(e) && e.tag != runtime::typetag(0))
+        ;
+      m.set(e.loc, 0, 1);
+      break;
+    }
+  }
+  return !late;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 3;
@@ -0,0 +1,28 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Takes the int that predict-depth.cpp's model scores.
+class A {
+public:
+  A(int) {}
+};
+
+/// Making a B from an A recurses into A's harness, so runs abandoned while
+/// making that A unwind through B's.
+class B {
+public:
+  static unsigned from_a; ///< How many Bs were made from an A.
+  B() {}
+  B(const A &) { ++from_a; }
+};
@@ -0,0 +1,59 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fuzz.hpp"
+
+using namespace ramfuzz;
+using namespace std;
+
+vector<int> C::seen;
+
+int main() {
+  runtime::linear_model m;
+  runtime::logentry e;
+  unsigned abandoned = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    runtime::gen g(pass ? "fuzzlog2" : "fuzzlog1");
+    if (pass)
+      g.predict(m, 0.5);
+    C::seen.clear();
+    for (int run = 0; run < 20; ++run) {
+      if (run)
+        g.restart();
+      try {
+        g.make<C>();
+      } catch (const runtime::abandoned &) {
+        ++abandoned;
+      }
+    }
+    if (pass)
+      break;
+    // Predict success iff C's first constructor argument is non-negative.
+    runtime::logreader log("fuzzlog1");
+    while (log.next(e) && e.tag != runtime::typetag(0))
+      ;
+    m.set(e.loc, 0, 1);
+  }
+  for (int x : C::seen)
+    if (x < 0)
+      return 1;
+  // Each restart empties the log, leaving only the last run in it.
+  runtime::logreader log("fuzzlog2");
+  size_t args = 0;
+  for (runtime::logentry f; log.next(f);)
+    args += f.loc == e.loc;
+  return C::seen.empty() || !abandoned || args != 1;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 3;
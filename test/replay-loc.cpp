@@ -0,0 +1,50 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "fuzz.hpp"
+
+using namespace ramfuzz::runtime;
+using namespace std;
+
+/// Draws n values, preceded by one more if extra is true.  Returns the n values.
+vector<int> draw(gen &g, bool extra, size_t n) {
+  vector<int> vals;
+  if (extra)
+    g.between(0, 9);
+  for (size_t i = 0; i < n; ++i)
+    vals.push_back(g.between(0, 1000000));
+  return vals;
+}
+
+int main() {
+  vector<int> vals[2];
+  for (int pass = 0; pass < 2; ++pass) {
+    // The second pass replays the first one's log on "modified code" that
+    // draws an extra value first and more values at the end.
+    unique_ptr<gen> g(pass ? new gen("fuzzlog1", "fuzzlog2")
+                           : new gen("fuzzlog1"));
+    if (pass)
+      g->replay_by_location();
+    vals[pass] = draw(*g, pass, 20 + 5 * pass);
+  }
+  if (!equal(vals[0].cbegin(), vals[0].cend(), vals[1].cbegin()))
+    return 1;
+  return 0;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 5;
@@ -69,7 +69,9 @@ for case in glob(path.join(scriptdir, '*.hpp')):
     temp = tempfile.mkdtemp()
     shutil.copy(path.join(scriptdir, hfile), temp)
     shutil.copy(path.join(scriptdir, cfile), temp)
-    shutil.copy(path.join(rtdir, 'ramfuzz-rt.cpp'), temp)
+    for rtfile in glob(path.join(rtdir, 'ramfuzz-*')):
+        if not rtfile.endswith('ramfuzz-rt.hpp'):
+            shutil.copy(rtfile, temp)
     # Also copy ramfuzz-rt.hpp, but with lower depthlimit so tests don't take
     # forever:
     with open(path.join(rtdir, 'ramfuzz-rt.hpp')) as fsrc:
@@ -81,10 +83,10 @@ for case in glob(path.join(scriptdir, '*.hpp')):
         check_call([path.join(bindir, 'ramfuzz'), hfile, '--', '-std=c++11'])
         build_cmd = [
             path.join(bindir, 'clang++'), '-std=c++11', '-or', '-g', cfile,
-            'fuzz.cpp', 'ramfuzz-rt.cpp'
-        ]
+            'fuzz.cpp'
+        ] + [path.basename(f) for f in glob(path.join(rtdir, '*.cpp'))]
         if sys.platform != 'darwin':
-            build_cmd.append('-lunwind')
+            build_cmd += ['-lunwind', '-lrt']
         check_call(build_cmd)
         check_call(path.join(temp, 'r'))
         chdir(bindir)  # Just a precaution to guarantee rmtree success.
@@ -0,0 +1,33 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fuzz.hpp"
+
+using namespace ramfuzz;
+
+int C::nevers = 0;
+int C::rares = 0;
+int C::commons = 0;
+
+int main(int argc, char *argv[]) {
+  runtime::gen g(argc, argv);
+  static_assert(sizeof(harness<C>::walias) == 3 * sizeof(unsigned),
+                "observers shouldn't be in the alias table");
+  for (int i = 0; i < 1000; ++i)
+    g.make<C>();
+  // Expecting about 9 common() calls per rare() call.
+  return C::nevers || !C::rares || C::commons < 5 * C::rares;
+}
+
+unsigned ::ramfuzz::runtime::spinlimit = 10;
@@ -0,0 +1,24 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Counts calls to methods whose weights say how often RamFuzz should call
+/// them while making a C.
+class C {
+public:
+  static int nevers, rares, commons;
+  __attribute__((annotate("ramfuzz_weight=0"))) void never() { ++nevers; }
+  void rare() { ++rares; }
+  __attribute__((annotate("ramfuzz_weight=9"))) void common() { ++commons; }
+  int get() const { return rares; }
+};
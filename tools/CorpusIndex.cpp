@@ -0,0 +1,353 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CorpusIndex.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+
+using namespace ramfuzz;
+using namespace std;
+
+using runtime::file_error;
+using runtime::logentry;
+using runtime::logreader;
+
+namespace {
+
+/// Magic bytes at the beginning of every corpus-index file.
+constexpr char magic[4] = {'R', 'F', 'C', '1'};
+
+/// Bytes per Hit on disk: run, pos, tag, bits.  The location is implied by
+/// the directory.
+constexpr uint64_t hitsize = 4 + 4 + 1 + 8;
+
+/// True iff \p path may be a log: it's empty (a run that logged nothing), or
+/// its first entry has a known tag and fits in the file.  Rules out the text
+/// and binary files tools keep next to a corpus (models, fingerprint indexes,
+/// feature files), which begin with other bytes.
+bool looks_like_log(const string &path) {
+  ifstream f(path, ios::binary | ios::ate);
+  if (!f)
+    return false;
+  const auto size = uint64_t(f.tellg());
+  if (!size)
+    return true;
+  f.seekg(0);
+  const logentry first{char(f.get()), 0, 0};
+  return runtime::valsize(first.tag) && first.width() <= size;
+}
+
+/// Size of the file \p f, leaving it positioned at the start.
+uint64_t file_size(istream &f) {
+  f.seekg(0, ios::end);
+  const uint64_t size = f.tellg();
+  f.seekg(0);
+  return size;
+}
+
+/// True iff \p n items of \p width bytes fit in what's left of \p f, which is
+/// \p size bytes long.  Guards allocations sized by counts read from the file,
+/// which may be corrupt.
+bool fits(istream &f, uint64_t size, uint64_t n, uint64_t width) {
+  const auto pos = uint64_t(f.tellg());
+  return pos <= size && n <= (size - pos) / width;
+}
+
+template <typename T> void put(ostream &f, T x) {
+  f.write(reinterpret_cast<const char *>(&x), sizeof(x));
+}
+
+template <typename T> bool get(istream &f, T &x) {
+  return bool(f.read(reinterpret_cast<char *>(&x), sizeof(x)));
+}
+
+void put(ostream &f, const string &s) {
+  put(f, uint32_t(s.size()));
+  f.write(s.data(), s.size());
+}
+
+bool get(istream &f, string &s, uint64_t size) {
+  uint32_t len;
+  if (!get(f, len) || !fits(f, size, len, 1))
+    return false;
+  s.resize(len);
+  return len == 0 || f.read(&s[0], len);
+}
+
+void put(ostream &f, const Hit &h) {
+  put(f, h.run);
+  put(f, h.pos);
+  put(f, h.entry.tag);
+  put(f, h.entry.bits);
+}
+
+bool get(istream &f, Hit &h, size_t loc) {
+  h.entry.loc = loc;
+  return get(f, h.run) && get(f, h.pos) && get(f, h.entry.tag) &&
+         get(f, h.entry.bits);
+}
+
+/// Reads the run names and location directory that begin every index file,
+/// which is \p size bytes long.  Calls dirent(loc, first, count) for each
+/// directory entry.
+template <typename DirFn>
+bool read_header(istream &f, uint64_t size, vector<string> &runs,
+                 DirFn dirent) {
+  char m[sizeof(magic)];
+  if (!f.read(m, sizeof(m)) || !equal(m, m + sizeof(m), magic))
+    return false;
+  uint64_t count;
+  if (!get(f, count) || !fits(f, size, count, sizeof(uint32_t)))
+    return false;
+  runs.resize(count);
+  for (auto &r : runs)
+    if (!get(f, r, size))
+      return false;
+  if (!get(f, count))
+    return false;
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t loc, first, n;
+    if (!get(f, loc) || !get(f, first) || !get(f, n))
+      return false;
+    dirent(loc, first, n);
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+namespace ramfuzz {
+
+Label label(const string &logname) {
+  const auto sz = logname.size();
+  if (sz < 2 || logname[sz - 2] != '.')
+    return Label::unknown;
+  switch (logname.back()) {
+  case 's':
+    return Label::success;
+  case 'f':
+    return Label::failure;
+  default:
+    return Label::unknown;
+  }
+}
+
+vector<string> corpus_logs(const vector<string> &inputs,
+                           vector<string> &unscannable) {
+  vector<string> logs;
+  for (const auto &in : inputs) {
+    if (!llvm::sys::fs::is_directory(in)) {
+      logs.push_back(in);
+      continue;
+    }
+    vector<string> found;
+    error_code ec;
+    for (llvm::sys::fs::directory_iterator it(in, ec), end; it != end && !ec;
+         it.increment(ec)) {
+      const auto &path = it->path();
+      // Skip logindex files (see runtime::indexname()).
+      if (llvm::sys::fs::is_regular_file(path) &&
+          !llvm::StringRef(path).endswith(runtime::indexname("")) &&
+          looks_like_log(path))
+        found.push_back(path);
+    }
+    if (ec)
+      unscannable.push_back(in);
+    sort(found.begin(), found.end());
+    logs.insert(logs.end(), found.begin(), found.end());
+  }
+  return logs;
+}
+
+void tally(const vector<Hit> &hits, const vector<string> &runs, Histogram &h) {
+  for (const auto &hit : hits) {
+    auto &b = h[hit.entry.value()];
+    b.sample = hit.entry;
+    switch (label(runs[hit.run])) {
+    case Label::success:
+      ++b.success;
+      break;
+    case Label::failure:
+      ++b.failure;
+      break;
+    case Label::unknown:
+      ++b.unknown;
+      break;
+    }
+  }
+}
+
+size_t CorpusIndex::add(const vector<string> &logs, unsigned threads,
+                        vector<string> &unreadable) {
+  vector<string> fresh;
+  for (const auto &l : logs)
+    if (known.insert(l).second)
+      fresh.push_back(l);
+  // Each log is decoded independently into its own vector, then all vectors
+  // are merged in order.  That way, the result doesn't depend on threading.
+  vector<vector<Hit>> decoded(fresh.size());
+  vector<char> failed(fresh.size(), false);
+  atomic<size_t> next(0);
+  const auto work = [&]() {
+    for (size_t i; (i = next++) < fresh.size();) {
+      try {
+        logreader r(fresh[i]);
+        Hit h;
+        h.run = 0; // Assigned during merge.
+        for (h.pos = 0; r.next(h.entry); ++h.pos)
+          decoded[i].push_back(h);
+      } catch (const file_error &) {
+        failed[i] = true;
+      }
+    }
+  };
+  vector<thread> pool;
+  for (unsigned t = 1; t < threads; ++t)
+    pool.emplace_back(work);
+  work();
+  for (auto &t : pool)
+    t.join();
+  size_t added = 0;
+  for (size_t i = 0; i < fresh.size(); ++i) {
+    if (failed[i]) {
+      known.erase(fresh[i]);
+      unreadable.push_back(fresh[i]);
+      continue;
+    }
+    const auto run = uint32_t(runs_.size());
+    runs_.push_back(fresh[i]);
+    for (auto &h : decoded[i]) {
+      h.run = run;
+      postings[h.entry.loc].push_back(h);
+    }
+    ++added;
+  }
+  return added;
+}
+
+const vector<Hit> &CorpusIndex::hits(size_t loc) const {
+  static const vector<Hit> none;
+  const auto found = postings.find(loc);
+  return found == postings.end() ? none : found->second;
+}
+
+void CorpusIndex::save(const string &fname) const {
+  ofstream f(fname, ios::binary);
+  if (!f)
+    throw file_error("Cannot open " + fname);
+  f.write(magic, sizeof(magic));
+  put(f, uint64_t(runs_.size()));
+  for (const auto &r : runs_)
+    put(f, r);
+  vector<size_t> locs;
+  for (const auto &p : postings)
+    locs.push_back(p.first);
+  sort(locs.begin(), locs.end());
+  put(f, uint64_t(locs.size()));
+  uint64_t first = 0;
+  for (auto loc : locs) {
+    const auto n = postings.at(loc).size();
+    put(f, uint64_t(loc));
+    put(f, first);
+    put(f, uint64_t(n));
+    first += n;
+  }
+  for (auto loc : locs)
+    for (const auto &h : postings.at(loc))
+      put(f, h);
+  if (!f)
+    throw file_error("Cannot write " + fname);
+}
+
+bool CorpusIndex::load(const string &fname) {
+  ifstream f(fname, ios::binary);
+  const auto size = file_size(f);
+  CorpusIndex res;
+  vector<pair<size_t, uint64_t>> dir;
+  if (!read_header(f, size, res.runs_,
+                   [&dir](uint64_t loc, uint64_t, uint64_t n) {
+                     dir.emplace_back(loc, n);
+                   }))
+    return false;
+  for (const auto &d : dir) {
+    if (!fits(f, size, d.second, hitsize))
+      return false;
+    auto &hits = res.postings[d.first];
+    hits.resize(d.second);
+    for (auto &h : hits)
+      if (!get(f, h, d.first) || h.run >= res.runs_.size())
+        return false;
+  }
+  res.known.insert(res.runs_.cbegin(), res.runs_.cend());
+  *this = move(res);
+  return true;
+}
+
+CorpusIndexFile::CorpusIndexFile(const string &fname)
+    : file(fname, ios::binary) {
+  const auto size = file_size(file);
+  if (!read_header(file, size, runs_,
+                   [this](uint64_t loc, uint64_t first, uint64_t n) {
+                     directory.push_back({loc, first, n});
+                   }))
+    throw file_error("Cannot read corpus index " + fname);
+  hits_offset = file.tellg();
+  // Every extent must lie within the file, so hits() never allocates more
+  // than the file holds.
+  const auto nhits = (size - hits_offset) / hitsize;
+  for (const auto &e : directory)
+    if (e.first > nhits || e.count > nhits - e.first)
+      throw file_error("Corpus index is truncated");
+}
+
+const CorpusIndexFile::Extent *CorpusIndexFile::find(size_t loc) const {
+  const auto found = lower_bound(
+      directory.cbegin(), directory.cend(), loc,
+      [](const Extent &e, uint64_t loc) { return e.loc < loc; });
+  return found == directory.cend() || found->loc != loc ? nullptr : &*found;
+}
+
+vector<Hit> CorpusIndexFile::hits(size_t loc) {
+  vector<Hit> res;
+  const auto found = find(loc);
+  if (!found)
+    return res;
+  file.clear();
+  file.seekg(hits_offset + found->first * hitsize);
+  res.resize(found->count);
+  for (auto &h : res)
+    if (!get(file, h, loc))
+      throw file_error("Corpus index is truncated");
+  return res;
+}
+
+size_t CorpusIndexFile::count(size_t loc) const {
+  const auto found = find(loc);
+  return found ? found->count : 0;
+}
+
+vector<size_t> CorpusIndexFile::locations() const {
+  vector<size_t> locs;
+  for (const auto &e : directory)
+    locs.push_back(e.loc);
+  return locs;
+}
+
+} // namespace ramfuzz
@@ -0,0 +1,138 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../runtime/ramfuzz-log.hpp"
+
+namespace ramfuzz {
+
+/// One value logged at some location in some run of a corpus.
+struct Hit {
+  uint32_t run;             ///< Index of the run's log in the corpus.
+  uint32_t pos;             ///< Entry number within the run's log.
+  runtime::logentry entry;  ///< The logged entry.
+};
+
+/// Outcome of a run, as encoded in its log's name by ../ai/gencorp.py.
+enum class Label { success, failure, unknown };
+
+/// Returns the label of the run whose log is named \p logname: success for .s
+/// logs, failure for .f logs, and unknown otherwise.
+Label label(const std::string &logname);
+
+/// How many times each value was logged at a location, split by run label.
+struct HistogramBucket {
+  runtime::logentry sample; ///< An entry with this value.
+  size_t success = 0, failure = 0, unknown = 0;
+  size_t total() const { return success + failure + unknown; }
+};
+
+/// Maps a value to its bucket, in increasing order of the value.
+using Histogram = std::map<double, HistogramBucket>;
+
+/// The logs named by \p inputs, which are logs or directories of logs.
+/// Directories are scanned (non-recursively) and their regular files that look
+/// like logs added in lexicographic order.  Log indexes and files whose first
+/// bytes aren't a log entry are skipped, so models and other tools' files can
+/// be kept next to a corpus.  Directories that can't be scanned are appended
+/// to \p unscannable.
+std::vector<std::string> corpus_logs(const std::vector<std::string> &inputs,
+                                     std::vector<std::string> &unscannable);
+
+/// Adds \p hits to \p h, labelling them via \p runs.
+void tally(const std::vector<Hit> &hits, const std::vector<std::string> &runs,
+           Histogram &h);
+
+/// Inverted index of a corpus of RamFuzz logs: for each location, all values
+/// logged there and where.  Can be built incrementally, as new runs are added
+/// to the corpus.
+///
+/// On disk, the locations are sorted and precede the hits, so CorpusIndexFile
+/// can answer a query by reading only the hits it needs.
+class CorpusIndex {
+public:
+  /// Adds to the index all \p logs not already in it, decoding them in
+  /// \p threads parallel threads.  Logs that can't be opened are skipped and
+  /// appended to \p unreadable.  Returns how many logs were added.
+  size_t add(const std::vector<std::string> &logs, unsigned threads,
+             std::vector<std::string> &unreadable);
+
+  /// Names of all indexed logs.  A Hit's run field indexes this vector.
+  const std::vector<std::string> &runs() const { return runs_; }
+
+  /// All hits at location \p loc, ordered by run and position.
+  const std::vector<Hit> &hits(size_t loc) const;
+
+  /// Number of distinct locations in the index.
+  size_t locations() const { return postings.size(); }
+
+  /// Writes the index to file \p fname.  Throws runtime::file_error on failure.
+  void save(const std::string &fname) const;
+
+  /// Replaces *this with the index read from \p fname.  Returns false (leaving
+  /// *this unchanged) if the file can't be read or isn't a valid index.
+  bool load(const std::string &fname);
+
+private:
+  std::vector<std::string> runs_;
+  std::unordered_set<std::string> known; ///< Elements of runs_.
+  std::unordered_map<size_t, std::vector<Hit>> postings;
+};
+
+/// Read-only access to a CorpusIndex file that reads only the run names and
+/// the location directory up front, then reads the hits for each location on
+/// demand.  This keeps queries fast even when the index is huge.
+class CorpusIndexFile {
+public:
+  /// Opens the index file \p fname.  Throws runtime::file_error if the file
+  /// can't be read or isn't a valid index.
+  explicit CorpusIndexFile(const std::string &fname);
+
+  /// Names of all indexed logs.  A Hit's run field indexes this vector.
+  const std::vector<std::string> &runs() const { return runs_; }
+
+  /// All hits at location \p loc, ordered by run and position.
+  std::vector<Hit> hits(size_t loc);
+
+  /// Number of hits at location \p loc, without reading them.
+  size_t count(size_t loc) const;
+
+  /// All indexed locations, in increasing order.
+  std::vector<size_t> locations() const;
+
+private:
+  /// Where a location's hits are in the file.
+  struct Extent {
+    uint64_t loc, first, count;
+  };
+
+  /// The directory entry for \p loc, or null if there is none.
+  const Extent *find(size_t loc) const;
+
+  std::ifstream file;
+  std::vector<std::string> runs_;
+  std::vector<Extent> directory; ///< Sorted by loc.
+  uint64_t hits_offset;          ///< File offset of the first hit.
+};
+
+} // namespace ramfuzz
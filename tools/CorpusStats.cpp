@@ -0,0 +1,229 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CorpusStats.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <thread>
+#include <unordered_set>
+
+using namespace ramfuzz;
+using namespace std;
+
+using runtime::constraints;
+using runtime::file_error;
+using runtime::logentry;
+using runtime::logreader;
+
+namespace {
+
+/// Summarizes the sorted values \p v.
+ValueSummary summarize(const vector<double> &v) {
+  ValueSummary s;
+  s.count = v.size();
+  if (v.empty())
+    return s;
+  s.min = v.front();
+  s.max = v.back();
+  const double n = v.size();
+  s.mean = accumulate(v.cbegin(), v.cend(), 0.) / n;
+  if (!isfinite(s.mean)) // The sum overflowed; divide before adding.
+    s.mean = accumulate(v.cbegin(), v.cend(), 0.,
+                        [n](double sum, double x) { return sum + x / n; });
+  for (size_t i = 0; i < s.quantiles.size(); ++i) {
+    // Nearest rank.
+    const auto rank = size_t(ceil(quantile_points[i] * v.size()));
+    s.quantiles[i] = v[max<size_t>(rank, 1) - 1];
+  }
+  return s;
+}
+
+/// How many of the sorted values \p v are in [lo, hi), or in [lo, hi] if
+/// \p closed.
+size_t count_in(const vector<double> &v, double lo, double hi, bool closed) {
+  const auto first = lower_bound(v.cbegin(), v.cend(), lo);
+  const auto last = closed ? upper_bound(first, v.cend(), hi)
+                           : lower_bound(first, v.cend(), hi);
+  return last - first;
+}
+
+/// Edge \p b of \p bins equal-width bins spanning [lo, hi], even when
+/// hi - lo overflows.
+double edge(double lo, double hi, unsigned b, unsigned bins) {
+  if (b == bins)
+    return hi;
+  const double width = hi - lo, t = double(b) / bins;
+  return isfinite(width) ? lo + width * b / bins : lo * (1 - t) + hi * t;
+}
+
+/// Maximal ranges of values in the sorted \p ok that contain no value in the
+/// sorted \p bad, weighted by how many values of ok they contain.  Ranges
+/// weighing less than \p min_support are dropped.
+vector<constraints::range> separate(const vector<double> &ok,
+                                    const vector<double> &bad,
+                                    size_t min_support) {
+  vector<constraints::range> res;
+  constraints::range cur{0, 0, 0};
+  bool open = false;
+  const auto close = [&]() {
+    if (open && cur.weight >= min_support)
+      res.push_back(cur);
+    open = false;
+  };
+  size_t j = 0;
+  for (size_t i = 0; i < ok.size();) {
+    const double x = ok[i];
+    size_t n = 0;
+    for (; i < ok.size() && ok[i] == x; ++i)
+      ++n;
+    const auto j0 = j;
+    while (j < bad.size() && bad[j] < x)
+      ++j;
+    const bool hit = j < bad.size() && bad[j] == x;
+    if (j != j0 || hit)
+      close();
+    if (hit)
+      continue;
+    if (!open) {
+      cur = constraints::range{x, x, 0};
+      open = true;
+    }
+    cur.hi = x;
+    cur.weight += n;
+  }
+  close();
+  return res;
+}
+
+} // anonymous namespace
+
+namespace ramfuzz {
+
+constexpr unsigned CorpusStats::default_bins;
+
+size_t CorpusStats::add(const vector<string> &logs, unsigned threads,
+                        vector<string> &unreadable) {
+  // Each thread accumulates its own partial statistics, which are merged and
+  // sorted at the end.  Sorting makes the result independent of threading.
+  vector<unordered_map<size_t, Values>> partial(max(1u, threads));
+  vector<char> failed(logs.size(), false);
+  atomic<size_t> next(0);
+  const auto work = [&](unordered_map<size_t, Values> &acc) {
+    for (size_t i; (i = next++) < logs.size();) {
+      const auto lbl = label(logs[i]);
+      try {
+        logreader r(logs[i]);
+        for (logentry e; r.next(e);) {
+          auto &v = acc[e.loc];
+          v.tag = e.tag;
+          const auto val = e.value();
+          if (!isfinite(val))
+            continue;
+          (lbl == Label::success
+               ? v.success
+               : lbl == Label::failure ? v.failure : v.unknown)
+              .push_back(val);
+        }
+      } catch (const file_error &) {
+        failed[i] = true;
+      }
+    }
+  };
+  vector<thread> pool;
+  for (size_t t = 1; t < partial.size(); ++t)
+    pool.emplace_back(work, ref(partial[t]));
+  work(partial[0]);
+  for (auto &t : pool)
+    t.join();
+  const auto append = [](vector<double> &to, const vector<double> &from) {
+    to.insert(to.end(), from.cbegin(), from.cend());
+  };
+  unordered_set<size_t> touched;
+  for (const auto &p : partial)
+    for (const auto &l : p) {
+      auto &v = values[l.first];
+      v.tag = l.second.tag;
+      append(v.success, l.second.success);
+      append(v.failure, l.second.failure);
+      append(v.unknown, l.second.unknown);
+      touched.insert(l.first);
+    }
+  for (auto loc : touched) {
+    auto &v = values[loc];
+    for (auto *vec : {&v.success, &v.failure, &v.unknown})
+      sort(vec->begin(), vec->end());
+  }
+  size_t added = 0;
+  for (size_t i = 0; i < logs.size(); ++i)
+    if (failed[i])
+      unreadable.push_back(logs[i]);
+    else
+      ++added;
+  return added;
+}
+
+vector<size_t> CorpusStats::locations() const {
+  vector<size_t> locs;
+  for (const auto &l : values)
+    locs.push_back(l.first);
+  sort(locs.begin(), locs.end());
+  return locs;
+}
+
+LocationStats CorpusStats::stats(size_t loc, unsigned bins,
+                                 size_t min_support) const {
+  const auto &v = values.at(loc);
+  LocationStats s;
+  s.tag = v.tag;
+  s.success = summarize(v.success);
+  s.failure = summarize(v.failure);
+  s.unknown = summarize(v.unknown);
+  double lo = HUGE_VAL, hi = -HUGE_VAL;
+  for (const auto *vec : {&v.success, &v.failure, &v.unknown})
+    if (!vec->empty()) {
+      lo = min(lo, vec->front());
+      hi = max(hi, vec->back());
+    }
+  // A single value gets a single bin, and no values none.
+  if (lo == hi)
+    bins = min(bins, 1u);
+  else if (lo > hi)
+    bins = 0;
+  for (unsigned b = 0; b < bins; ++b) {
+    Bin bin;
+    bin.lo = edge(lo, hi, b, bins);
+    bin.hi = edge(lo, hi, b + 1, bins);
+    const bool last = b + 1 == bins;
+    bin.success = count_in(v.success, bin.lo, bin.hi, last);
+    bin.failure = count_in(v.failure, bin.lo, bin.hi, last);
+    bin.unknown = count_in(v.unknown, bin.lo, bin.hi, last);
+    s.histogram.push_back(bin);
+  }
+  s.valid = separate(v.success, v.failure, min_support);
+  return s;
+}
+
+constraints CorpusStats::intervals(size_t min_support) const {
+  constraints res;
+  for (auto loc : locations())
+    for (const auto &r : separate(values.at(loc).success,
+                                  values.at(loc).failure, min_support))
+      res.add(loc, r.lo, r.hi, r.weight);
+  return res;
+}
+
+} // namespace ramfuzz
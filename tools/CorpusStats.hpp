@@ -0,0 +1,91 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../runtime/ramfuzz-constraints.hpp"
+#include "CorpusIndex.hpp"
+
+namespace ramfuzz {
+
+/// Fractions at which ValueSummary reports quantiles.
+constexpr double quantile_points[] = {.05, .25, .5, .75, .95};
+
+/// Summary of the values logged at one location by the runs of one label.
+struct ValueSummary {
+  size_t count = 0;
+  double min = 0, max = 0, mean = 0;
+  /// Quantiles at quantile_points, in the same order.
+  std::array<double, sizeof(quantile_points) / sizeof(double)> quantiles{};
+};
+
+/// How many values fell into one bin of a location's histogram, by label.
+struct Bin {
+  double lo, hi; ///< Bin covers [lo, hi), except the last one covers [lo, hi].
+  size_t success = 0, failure = 0, unknown = 0;
+};
+
+/// Everything CorpusStats knows about one location.
+struct LocationStats {
+  char tag; ///< Type tag of the values (see runtime::type_name()).
+  ValueSummary success, failure, unknown;
+  std::vector<Bin> histogram;
+  /// Maximal ranges of values logged by successful runs and never by failed
+  /// ones, weighted by how many times successful runs logged them.
+  std::vector<runtime::constraints::range> valid;
+};
+
+/// Per-location statistics of a corpus of RamFuzz logs, split by run label.
+/// Unlike CorpusIndex, this doesn't remember where values were logged, only
+/// the values themselves, so it can take much larger corpuses.
+class CorpusStats {
+public:
+  static constexpr unsigned default_bins = 10;
+
+  /// Adds \p logs to the statistics, decoding them in \p threads parallel
+  /// threads.  Non-finite values are skipped, though their locations count
+  /// as seen.  Logs that can't be opened are skipped and appended to
+  /// \p unreadable.  Returns how many logs were added.
+  size_t add(const std::vector<std::string> &logs, unsigned threads,
+             std::vector<std::string> &unreadable);
+
+  /// All locations seen, in increasing order.
+  std::vector<size_t> locations() const;
+
+  /// Statistics of location \p loc, with a histogram of \p bins equal-width
+  /// bins.  Ranges of valid values with a weight below \p min_support are
+  /// omitted.  Throws std::out_of_range if loc wasn't seen.
+  LocationStats stats(size_t loc, unsigned bins = default_bins,
+                      size_t min_support = 1) const;
+
+  /// The valid ranges of all locations, in a form gen can be constrained by.
+  runtime::constraints intervals(size_t min_support = 1) const;
+
+private:
+  /// Values logged at one location, sorted.
+  struct Values {
+    char tag;
+    std::vector<double> success, failure, unknown;
+  };
+
+  std::unordered_map<size_t, Values> values;
+};
+
+} // namespace ramfuzz
@@ -0,0 +1,223 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Features.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CorpusIndex.hpp"
+
+using namespace ramfuzz;
+using namespace std;
+
+using runtime::file_error;
+using runtime::logentry;
+using runtime::logreader;
+
+namespace {
+
+/// Magic bytes at the beginning of every features file.
+constexpr char magic[4] = {'R', 'F', 'F', '1'};
+
+/// Size of a features file's header.
+constexpr size_t header_size = sizeof(magic) + 3 * 4 + 3 * 8;
+
+template <typename T> void put(ostream &f, T x) {
+  f.write(reinterpret_cast<const char *>(&x), sizeof(x));
+}
+
+template <typename T> void put(ostream &f, const vector<T> &v) {
+  f.write(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(T));
+}
+
+/// One run's features, before merging.
+struct Row {
+  char label;
+  vector<uint32_t> index;
+  vector<double> value;
+};
+
+/// The splitmix64 finalizer; spreads nearby inputs all over the output range.
+uint64_t mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+} // anonymous namespace
+
+namespace ramfuzz {
+
+uint32_t feature(size_t loc, unsigned occurrence, uint32_t dims) {
+  return mix(mix(loc) + occurrence) % dims;
+}
+
+Features extract(const vector<string> &logs, uint32_t dims,
+                 unsigned occurrences, unsigned threads,
+                 vector<string> &unreadable) {
+  Features res;
+  res.dims = dims ? dims : 1;
+  res.occurrences = occurrences ? occurrences : 1;
+  // As in CorpusIndex::add(), logs are decoded independently and merged in
+  // order, so the result doesn't depend on threading.
+  vector<Row> rows(logs.size());
+  vector<char> failed(logs.size(), false);
+  vector<set<FeatureKey>> keys(max(1u, threads));
+  atomic<size_t> next(0);
+  const auto work = [&](set<FeatureKey> &seen_keys) {
+    for (size_t i; (i = next++) < logs.size();) {
+      const auto lbl = label(logs[i]);
+      if (lbl == Label::unknown)
+        continue;
+      auto &row = rows[i];
+      row.label = lbl == Label::success;
+      try {
+        logreader r(logs[i]);
+        unordered_map<size_t, unsigned> seen;
+        for (logentry e; r.next(e);) {
+          const auto v = e.value();
+          auto &n = seen[e.loc];
+          const auto occurrence = min(n++, res.occurrences - 1);
+          if (!isfinite(v))
+            continue;
+          row.index.push_back(feature(e.loc, occurrence, res.dims));
+          row.value.push_back(v);
+          seen_keys.insert(FeatureKey{e.loc, occurrence});
+        }
+      } catch (const file_error &) {
+        failed[i] = true;
+      }
+    }
+  };
+  vector<thread> pool;
+  for (size_t t = 1; t < keys.size(); ++t)
+    pool.emplace_back(work, ref(keys[t]));
+  work(keys[0]);
+  for (auto &t : pool)
+    t.join();
+  for (size_t i = 0; i < logs.size(); ++i) {
+    if (failed[i]) {
+      unreadable.push_back(logs[i]);
+      continue;
+    }
+    if (label(logs[i]) == Label::unknown)
+      continue;
+    auto &row = rows[i];
+    res.index.insert(res.index.end(), row.index.cbegin(), row.index.cend());
+    res.value.insert(res.value.end(), row.value.cbegin(), row.value.cend());
+    res.rows.push_back(res.index.size());
+    res.label.push_back(row.label);
+    row = Row();
+  }
+  set<FeatureKey> all;
+  for (const auto &k : keys)
+    all.insert(k.cbegin(), k.cend());
+  res.keys.assign(all.cbegin(), all.cend());
+  return res;
+}
+
+void Features::save(const string &fname) const {
+  ofstream f(fname, ios::binary);
+  if (!f)
+    throw file_error("Cannot open " + fname);
+  f.write(magic, sizeof(magic));
+  put(f, dims);
+  put(f, uint32_t(occurrences));
+  put(f, uint32_t(0));
+  put(f, uint64_t(runs()));
+  put(f, uint64_t(index.size()));
+  put(f, uint64_t(keys.size()));
+  put(f, keys);
+  put(f, rows);
+  put(f, value);
+  put(f, index);
+  put(f, label);
+  if (!f)
+    throw file_error("Cannot write " + fname);
+}
+
+FeaturesFile::FeaturesFile(const string &fname) : map(MAP_FAILED) {
+  const int fd = open(fname.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw file_error("Cannot open " + fname);
+  struct stat st;
+  if (fstat(fd, &st) == 0 && size_t(st.st_size) >= header_size) {
+    mapsize = st.st_size;
+    map = mmap(nullptr, mapsize, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  const auto invalid = [this, &fname]() {
+    if (map != MAP_FAILED)
+      munmap(map, mapsize);
+    return file_error("Not a features file: " + fname);
+  };
+  if (map == MAP_FAILED)
+    throw invalid();
+  const auto base = static_cast<const char *>(map);
+  if (!equal(magic, magic + sizeof(magic), base))
+    throw invalid();
+  uint32_t head[3];
+  uint64_t counts[3];
+  memcpy(head, base + sizeof(magic), sizeof(head));
+  memcpy(counts, base + sizeof(magic) + sizeof(head), sizeof(counts));
+  m.dims = head[0];
+  m.occurrences = head[1];
+  m.runs = counts[0];
+  m.nnz = counts[1];
+  m.nkeys = counts[2];
+  // Sizes are checked piecewise so that absurd counts can't overflow.
+  auto left = mapsize - header_size;
+  auto at = base + header_size;
+  const auto take = [&left, &at](uint64_t n, size_t width) {
+    if (n > left / width)
+      return static_cast<const char *>(nullptr);
+    const auto p = at;
+    at += n * width;
+    left -= n * width;
+    return p;
+  };
+  m.keys = reinterpret_cast<const FeatureKey *>(
+      take(m.nkeys, sizeof(FeatureKey)));
+  m.rows = reinterpret_cast<const uint64_t *>(
+      m.keys && m.runs < UINT64_MAX ? take(m.runs + 1, 8) : nullptr);
+  m.value = reinterpret_cast<const double *>(m.rows ? take(m.nnz, 8) : nullptr);
+  m.index =
+      reinterpret_cast<const uint32_t *>(m.value ? take(m.nnz, 4) : nullptr);
+  m.label = m.index ? take(m.runs, 1) : nullptr;
+  if (!m.label || left || !m.dims || !m.occurrences || m.rows[0] ||
+      m.rows[m.runs] != m.nnz)
+    throw invalid();
+  for (size_t r = 0; r < m.runs; ++r)
+    if (m.rows[r] > m.rows[r + 1])
+      throw invalid();
+  for (size_t i = 0; i < m.nnz; ++i)
+    if (m.index[i] >= m.dims)
+      throw invalid();
+}
+
+FeaturesFile::~FeaturesFile() { munmap(map, mapsize); }
+
+} // namespace ramfuzz
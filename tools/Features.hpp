@@ -0,0 +1,119 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ramfuzz {
+
+/// Default number of hashed features.
+constexpr uint32_t default_dims = 1u << 20;
+
+/// Index of the feature of a value logged at location \p loc after
+/// \p occurrence others were logged there, among \p dims hashed features.
+uint32_t feature(size_t loc, unsigned occurrence, uint32_t dims);
+
+/// A (location, clipped occurrence) pair that some value's feature came from.
+struct FeatureKey {
+  uint64_t loc, occurrence;
+  bool operator<(const FeatureKey &that) const {
+    return loc < that.loc || (loc == that.loc && occurrence < that.occurrence);
+  }
+  bool operator==(const FeatureKey &that) const {
+    return loc == that.loc && occurrence == that.occurrence;
+  }
+};
+
+/// Read-only view of sparse feature vectors of labelled runs, one row per run,
+/// in compressed sparse row form.  Each value a run logs contributes one
+/// (index, value) pair to its row, at the index feature() gives.  Aligning
+/// values by location rather than by position in the log keeps a value's
+/// feature stable even when earlier choices in the run differ, and hashing
+/// bounds the number of features however many locations there are.
+struct FeatureMatrix {
+  uint32_t dims;
+  unsigned occurrences;  ///< Occurrences past this-1 are clipped to it.
+  size_t runs, nnz, nkeys;
+  const uint64_t *rows;  ///< Row i is at [rows[i], rows[i+1]); runs+1 long.
+  const uint32_t *index; ///< nnz long.
+  const double *value;   ///< nnz long.
+  const char *label;     ///< 1 for a successful run, 0 for a failed one.
+  const FeatureKey *keys; ///< All keys seen, sorted; nkeys long.
+};
+
+/// Feature vectors held in memory.
+struct Features {
+  uint32_t dims = default_dims;
+  unsigned occurrences = 1;
+  std::vector<uint64_t> rows{0};
+  std::vector<uint32_t> index;
+  std::vector<double> value;
+  std::vector<char> label;
+  std::vector<FeatureKey> keys;
+
+  size_t runs() const { return label.size(); }
+
+  /// A view of *this, valid until *this changes.
+  FeatureMatrix matrix() const {
+    return {dims,         occurrences,   runs(),        index.size(),
+            keys.size(),  rows.data(),   index.data(),  value.data(),
+            label.data(), keys.data()};
+  }
+
+  /// Writes *this into file \p fname in the format FeaturesFile reads.
+  /// Throws runtime::file_error on failure.
+  void save(const std::string &fname) const;
+};
+
+/// Features saved by Features::save(), mapped into memory rather than read,
+/// so nothing is copied, and several processes training on one file share its
+/// pages.
+///
+/// The file begins with a header of the magic bytes "RFF1", dims, occurrences,
+/// and a 0 (all uint32_t), then runs, nnz, and nkeys (all uint64_t).  The
+/// arrays follow in the order keys, rows, value, index, label, so each is
+/// aligned for its type.  Integers are in the host's byte order.  ../ai/
+/// rfutils.py can read the file into a scipy sparse matrix.
+class FeaturesFile {
+public:
+  /// Maps file \p fname and checks that its rows and indices are in range.
+  /// Throws runtime::file_error if it can't be read or isn't a valid features
+  /// file.
+  explicit FeaturesFile(const std::string &fname);
+  ~FeaturesFile();
+
+  FeaturesFile(const FeaturesFile &) = delete;
+  FeaturesFile &operator=(const FeaturesFile &) = delete;
+
+  const FeatureMatrix &matrix() const { return m; }
+
+private:
+  void *map;
+  size_t mapsize;
+  FeatureMatrix m;
+};
+
+/// Extracts features from \p logs, decoding them in \p threads parallel
+/// threads, into Features with the given \p dims and \p occurrences.  Logs
+/// without a .s or .f label are skipped, as are non-finite values.  Logs that
+/// can't be opened are appended to \p unreadable.
+Features extract(const std::vector<std::string> &logs, uint32_t dims,
+                 unsigned occurrences, unsigned threads,
+                 std::vector<std::string> &unreadable);
+
+} // namespace ramfuzz
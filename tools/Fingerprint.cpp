@@ -0,0 +1,187 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Fingerprint.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+using namespace ramfuzz;
+using namespace std;
+
+using runtime::file_error;
+using runtime::logentry;
+using runtime::logreader;
+
+namespace {
+
+/// The splitmix64 finalizer, as in Features.cpp.
+uint64_t mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+/// Sign and binary order of magnitude of \p v, with distinct buckets for 0,
+/// infinities, and NaN.
+uint64_t bucket(double v) {
+  if (std::isnan(v))
+    return 1;
+  const uint64_t sign = std::signbit(v) ? 1ull << 32 : 0;
+  if (std::isinf(v))
+    return sign | 2;
+  if (v == 0)
+    return 0;
+  return sign | uint64_t(std::ilogb(v) + 0x10000);
+}
+
+char letter(Label l) {
+  return l == Label::success ? 's' : l == Label::failure ? 'f' : 'u';
+}
+
+} // anonymous namespace
+
+namespace ramfuzz {
+
+void Fingerprinter::count(uint64_t h) {
+  for (unsigned b = 0; b < 64; ++b)
+    counts[b] += (h >> b & 1) ? 1 : -1;
+}
+
+void Fingerprinter::add(const logentry &e) {
+  count(mix(mix(prev) ^ e.loc));
+  count(mix(mix(e.loc) + (uint64_t(uint8_t(e.tag)) << 40) +
+            bucket(e.value())));
+  prev = e.loc;
+  path_ = mix(path_ ^ e.loc);
+}
+
+uint64_t Fingerprinter::value() const {
+  uint64_t res = 0;
+  for (unsigned b = 0; b < 64; ++b)
+    if (counts[b] > 0)
+      res |= 1ull << b;
+  return res;
+}
+
+unsigned distance(uint64_t a, uint64_t b) { return bitset<64>(a ^ b).count(); }
+
+vector<uint64_t> fingerprints(const vector<string> &logs, unsigned threads,
+                              vector<string> &unreadable,
+                              vector<uint64_t> *paths) {
+  vector<uint64_t> res(logs.size()), path(logs.size());
+  vector<char> failed(logs.size(), false);
+  atomic<size_t> next(0);
+  const auto work = [&]() {
+    for (size_t i; (i = next++) < logs.size();) {
+      try {
+        logreader r(logs[i]);
+        Fingerprinter f;
+        for (logentry e; r.next(e);)
+          f.add(e);
+        res[i] = f.value();
+        path[i] = f.path();
+      } catch (const file_error &) {
+        failed[i] = true;
+      }
+    }
+  };
+  vector<thread> pool;
+  for (unsigned t = 1; t < max(1u, threads); ++t)
+    pool.emplace_back(work);
+  work();
+  for (auto &t : pool)
+    t.join();
+  for (size_t i = 0; i < logs.size(); ++i)
+    if (failed[i])
+      unreadable.push_back(logs[i]);
+  if (paths)
+    *paths = move(path);
+  return res;
+}
+
+constexpr unsigned FingerprintIndex::default_distance;
+
+FingerprintIndex::FingerprintIndex(unsigned distance)
+    : distance_(min(distance, 63u)), blocks(distance_ + 1) {}
+
+uint64_t FingerprintIndex::key(uint64_t fp, Label l, unsigned b) const {
+  const unsigned lo = 64 * b / blocks.size(), hi = 64 * (b + 1) / blocks.size();
+  const uint64_t mask = hi - lo == 64 ? ~0ull : ((1ull << (hi - lo)) - 1) << lo;
+  return mix(fp & mask) + unsigned(l);
+}
+
+bool FingerprintIndex::contains(uint64_t fp, Label l) const {
+  for (unsigned b = 0; b < blocks.size(); ++b) {
+    const auto found = blocks[b].find(key(fp, l, b));
+    if (found == blocks[b].end())
+      continue;
+    for (auto i : found->second)
+      if (prints[i].second == l && ramfuzz::distance(prints[i].first, fp) <=
+                                       distance_)
+        return true;
+  }
+  return false;
+}
+
+void FingerprintIndex::add(uint64_t fp, Label l) {
+  for (unsigned b = 0; b < blocks.size(); ++b)
+    blocks[b][key(fp, l, b)].push_back(prints.size());
+  prints.emplace_back(fp, l);
+}
+
+bool FingerprintIndex::insert(uint64_t fp, Label l) {
+  if (contains(fp, l))
+    return false;
+  add(fp, l);
+  if (journal.is_open())
+    journal << hex << setw(16) << setfill('0') << fp << ' ' << letter(l)
+            << '\n';
+  return true;
+}
+
+void FingerprintIndex::open(const string &fname) {
+  ifstream f(fname);
+  unsigned lineno = 0;
+  for (string line; getline(f, line);) {
+    ++lineno;
+    istringstream is(line);
+    string fp, lbl, extra;
+    if (!(is >> fp) || fp[0] == '#')
+      continue;
+    uint64_t value;
+    istringstream fps(fp);
+    const bool ok = isxdigit(static_cast<unsigned char>(fp[0])) &&
+                    fps >> hex >> value && fps.eof() && is >> lbl &&
+                    lbl.size() == 1 && strchr("sfu", lbl[0]);
+    if (!ok || is >> extra)
+      throw file_error(fname + ":" + to_string(lineno) +
+                       ": expected <fingerprint> <s, f, or u>");
+    add(value, lbl[0] == 's' ? Label::success
+                             : lbl[0] == 'f' ? Label::failure : Label::unknown);
+  }
+  journal.close();
+  journal.open(fname, ios::app);
+  if (!journal)
+    throw file_error("Cannot open " + fname);
+}
+
+} // namespace ramfuzz
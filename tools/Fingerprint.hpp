@@ -0,0 +1,120 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../runtime/ramfuzz-log.hpp"
+#include "CorpusIndex.hpp"
+
+namespace ramfuzz {
+
+/// Computes a run's fingerprint, a 64-bit SimHash of its log: runs that take
+/// similar paths through the code with similar values get fingerprints that
+/// differ in few bits.  The hashed features are the pairs of consecutive
+/// locations in the log and, for each value, its location, type, sign, and
+/// binary order of magnitude.  So two runs logging the same locations in the
+/// same order, with values of the same magnitudes, get the same fingerprint.
+class Fingerprinter {
+public:
+  /// Adds the next entry of the log.
+  void add(const runtime::logentry &e);
+
+  /// The fingerprint of the entries added so far.
+  uint64_t value() const;
+
+  /// Hash of the exact sequence of locations added so far.
+  uint64_t path() const { return path_; }
+
+private:
+  /// Adds feature hash \p h to the bit counts.
+  void count(uint64_t h);
+
+  int64_t counts[64] = {};
+  size_t prev = 0;    ///< Location of the last entry added.
+  uint64_t path_ = 0;
+};
+
+/// Number of bits in which fingerprints \p a and \p b differ.
+unsigned distance(uint64_t a, uint64_t b);
+
+/// Fingerprints of the runs in \p logs, in order, decoded in \p threads
+/// parallel threads.  Logs that can't be opened get the fingerprint 0 and are
+/// appended to \p unreadable.  If \p paths isn't null, the runs' path() hashes
+/// are put into it.
+std::vector<uint64_t> fingerprints(const std::vector<std::string> &logs,
+                                   unsigned threads,
+                                   std::vector<std::string> &unreadable,
+                                   std::vector<uint64_t> *paths = nullptr);
+
+/// A set of run fingerprints, each with its run's label, that can tell if a
+/// new run nearly duplicates a run already in the set: if both have the same
+/// label and their fingerprints are within distance() bits.  Runs with
+/// different labels are never duplicates, as they tell what distinguishes
+/// success from failure.
+///
+/// Lookups split fingerprints into distance()+1 blocks of bits; fingerprints
+/// that close must agree on at least one block, so only fingerprints sharing
+/// a block need comparing.
+///
+/// On disk, the set is a text file with a line "<fingerprint in hex> <s, f, or
+/// u>" per run.  Blank lines and lines starting with '#' are ignored.
+class FingerprintIndex {
+public:
+  static constexpr unsigned default_distance = 3;
+
+  explicit FingerprintIndex(unsigned distance = default_distance);
+
+  /// How many bits a fingerprint may differ in from a near duplicate's.
+  unsigned distance() const { return distance_; }
+
+  /// True iff the set has a near duplicate of fingerprint \p fp with label
+  /// \p l.
+  bool contains(uint64_t fp, Label l) const;
+
+  /// Adds \p fp with label \p l, unless the set contains a near duplicate.
+  /// Returns true iff \p fp was added.  Added fingerprints are appended to the
+  /// file given to open(), if any.
+  bool insert(uint64_t fp, Label l);
+
+  /// Number of fingerprints in the set.
+  size_t size() const { return prints.size(); }
+
+  /// Adds all fingerprints in file \p fname, if it exists, and appends every
+  /// fingerprint added later to it.  Throws runtime::file_error if the file
+  /// can't be read or written or has a malformed line.
+  void open(const std::string &fname);
+
+private:
+  /// Adds \p fp without looking for near duplicates.
+  void add(uint64_t fp, Label l);
+
+  /// Key of block \p b of fingerprint \p fp with label \p l.
+  uint64_t key(uint64_t fp, Label l, unsigned b) const;
+
+  unsigned distance_;
+  std::vector<std::pair<uint64_t, Label>> prints;
+  /// For each block, the prints elements keyed by their key() for it.
+  std::vector<std::unordered_map<uint64_t, std::vector<size_t>>> blocks;
+  std::ofstream journal;
+};
+
+} // namespace ramfuzz
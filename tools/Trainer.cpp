@@ -0,0 +1,193 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Trainer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace ramfuzz;
+using namespace std;
+
+namespace {
+
+/// Weights over f's scaled features, plus the bias.
+struct Params {
+  vector<double> w;
+  double b = 0;
+};
+
+/// Inverse root mean square of each feature's values in \p f; 0 for features
+/// that are never nonzero.
+vector<double> scales(const FeatureMatrix &f) {
+  vector<SumSquares> sum(f.dims);
+  vector<double> count(f.dims);
+  for (size_t i = 0; i < f.nnz; ++i) {
+    sum[f.index[i]].add(f.value[i]);
+    ++count[f.index[i]];
+  }
+  vector<double> res(f.dims);
+  for (uint32_t j = 0; j < f.dims; ++j)
+    res[j] = sum[j].inverse_rms(count[j]);
+  return res;
+}
+
+/// Score of run \p r under weights \p w (which already include scaling) and
+/// bias \p b.
+double score(const FeatureMatrix &f, size_t r, const vector<double> &w,
+             double b) {
+  for (auto i = f.rows[r]; i < f.rows[r + 1]; ++i)
+    b += w[f.index[i]] * f.value[i];
+  return b;
+}
+
+/// One pass of SGD over runs order[first..last), updating \p p.
+void sgd(const FeatureMatrix &f, const vector<double> &scale,
+         const vector<size_t> &order, size_t first, size_t last, double rate,
+         Params &p) {
+  for (auto k = first; k < last; ++k) {
+    const auto r = order[k];
+    double z = p.b;
+    for (auto i = f.rows[r]; i < f.rows[r + 1]; ++i)
+      z += p.w[f.index[i]] * scale[f.index[i]] * f.value[i];
+    const double g = rate * (1. / (1. + exp(-z)) - f.label[r]);
+    p.b -= g;
+    for (auto i = f.rows[r]; i < f.rows[r + 1]; ++i)
+      p.w[f.index[i]] -= g * scale[f.index[i]] * f.value[i];
+  }
+}
+
+} // anonymous namespace
+
+namespace ramfuzz {
+
+void SumSquares::add(double v) {
+  v = fabs(v);
+  if (v > big) {
+    sum = sum * (big / v) * (big / v) + 1;
+    big = v;
+  } else if (v > 0)
+    sum += (v / big) * (v / big);
+}
+
+double SumSquares::inverse_rms(double count) const {
+  return big > 0 ? 1. / (big * sqrt(sum / count)) : 0;
+}
+
+runtime::linear_model train(const FeatureMatrix &f,
+                            const TrainOptions &opts, double &accuracy) {
+  const auto scale = scales(f);
+  const auto runs = f.runs;
+  const auto threads = size_t(max(1u, min(opts.threads, unsigned(runs))));
+  Params model;
+  model.w.resize(f.dims);
+  vector<size_t> order(runs);
+  iota(order.begin(), order.end(), 0);
+  mt19937_64 rng(opts.seed);
+  for (unsigned epoch = 0; epoch < opts.epochs; ++epoch) {
+    shuffle(order.begin(), order.end(), rng);
+    const double rate = opts.rate / sqrt(1. + epoch);
+    vector<Params> local(threads, model);
+    vector<thread> pool;
+    for (size_t t = 0; t < threads; ++t)
+      pool.emplace_back(sgd, cref(f), cref(scale), cref(order),
+                        runs * t / threads, runs * (t + 1) / threads, rate,
+                        ref(local[t]));
+    for (auto &t : pool)
+      t.join();
+    model = move(local[0]);
+    for (size_t t = 1; t < threads; ++t) {
+      for (uint32_t j = 0; j < f.dims; ++j)
+        model.w[j] += local[t].w[j];
+      model.b += local[t].b;
+    }
+    if (threads > 1) {
+      for (auto &w : model.w)
+        w /= threads;
+      model.b /= threads;
+    }
+  }
+  // Fold the scaling into the weights.
+  for (uint32_t j = 0; j < f.dims; ++j)
+    model.w[j] *= scale[j];
+  size_t right = 0;
+  for (size_t r = 0; r < runs; ++r)
+    right += (score(f, r, model.w, model.b) >= 0) == bool(f.label[r]);
+  accuracy = runs ? double(right) / runs : 0;
+  runtime::linear_model res;
+  res.bias(model.b);
+  res.occurrences(f.occurrences);
+  for (size_t k = 0; k < f.nkeys; ++k) {
+    const auto &key = f.keys[k];
+    const auto w = model.w[feature(key.loc, key.occurrence, f.dims)];
+    if (w != 0)
+      res.set(key.loc, key.occurrence, w);
+  }
+  return res;
+}
+
+void OnlineTrainer::learn(const vector<runtime::logentry> &log,
+                          bool success) {
+  // Update the statistics first, so no Weight moves while pointed to below.
+  vector<pair<size_t, unsigned>> feats;
+  vector<double> vals;
+  unordered_map<size_t, unsigned> seen;
+  for (const auto &e : log) {
+    const auto v = e.value();
+    const auto occurrence = min(seen[e.loc]++, occurrences - 1);
+    if (!isfinite(v))
+      continue;
+    auto &ws = weights[e.loc];
+    if (ws.size() <= occurrence)
+      ws.resize(occurrence + 1);
+    ws[occurrence].sumsq.add(v);
+    ++ws[occurrence].count;
+    feats.emplace_back(e.loc, occurrence);
+    vals.push_back(v);
+  }
+  vector<pair<Weight *, double>> x; // Features and their scaled values.
+  for (size_t i = 0; i < feats.size(); ++i) {
+    auto &w = weights[feats[i].first][feats[i].second];
+    x.emplace_back(&w, w.scale() * vals[i]);
+  }
+  double z = bias;
+  for (const auto &f : x)
+    z += f.first->w * f.second;
+  const double g = rate * (1. / (1. + exp(-z)) - success);
+  bias -= g;
+  for (const auto &f : x)
+    f.first->w -= g * f.second;
+  ++runs_;
+}
+
+runtime::linear_model OnlineTrainer::model() const {
+  runtime::linear_model res;
+  res.bias(bias);
+  res.occurrences(occurrences);
+  for (const auto &l : weights)
+    for (unsigned n = 0; n < l.second.size(); ++n) {
+      const auto w = l.second[n].w * l.second[n].scale();
+      if (w != 0)
+        res.set(l.first, n, w);
+    }
+  return res;
+}
+
+} // namespace ramfuzz
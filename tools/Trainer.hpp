@@ -0,0 +1,104 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "../runtime/ramfuzz-model.hpp"
+#include "Features.hpp"
+
+namespace ramfuzz {
+
+/// Sum of squares of a feature's values, kept relative to the largest
+/// magnitude seen so that neither huge nor tiny values over- or underflow it.
+class SumSquares {
+public:
+  void add(double v);
+
+  /// Inverse root mean square of the \p count values added; 0 if all were 0.
+  double inverse_rms(double count) const;
+
+private:
+  double big = 0; ///< Largest magnitude added.
+  double sum = 0; ///< Sum of squares of the values divided by big.
+};
+
+/// Knobs of train().
+struct TrainOptions {
+  unsigned epochs = 10;
+  double rate = .1;    ///< Learning rate of the first epoch.
+  unsigned threads = 1;
+  uint64_t seed = 0;   ///< Seeds the order in which runs are visited.
+};
+
+/// Trains a logistic-regression model predicting the labels of \p f's runs by
+/// stochastic gradient descent.  Puts the model's accuracy on \p f into
+/// \p accuracy.
+///
+/// Each feature is scaled by the inverse of its root mean square during
+/// training, so values of wildly different magnitudes train at the same pace;
+/// the returned weights have that scaling folded in.  Scaling doesn't center
+/// the features, which keeps every update as sparse as the run it learns
+/// from.
+///
+/// With several threads, each epoch runs SGD on disjoint slices of the runs in
+/// parallel, then averages the threads' models.  The result depends on the
+/// number of threads but is otherwise deterministic.
+runtime::linear_model train(const FeatureMatrix &f,
+                            const TrainOptions &opts, double &accuracy);
+
+/// Trains a logistic-regression model one run at a time, as runs finish,
+/// rather than in epochs over a corpus.  Features are (location, clipped
+/// occurrence) pairs as in train(), but kept exactly instead of hashed, and
+/// each is scaled by the inverse of its root mean square so far.  The learning
+/// rate stays constant, so the model keeps tracking the code under test as its
+/// behaviour (or the values generated for it) shift.
+class OnlineTrainer {
+public:
+  explicit OnlineTrainer(
+      unsigned occurrences = runtime::linear_model::default_occurrences,
+      double rate = .01)
+      : occurrences(occurrences ? occurrences : 1), rate(rate) {}
+
+  /// Takes one SGD step on a run that logged \p log and succeeded iff
+  /// \p success.  Non-finite values are skipped.
+  void learn(const std::vector<runtime::logentry> &log, bool success);
+
+  /// How many runs were learned from.
+  size_t runs() const { return runs_; }
+
+  /// The model learned so far, with the scaling folded into its weights.
+  runtime::linear_model model() const;
+
+private:
+  /// What's known about one feature.
+  struct Weight {
+    double w = 0;     ///< Weight over the scaled feature.
+    SumSquares sumsq; ///< Of the feature's values.
+    double count = 0; ///< How many values the feature had.
+    double scale() const { return sumsq.inverse_rms(count); }
+  };
+
+  unsigned occurrences;
+  double rate;
+  double bias = 0;
+  size_t runs_ = 0;
+  std::unordered_map<size_t, std::vector<Weight>> weights; ///< By location.
+};
+
+} // namespace ramfuzz
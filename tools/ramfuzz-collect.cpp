@@ -0,0 +1,477 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Collects RamFuzz logs from shared memory into a corpus directory.  The
+/// invocation syntax is
+///
+/// ramfuzz-collect -o <corpus dir> [--prefix=<ring prefix>] [--batch=N]
+///                 [--compress] [--learn=<model file> [--publish-every=N]
+///                 [--learn-rate=<r>]] [--dedup=<index file> [--distance=N]]
+///                 [--run=<exe> [-n <runs>] [-j <jobs>] [args]]
+///
+/// Fuzzing processes whose gen logs into "shm:<ring prefix>" (see
+/// ../runtime/ramfuzz-shm.hpp) write their logs into shared-memory rings
+/// instead of files.  This tool drains all such rings on the host and stores
+/// each finished log in the corpus directory, named like ../ai/gencorp.py does:
+/// <n>.s for successful runs, <n>.f for failed ones, and <n>.u when the outcome
+/// is unknown.  A run's outcome is what its gen's set_outcome() recorded or,
+/// failing that, its exit status (if this tool launched it).  A process that
+/// dies without closing its ring counts as failed.  Runs that their gen
+/// abandoned by restart() are discarded.
+///
+/// Finished logs are written to disk in batches of --batch logs (or sooner,
+/// when the rings are idle).  With --compress, each log is zlib-compressed and
+/// gets an extra ".z" suffix; such logs can be restored by
+/// `ramfuzz-collect --unpack <file.z> ...`.
+///
+/// With --learn, every run labelled successful or failed also trains a linear
+/// model of run outcomes (see OnlineTrainer in Trainer.hpp) as soon as it's
+/// collected.  Every --publish-every such runs, and once more on exit, the
+/// model is written to the --learn file, replacing it atomically.  Fuzzing
+/// processes whose gen follows that file (eg, because RAMFUZZ_MODEL names it;
+/// see ../runtime/ramfuzz-rt.hpp) pick up each new model at the start of
+/// their next run, without restarting.  Note that the model learns only from
+/// runs that weren't abandoned.
+///
+/// With --dedup, runs that nearly duplicate a run already in the corpus (see
+/// Fingerprint.hpp) aren't stored.  The fingerprints of stored runs are kept
+/// in the --dedup index file, which persists across invocations and which
+/// ramfuzz-dedup can extend to logs stored otherwise.  Duplicates still train
+/// the --learn model, so it sees how often each kind of run occurs.
+///
+/// With --run, the tool launches <exe> with the given args -n times, -j at a
+/// time, setting RAMFUZZ_LOG so gen(argc, argv) logs into shared memory, and
+/// exits once all runs are collected.  Otherwise, it collects rings until
+/// interrupted.  Either way, the rings' producers are throttled whenever this
+/// tool falls behind.
+///
+/// Requires /dev/shm, so it works only on Linux.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../runtime/ramfuzz-log.hpp"
+#include "../runtime/ramfuzz-shm.hpp"
+#include "Fingerprint.hpp"
+#include "Trainer.hpp"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Compression.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+namespace cl = llvm::cl;
+using namespace std;
+
+using ramfuzz::FingerprintIndex;
+using ramfuzz::Fingerprinter;
+using ramfuzz::Label;
+using ramfuzz::OnlineTrainer;
+using ramfuzz::runtime::file_error;
+using ramfuzz::runtime::logentry;
+using ramfuzz::runtime::shmreader;
+using ramfuzz::runtime::shmring;
+
+static cl::opt<string> Corpus("o", cl::desc("Corpus directory"),
+                              cl::value_desc("directory"));
+
+static cl::opt<string>
+    Prefix("prefix", cl::desc("Shared-memory name prefix of the rings"),
+           cl::init("/ramfuzz"));
+
+static cl::opt<unsigned>
+    Batch("batch", cl::desc("How many finished logs to write at once"),
+          cl::init(64));
+
+static cl::opt<bool> Compress("compress", cl::desc("Compress stored logs"));
+
+static cl::opt<bool> Unpack("unpack",
+                            cl::desc("Decompress the given .z logs and exit"));
+
+static cl::opt<string> Learn("learn",
+                             cl::desc("Model file to keep training and "
+                                      "publishing"),
+                             cl::value_desc("filename"));
+
+static cl::opt<unsigned>
+    PublishEvery("publish-every",
+                 cl::desc("How many learned runs between publications"),
+                 cl::init(100));
+
+static cl::opt<double> LearnRate("learn-rate",
+                                 cl::desc("Learning rate for --learn"),
+                                 cl::init(.01));
+
+static cl::opt<string> Dedup("dedup",
+                             cl::desc("Fingerprint index for dropping near "
+                                      "duplicates"),
+                             cl::value_desc("filename"));
+
+static cl::opt<unsigned>
+    Distance("distance",
+             cl::desc("Most bits a near duplicate's fingerprint differs in"),
+             cl::init(FingerprintIndex::default_distance));
+
+static cl::opt<string> Run("run", cl::desc("Program to launch repeatedly"),
+                           cl::value_desc("executable"));
+
+static cl::opt<unsigned> Runs("n", cl::desc("How many times to launch --run"),
+                              cl::init(1));
+
+static cl::opt<unsigned>
+    Jobs("j", cl::desc("How many --run processes to keep running"),
+         cl::init(thread::hardware_concurrency()));
+
+static cl::opt<unsigned>
+    Poll("poll-ms", cl::desc("Milliseconds to sleep when there's no work"),
+         cl::init(10));
+
+static cl::list<string> Args(cl::Positional,
+                             cl::desc("[<argument to --run program> ...]"));
+
+/// Set by SIGINT and SIGTERM.
+static volatile sig_atomic_t interrupted = 0;
+
+static void interrupt(int) { interrupted = 1; }
+
+namespace {
+
+/// A log being collected from its ring.
+struct Collecting {
+  unique_ptr<shmreader> ring;
+  string log;
+};
+
+/// A log fully collected and ready to be stored.
+struct Finished {
+  char label; ///< 's', 'f', or 'u'.
+  string log;
+};
+
+/// Stores finished logs in the corpus directory.
+class Store {
+public:
+  explicit Store(const string &dir) : dir(dir) {
+    // Continue numbering after the logs already in dir.
+    error_code ec;
+    for (llvm::sys::fs::directory_iterator it(dir, ec), end; it != end && !ec;
+         it.increment(ec)) {
+      const auto name = llvm::sys::path::filename(it->path()).str();
+      const auto dot = name.find('.');
+      if (dot == string::npos || dot + 1 == name.size())
+        continue;
+      const auto n = strtoul(name.c_str(), nullptr, 10);
+      auto &c = counters[name[dot + 1]];
+      c = max(c, n);
+    }
+  }
+
+  /// Writes \p logs into the corpus.  Throws file_error on failure.
+  void write(const vector<Finished> &logs) {
+    for (const auto &f : logs) {
+      auto name = dir + "/" + to_string(++counters[f.label]) + "." + f.label;
+      string compressed;
+      const string *data = &f.log;
+      if (Compress) {
+        name += ".z";
+        compressed = compress(f.log);
+        data = &compressed;
+      }
+      ofstream file(name, ios::binary);
+      file.write(data->data(), data->size());
+      if (!file)
+        throw file_error("Cannot write " + name);
+      ++stored[f.label];
+    }
+  }
+
+  /// How many logs with the given label this Store wrote.
+  size_t count(char label) const {
+    const auto found = stored.find(label);
+    return found == stored.end() ? 0 : found->second;
+  }
+
+  /// Returns s compressed, prefixed by its uncompressed size.
+  static string compress(const string &s) {
+    llvm::SmallVector<char, 0> z;
+    if (auto err = llvm::zlib::compress(s, z))
+      throw file_error(llvm::toString(move(err)));
+    const uint64_t size = s.size();
+    string res(reinterpret_cast<const char *>(&size), sizeof(size));
+    return res.append(z.begin(), z.end());
+  }
+
+private:
+  string dir;
+  map<char, unsigned long> counters; ///< Last number used for each label.
+  map<char, size_t> stored;
+};
+
+/// Decodes log bytes \p log into entries.  A malformed tail is dropped.
+vector<logentry> decode(const string &log) {
+  istringstream is(log);
+  vector<logentry> res;
+  for (logentry e; ramfuzz::runtime::read_entry(is, e);)
+    res.push_back(e);
+  return res;
+}
+
+/// Replaces each \p files element (ending in ".z") with its decompressed
+/// version, without the ".z".  Returns the exit status.
+int unpack(const vector<string> &files) {
+  int status = 0;
+  for (const auto &z : files) {
+    ifstream in(z, ios::binary);
+    const string data((istreambuf_iterator<char>(in)),
+                      istreambuf_iterator<char>());
+    uint64_t size;
+    llvm::SmallVector<char, 0> log;
+    if (z.size() < 3 || z.compare(z.size() - 2, 2, ".z") ||
+        data.size() < sizeof(size)) {
+      cerr << z << " is not a compressed log" << endl;
+      status = 1;
+      continue;
+    }
+    copy_n(data.data(), sizeof(size), reinterpret_cast<char *>(&size));
+    if (auto err = llvm::zlib::uncompress(data.substr(sizeof(size)), log,
+                                          size)) {
+      cerr << z << ": " << llvm::toString(move(err)) << endl;
+      status = 1;
+      continue;
+    }
+    const auto out = z.substr(0, z.size() - 2);
+    ofstream f(out, ios::binary);
+    f.write(log.data(), log.size());
+    if (!f) {
+      cerr << "Cannot write " << out << endl;
+      status = 1;
+      continue;
+    }
+    llvm::sys::fs::remove(z);
+  }
+  return status;
+}
+
+/// Launches Run with Args, logging into shared memory.  Returns the child's
+/// pid, or -1 on failure.
+pid_t launch() {
+  const pid_t pid = fork();
+  if (pid != 0)
+    return pid;
+  setenv("RAMFUZZ_LOG", ("shm:" + Prefix).c_str(), 1);
+  vector<char *> argv{const_cast<char *>(Run.c_str())};
+  for (const auto &a : Args)
+    argv.push_back(const_cast<char *>(a.c_str()));
+  argv.push_back(nullptr);
+  execv(argv[0], argv.data());
+  _exit(127);
+}
+
+/// True iff process pid no longer exists.
+bool gone(pid_t pid) { return kill(pid, 0) && errno == ESRCH; }
+
+} // anonymous namespace
+
+int main(int argc, const char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "RamFuzz log collector\n");
+  if (Unpack)
+    return unpack(Args);
+  if (Corpus.empty()) {
+    cerr << "Corpus directory (-o) is required" << endl;
+    return 1;
+  }
+  if (Prefix.empty() || Prefix[0] != '/' ||
+      Prefix.find('/', 1) != string::npos) {
+    cerr << "Prefix must begin with / and contain no other /" << endl;
+    return 1;
+  }
+  if (Compress && !llvm::zlib::isAvailable()) {
+    cerr << "Compression isn't available in this build" << endl;
+    return 1;
+  }
+  if (auto ec = llvm::sys::fs::create_directories(Corpus)) {
+    cerr << "Cannot create " << Corpus << ": " << ec.message() << endl;
+    return 1;
+  }
+  signal(SIGINT, interrupt);
+  signal(SIGTERM, interrupt);
+
+  Store store(Corpus);
+  const string ringstem = Prefix.substr(1) + ".";
+  map<string, Collecting> live; ///< Keyed by ring name.
+  set<pid_t> children;          ///< Launched and not yet reaped.
+  map<pid_t, int> exited;       ///< Exit status of reaped children.
+  vector<Finished> batch;
+  unsigned launched = 0;
+  size_t abandoned = 0, duplicates = 0;
+  int status = 0;
+  OnlineTrainer trainer(ramfuzz::runtime::linear_model::default_occurrences,
+                        LearnRate);
+  size_t published = 0; ///< trainer.runs() at the last publication.
+  FingerprintIndex seen(Distance);
+  if (!Dedup.empty()) {
+    try {
+      seen.open(Dedup);
+    } catch (const file_error &e) {
+      cerr << e.what() << endl;
+      return 1;
+    }
+  }
+
+  const auto publish = [&]() {
+    try {
+      trainer.model().save(Learn);
+      published = trainer.runs();
+    } catch (const file_error &e) {
+      cerr << e.what() << endl;
+      status = 1;
+    }
+  };
+
+  const auto flush = [&]() {
+    try {
+      store.write(batch);
+    } catch (const file_error &e) {
+      cerr << e.what() << endl;
+      status = 1;
+    }
+    batch.clear();
+  };
+
+  for (bool last = false; !last;) {
+    // Decide before sweeping, so the final sweep sees everything up to now.
+    last = interrupted || (!Run.empty() && launched == Runs &&
+                           children.empty() && live.empty());
+    bool busy = false;
+    if (!Run.empty() && !interrupted) {
+      int wstatus;
+      for (pid_t pid; !children.empty() &&
+                      (pid = waitpid(-1, &wstatus, WNOHANG)) > 0;) {
+        exited[pid] = wstatus;
+        children.erase(pid);
+      }
+      while (launched < Runs && children.size() < max(1u, unsigned(Jobs))) {
+        const auto pid = launch();
+        if (pid < 0) {
+          cerr << "Cannot launch " << Run << endl;
+          return 1;
+        }
+        children.insert(pid);
+        ++launched;
+      }
+    }
+
+    error_code ec;
+    for (llvm::sys::fs::directory_iterator it("/dev/shm", ec), end;
+         it != end && !ec; it.increment(ec)) {
+      const auto name = "/" + llvm::sys::path::filename(it->path()).str();
+      if (name.compare(1, ringstem.size(), ringstem) || live.count(name))
+        continue;
+      try {
+        live[name].ring.reset(new shmreader(name));
+      } catch (const file_error &) {
+        live.erase(name); // Not initialized yet; retry on the next sweep.
+      }
+    }
+
+    for (auto it = live.begin(); it != live.end();) {
+      auto &c = it->second;
+      const auto pid = c.ring->pid();
+      // Check closed() before draining, so nothing published before closing is
+      // missed.
+      const bool closed = c.ring->closed();
+      const bool dead = exited.count(pid) || gone(pid);
+      busy |= c.ring->drain(c.log) > 0;
+      const bool ours = children.count(pid) || exited.count(pid);
+      auto outcome = c.ring->outcome();
+      if (outcome == shmring::unknown && ours && !exited.count(pid) && !last) {
+        ++it; // Wait for the exit status.
+        continue;
+      }
+      if (!closed && !dead && !last) {
+        ++it;
+        continue;
+      }
+      if (outcome == shmring::abandoned) {
+        // The producer restarted the run; its log is worthless.
+        ++abandoned;
+        c.ring->unlink();
+        it = live.erase(it);
+        busy = true;
+        continue;
+      }
+      char label = 'u';
+      if (outcome == shmring::success)
+        label = 's';
+      else if (outcome == shmring::failure)
+        label = 'f';
+      else if (exited.count(pid))
+        label = WIFEXITED(exited[pid]) && WEXITSTATUS(exited[pid]) == 0
+                    ? 's'
+                    : 'f';
+      else if (!closed && dead)
+        label = 'f';
+      const auto entries =
+          Learn.empty() && Dedup.empty() ? vector<logentry>() : decode(c.log);
+      if (!Learn.empty() && label != 'u') {
+        trainer.learn(entries, label == 's');
+        if (trainer.runs() - published >= max(1u, unsigned(PublishEvery)))
+          publish();
+      }
+      bool keep = true;
+      if (!Dedup.empty()) {
+        Fingerprinter fp;
+        for (const auto &e : entries)
+          fp.add(e);
+        keep = seen.insert(fp.value(), ramfuzz::label(string(".") + label));
+      }
+      if (keep)
+        batch.push_back({label, move(c.log)});
+      else
+        ++duplicates;
+      c.ring->unlink();
+      it = live.erase(it);
+      busy = true;
+    }
+
+    if (batch.size() >= Batch || (!busy && !batch.empty()) || last)
+      flush();
+    if (!busy && !last)
+      this_thread::sleep_for(chrono::milliseconds(Poll));
+  }
+
+  if (!Learn.empty() && trainer.runs() != published)
+    publish();
+  cout << "Collected " << store.count('s') << " successful, "
+       << store.count('f') << " failed, and " << store.count('u')
+       << " unlabelled runs; discarded " << abandoned << " abandoned and "
+       << duplicates << " duplicate runs" << endl;
+  return status;
+}
@@ -0,0 +1,134 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Finds runs in a RamFuzz corpus that nearly duplicate earlier runs, and
+/// reports how diverse the corpus is.  The invocation syntax is
+///
+/// ramfuzz-dedup [-j <threads>] [-distance <bits>] [-index <file>] [-l]
+///               [-remove] <log or directory> ...
+///
+/// Runs are fingerprinted and compared as described in Fingerprint.hpp: a run
+/// is a near duplicate if an earlier run with the same label has a
+/// fingerprint within -distance bits of its own.  Logs are visited in the
+/// order given, with directories sorted.  With -index, the fingerprints in the
+/// index file (eg, one kept by `ramfuzz-collect --dedup`) count as earlier
+/// runs, and the fingerprints of runs found distinct are added to it.
+///
+/// With -l, prints the name of every near duplicate.  With -remove, deletes
+/// them.  Either way, finishes with a line per label giving the number of
+/// runs, the number of distinct ones, their ratio, and the number of distinct
+/// location sequences (paths through the code) among the runs.
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Fingerprint.hpp"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+
+namespace cl = llvm::cl;
+using namespace ramfuzz;
+using namespace std;
+
+static cl::opt<unsigned>
+    Threads("j", cl::desc("How many logs to decode in parallel"),
+            cl::init(thread::hardware_concurrency()));
+
+static cl::opt<unsigned>
+    Distance("distance",
+             cl::desc("Most bits a near duplicate's fingerprint differs in"),
+             cl::init(FingerprintIndex::default_distance));
+
+static cl::opt<string> Index("index",
+                             cl::desc("Fingerprint index to check and update"),
+                             cl::value_desc("filename"));
+
+static cl::opt<bool> List("l", cl::desc("Print the near duplicates' names"));
+
+static cl::opt<bool> Remove("remove", cl::desc("Delete the near duplicates"));
+
+static cl::list<string> Inputs(cl::Positional, cl::OneOrMore,
+                               cl::desc("<log or directory> ..."));
+
+namespace {
+
+/// Diversity counts of runs with one label.
+struct Diversity {
+  size_t runs = 0, distinct = 0;
+  set<uint64_t> paths;
+};
+
+} // anonymous namespace
+
+int main(int argc, const char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "RamFuzz corpus deduplicator\n");
+  vector<string> unscannable;
+  const auto logs = corpus_logs(Inputs, unscannable);
+  for (const auto &u : unscannable)
+    cerr << "Cannot scan " << u << endl;
+  FingerprintIndex index(Distance);
+  if (!Index.empty()) {
+    try {
+      index.open(Index);
+    } catch (const runtime::file_error &e) {
+      cerr << e.what() << endl;
+      return 1;
+    }
+  }
+  vector<string> unreadable;
+  vector<uint64_t> paths;
+  const auto prints =
+      fingerprints(logs, max(1u, unsigned(Threads)), unreadable, &paths);
+  for (const auto &u : unreadable)
+    cerr << "Cannot read " << u << endl;
+  const set<string> bad(unreadable.cbegin(), unreadable.cend());
+  map<Label, Diversity> div;
+  int status = unreadable.empty() && unscannable.empty() ? 0 : 2;
+  for (size_t i = 0; i < logs.size(); ++i) {
+    if (bad.count(logs[i]))
+      continue;
+    const auto l = label(logs[i]);
+    auto &d = div[l];
+    ++d.runs;
+    d.paths.insert(paths[i]);
+    if (index.insert(prints[i], l)) {
+      ++d.distinct;
+      continue;
+    }
+    if (List)
+      cout << logs[i] << '\n';
+    if (Remove)
+      if (auto ec = llvm::sys::fs::remove(logs[i])) {
+        cerr << "Cannot remove " << logs[i] << ": " << ec.message() << endl;
+        status = 1;
+      }
+  }
+  const pair<Label, const char *> names[] = {{Label::success, "success"},
+                                             {Label::failure, "failure"},
+                                             {Label::unknown, "unknown"}};
+  cout << "label runs distinct ratio paths\n";
+  for (const auto &n : names) {
+    const auto &d = div[n.first];
+    cout << n.second << ' ' << d.runs << ' ' << d.distinct << ' '
+         << setprecision(3) << (d.runs ? double(d.distinct) / d.runs : 0)
+         << ' ' << d.paths.size() << '\n';
+  }
+  return status;
+}
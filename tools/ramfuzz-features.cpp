@@ -0,0 +1,80 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Extracts features for training from a RamFuzz corpus into a file that
+/// trainers can map into memory.  The invocation syntax is
+///
+/// ramfuzz-features -o <features file> [-j <threads>] [-dims <n>]
+///                  [-occurrences <n>] <log or directory> ...
+///
+/// Each run labelled .s or .f becomes a sparse row, whose features are hashed
+/// from the locations of the values the run logged and their occurrences
+/// there (see Features.hpp).  ramfuzz-train -f trains on the file, and
+/// ../ai/rfutils.py reads it into a scipy sparse matrix.
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CorpusIndex.hpp"
+#include "../runtime/ramfuzz-model.hpp"
+#include "Features.hpp"
+#include "llvm/Support/CommandLine.h"
+
+namespace cl = llvm::cl;
+using namespace ramfuzz;
+using namespace std;
+
+static cl::opt<string> Output("o", cl::desc("Features file to write"),
+                              cl::value_desc("filename"), cl::Required);
+
+static cl::opt<unsigned>
+    Threads("j", cl::desc("How many logs to decode in parallel"),
+            cl::init(thread::hardware_concurrency()));
+
+static cl::opt<unsigned> Dims("dims", cl::desc("Number of hashed features"),
+                              cl::init(default_dims));
+
+static cl::opt<unsigned> Occurrences(
+    "occurrences",
+    cl::desc("Occurrences per location with distinct features"),
+    cl::init(runtime::linear_model::default_occurrences));
+
+static cl::list<string> Inputs(cl::Positional, cl::OneOrMore,
+                               cl::desc("<log or directory> ..."));
+
+int main(int argc, const char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "RamFuzz feature extractor\n");
+  vector<string> unscannable;
+  const auto logs = corpus_logs(Inputs, unscannable);
+  for (const auto &u : unscannable)
+    cerr << "Cannot scan " << u << endl;
+  vector<string> unreadable;
+  const auto features = extract(logs, Dims, Occurrences,
+                                max(1u, unsigned(Threads)), unreadable);
+  for (const auto &u : unreadable)
+    cerr << "Cannot read " << u << endl;
+  try {
+    features.save(Output);
+  } catch (const runtime::file_error &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  cout << "Extracted " << features.runs() << " runs with "
+       << features.index.size() << " values and " << features.keys.size()
+       << " distinct features" << endl;
+  return unreadable.empty() && unscannable.empty() ? 0 : 2;
+}
@@ -0,0 +1,91 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Answers queries about a RamFuzz corpus from the index built by
+/// ramfuzz-index.  The invocation syntax is
+///
+/// ramfuzz-grep -i <index file> [--histogram] <location> ...
+/// ramfuzz-grep -i <index file> --locations
+///
+/// Without options, prints every entry at the given locations in the same
+/// format as ../ai/loggrep.py: the log name, the 1-based entry number, and the
+/// (value, location) pair.  With --histogram, prints how many times each value
+/// was logged at each location, split by the run's label (.s or .f).  With
+/// --locations, prints all indexed locations and their hit counts.
+///
+/// Exit status is 0 if anything was found, 1 otherwise (like grep).
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "CorpusIndex.hpp"
+#include "llvm/Support/CommandLine.h"
+
+namespace cl = llvm::cl;
+using namespace ramfuzz;
+using namespace std;
+
+using runtime::print_value;
+
+static cl::opt<string> IndexFile("i", cl::desc("Index file to query"),
+                                 cl::value_desc("filename"), cl::Required);
+
+static cl::opt<bool>
+    Hist("histogram", cl::desc("Print value histograms instead of entries"));
+
+static cl::opt<bool> Locations("locations",
+                               cl::desc("List all locations in the index"));
+
+static cl::list<unsigned long long> Locs(cl::Positional,
+                                        cl::desc("<location> ..."));
+
+int main(int argc, const char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "RamFuzz corpus query\n");
+  size_t found = 0;
+  try {
+    CorpusIndexFile index(IndexFile);
+    const auto &runs = index.runs();
+    if (Locations) {
+      for (auto loc : index.locations()) {
+        cout << loc << ' ' << index.count(loc) << '\n';
+        ++found;
+      }
+    }
+    for (auto loc : Locs) {
+      const auto hits = index.hits(loc);
+      found += hits.size();
+      if (Hist) {
+        Histogram h;
+        tally(hits, runs, h);
+        cout << "location " << loc << ": value total success failure\n";
+        for (const auto &b : h) {
+          print_value(cout, b.second.sample)
+              << ' ' << b.second.total() << ' ' << b.second.success << ' '
+              << b.second.failure << '\n';
+        }
+      } else {
+        for (const auto &hit : hits) {
+          cout << runs[hit.run] << ':' << hit.pos + 1 << " (";
+          print_value(cout, hit.entry) << ", " << hit.entry.loc << ")\n";
+        }
+      }
+    }
+  } catch (const runtime::file_error &e) {
+    cerr << e.what() << endl;
+    return 2;
+  }
+  return found == 0;
+}
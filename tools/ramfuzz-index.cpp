@@ -0,0 +1,72 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Builds or updates an inverted index of a RamFuzz corpus, for fast queries
+/// by ramfuzz-grep.  The invocation syntax is
+///
+/// ramfuzz-index -o <index file> [-j <threads>] <log or directory> ...
+///
+/// Directories are scanned (non-recursively) for logs.  If the index file
+/// already exists, only logs not yet in it are decoded and added, so the index
+/// can be updated cheaply as new runs land in the corpus.
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CorpusIndex.hpp"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+
+namespace cl = llvm::cl;
+using namespace std;
+
+static cl::opt<string> IndexFile("o",
+                                 cl::desc("Index file to create or update"),
+                                 cl::value_desc("filename"), cl::Required);
+
+static cl::opt<unsigned>
+    Threads("j", cl::desc("How many logs to decode in parallel"),
+            cl::init(thread::hardware_concurrency()));
+
+static cl::list<string> Inputs(cl::Positional, cl::OneOrMore,
+                               cl::desc("<log or directory> ..."));
+
+int main(int argc, const char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "RamFuzz corpus indexer\n");
+  vector<string> unscannable;
+  const auto logs = ramfuzz::corpus_logs(Inputs, unscannable);
+  for (const auto &u : unscannable)
+    cerr << "Cannot scan " << u << endl;
+  ramfuzz::CorpusIndex index;
+  if (llvm::sys::fs::exists(IndexFile) && !index.load(IndexFile)) {
+    cerr << IndexFile << " is not a valid corpus index" << endl;
+    return 1;
+  }
+  vector<string> unreadable;
+  const auto added = index.add(logs, max(1u, unsigned(Threads)), unreadable);
+  for (const auto &u : unreadable)
+    cerr << "Cannot read " << u << endl;
+  try {
+    index.save(IndexFile);
+  } catch (const ramfuzz::runtime::file_error &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  cout << "Indexed " << added << " new logs; " << index.runs().size()
+       << " logs and " << index.locations() << " locations total" << endl;
+  return unreadable.empty() ? 0 : 2;
+}
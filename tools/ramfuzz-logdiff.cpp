@@ -0,0 +1,129 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Compares two RamFuzz logs entry by entry and reports where they diverge.
+/// The invocation syntax is
+///
+/// ramfuzz-logdiff [--context=N] [--ignore-locations] [--all] <log1> <log2>
+///
+/// Typical use is comparing a log with its replay: when a program uses
+/// gen(argc, argv) and is run with a log as its argument, it writes the replay
+/// log under the same name with "+" appended.  A correct replay produces an
+/// identical log, so the first divergence shows where the program's behavior
+/// started to differ.
+///
+/// Entries are aligned by position.  Two entries differ if their types, values,
+/// or locations differ (locations are skipped with --ignore-locations, eg, when
+/// comparing logs from different builds).  By default, only the first
+/// difference is reported, preceded by N matching entries (--context, default
+/// 3); --all reports every difference.
+///
+/// Exit status is 0 if the logs are identical, 1 if they differ, and 2 if a
+/// log can't be read.
+
+#include <deque>
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include "../runtime/ramfuzz-log.hpp"
+#include "llvm/Support/CommandLine.h"
+
+namespace cl = llvm::cl;
+using namespace std;
+
+using ramfuzz::runtime::file_error;
+using ramfuzz::runtime::logentry;
+using ramfuzz::runtime::logreader;
+using ramfuzz::runtime::print_value;
+using ramfuzz::runtime::type_name;
+
+static cl::opt<unsigned>
+    Context("context",
+            cl::desc("How many matching entries to print before a difference"),
+            cl::init(3));
+
+static cl::opt<bool>
+    IgnoreLocs("ignore-locations",
+               cl::desc("Compare only types and values, not locations"));
+
+static cl::opt<bool> All("all", cl::desc("Report all differences"));
+
+static cl::opt<string> Log1(cl::Positional, cl::Required,
+                            cl::desc("<log1>"));
+static cl::opt<string> Log2(cl::Positional, cl::Required,
+                            cl::desc("<log2>"));
+
+static void print(const logentry &e) {
+  cout << type_name(e.tag) << ' ';
+  print_value(cout, e) << " @ " << e.loc;
+}
+
+/// Prints entry n, which is e in both logs.
+static void print_same(size_t n, const logentry &e) {
+  cout << "  " << n << ": ";
+  print(e);
+  cout << '\n';
+}
+
+int main(int argc, const char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "RamFuzz log comparator\n");
+  try {
+    logreader r1(Log1), r2(Log2);
+    deque<pair<size_t, logentry>> context;
+    size_t diffs = 0;
+    logentry e1, e2;
+    for (size_t n = 0;; ++n) {
+      const bool has1 = r1.next(e1), has2 = r2.next(e2);
+      if (!has1 && !has2)
+        break;
+      if (has1 != has2) {
+        for (const auto &c : context)
+          print_same(c.first, c.second);
+        cout << "entry " << n << ": " << (has1 ? Log2 : Log1)
+             << " ends; the other log continues with ";
+        print(has1 ? e1 : e2);
+        cout << '\n';
+        ++diffs;
+        break;
+      }
+      if (e1.same_value(e2) && (IgnoreLocs || e1.loc == e2.loc)) {
+        if (Context && !All) {
+          context.emplace_back(n, e1);
+          if (context.size() > Context)
+            context.pop_front();
+        }
+        continue;
+      }
+      for (const auto &c : context)
+        print_same(c.first, c.second);
+      context.clear();
+      cout << "entry " << n << " differs ("
+           << (e1.same_value(e2) ? "location" : "value") << "):\n< ";
+      print(e1);
+      cout << "\n> ";
+      print(e2);
+      cout << '\n';
+      ++diffs;
+      if (!All)
+        break;
+    }
+    if (All && diffs)
+      cout << diffs << " differences\n";
+    return diffs != 0;
+  } catch (const file_error &err) {
+    cerr << err.what() << endl;
+    return 2;
+  }
+}
@@ -0,0 +1,130 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Dumps the contents of RamFuzz logs.  The invocation syntax is
+///
+/// ramfuzz-logdump [--format=text|csv|json] [--start=N] [--count=M]
+///                 [--loc=L] <log> ...
+///
+/// The text format matches ../ai/logdump.py: one (value, location) pair per
+/// line.  The csv format has a header line and the columns log, entry, type,
+/// value, location; the log name is quoted.  The json format is JSON Lines:
+/// one object per entry, with the same fields as csv.  Entry numbers start at
+/// 0.
+///
+/// --start and --count select a range of entries; if the log was indexed (see
+/// gen::index_log()), skipping to --start doesn't decode the entries before
+/// it.  --loc prints only the entries at location L.
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "../runtime/ramfuzz-log.hpp"
+#include "llvm/Support/CommandLine.h"
+
+namespace cl = llvm::cl;
+using namespace std;
+
+using ramfuzz::runtime::file_error;
+using ramfuzz::runtime::logentry;
+using ramfuzz::runtime::logreader;
+using ramfuzz::runtime::print_value;
+using ramfuzz::runtime::type_name;
+
+enum Format { text, csv, json };
+
+static cl::opt<Format>
+    Fmt("format", cl::desc("Output format"), cl::init(text),
+        cl::values(clEnumVal(text, "(value, location) per line"),
+                   clEnumVal(csv, "comma-separated values with a header"),
+                   clEnumVal(json, "JSON Lines")));
+
+static cl::opt<unsigned long long> Start("start",
+                                         cl::desc("First entry to dump"),
+                                         cl::init(0));
+
+static cl::opt<unsigned long long>
+    Count("count", cl::desc("How many entries to dump"),
+          cl::init(numeric_limits<unsigned long long>::max()));
+
+static cl::opt<unsigned long long> Loc("loc",
+                                       cl::desc("Dump only this location"));
+
+static cl::list<string> Logs(cl::Positional, cl::OneOrMore,
+                             cl::desc("<log> ..."));
+
+/// Prints e's value so that it's valid JSON.
+static void print_json_value(const logentry &e) {
+  const auto v = e.value();
+  if (std::isnan(v))
+    cout << "\"nan\"";
+  else if (std::isinf(v))
+    cout << (v > 0 ? "\"inf\"" : "\"-inf\"");
+  else
+    print_value(cout, e);
+}
+
+/// Prints entry number n of the log named name, which is e.
+static void dump(const string &name, size_t n, const logentry &e) {
+  switch (Fmt) {
+  case text:
+    cout << '(';
+    print_value(cout, e) << ", " << e.loc << ")\n";
+    break;
+  case csv:
+    // Quoted per RFC 4180, since log names may contain commas and quotes.
+    cout << '"';
+    for (char c : name)
+      cout << (c == '"' ? "\"" : "") << c;
+    cout << "\"," << n << ',' << type_name(e.tag) << ',';
+    print_value(cout, e) << ',' << e.loc << '\n';
+    break;
+  case json:
+    // Log names come from the command line, so only quotes and backslashes
+    // need escaping in practice.
+    cout << "{\"log\":\"";
+    for (char c : name)
+      cout << (c == '"' || c == '\\' ? "\\" : "") << c;
+    cout << "\",\"entry\":" << n << ",\"type\":\"" << type_name(e.tag)
+         << "\",\"value\":";
+    print_json_value(e);
+    cout << ",\"location\":" << e.loc << "}\n";
+    break;
+  }
+}
+
+int main(int argc, const char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "RamFuzz log dumper\n");
+  ios::sync_with_stdio(false);
+  if (Fmt == csv)
+    cout << "log,entry,type,value,location\n";
+  int status = 0;
+  for (const auto &name : Logs) {
+    try {
+      logreader r(name);
+      if (!r.seek(Start))
+        continue;
+      logentry e;
+      for (unsigned long long i = 0; i < Count && r.next(e); ++i)
+        if (Loc.getNumOccurrences() == 0 || e.loc == Loc)
+          dump(name, r.tell() - 1, e);
+    } catch (const file_error &err) {
+      cerr << err.what() << endl;
+      status = 1;
+    }
+  }
+  return status;
+}
@@ -0,0 +1,111 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Summarizes a RamFuzz corpus location by location, comparing the values
+/// logged by successful (.s) and failed (.f) runs.  The invocation syntax is
+///
+/// ramfuzz-stats [-j <threads>] [-bins <n>] [-min-support <n>]
+///               [-o <constraints file>] <log or directory> ...
+///
+/// For each location, prints the count, minimum, mean, quantiles, and maximum
+/// of the values logged there by each kind of run, followed by a histogram and
+/// the ranges of values that only successful runs logged.  With -o, also
+/// writes those ranges into a constraints file that gen can be steered with
+/// (see ../runtime/ramfuzz-constraints.hpp).  Only ranges logged at least
+/// min-support times are reported.
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CorpusStats.hpp"
+#include "llvm/Support/CommandLine.h"
+
+namespace cl = llvm::cl;
+using namespace ramfuzz;
+using namespace std;
+
+static cl::opt<unsigned>
+    Threads("j", cl::desc("How many logs to decode in parallel"),
+            cl::init(thread::hardware_concurrency()));
+
+static cl::opt<unsigned> Bins("bins", cl::desc("Histogram bins per location"),
+                              cl::init(CorpusStats::default_bins));
+
+static cl::opt<unsigned>
+    MinSupport("min-support",
+               cl::desc("Least weight of a reported range of valid values"),
+               cl::init(1));
+
+static cl::opt<string> Output("o",
+                              cl::desc("Constraints file to write valid "
+                                       "ranges into"),
+                              cl::value_desc("filename"));
+
+static cl::list<string> Inputs(cl::Positional, cl::OneOrMore,
+                               cl::desc("<log or directory> ..."));
+
+/// Prints one line of the report for the runs named \p what.
+static void print(const char *what, const ValueSummary &s) {
+  cout << "  " << what << ' ' << s.count;
+  if (s.count) {
+    cout << ' ' << s.min << ' ' << s.mean;
+    for (auto q : s.quantiles)
+      cout << ' ' << q;
+    cout << ' ' << s.max;
+  }
+  cout << '\n';
+}
+
+int main(int argc, const char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "RamFuzz corpus statistics\n");
+  vector<string> unscannable;
+  const auto logs = corpus_logs(Inputs, unscannable);
+  for (const auto &u : unscannable)
+    cerr << "Cannot scan " << u << endl;
+  CorpusStats stats;
+  vector<string> unreadable;
+  stats.add(logs, max(1u, unsigned(Threads)), unreadable);
+  for (const auto &u : unreadable)
+    cerr << "Cannot read " << u << endl;
+  cout << "label count min mean";
+  for (auto p : quantile_points)
+    cout << " q" << p;
+  cout << " max\n";
+  for (auto loc : stats.locations()) {
+    const auto s = stats.stats(loc, Bins, MinSupport);
+    cout << "location " << loc << " (" << runtime::type_name(s.tag) << ")\n";
+    print("success", s.success);
+    print("failure", s.failure);
+    print("unknown", s.unknown);
+    cout << "  histogram: lo hi success failure unknown\n";
+    for (const auto &b : s.histogram)
+      cout << "    " << b.lo << ' ' << b.hi << ' ' << b.success << ' '
+           << b.failure << ' ' << b.unknown << '\n';
+    cout << "  valid: lo hi weight\n";
+    for (const auto &r : s.valid)
+      cout << "    " << r.lo << ' ' << r.hi << ' ' << r.weight << '\n';
+  }
+  if (!Output.empty()) {
+    try {
+      stats.intervals(MinSupport).save(Output);
+    } catch (const runtime::file_error &e) {
+      cerr << e.what() << endl;
+      return 1;
+    }
+  }
+  return unreadable.empty() && unscannable.empty() ? 0 : 2;
+}
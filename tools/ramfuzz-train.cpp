@@ -0,0 +1,122 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Trains a linear model predicting the outcome of a run from the values it
+/// logs, natively and much faster than ../ai/sample-model2.py.  The invocation
+/// syntax is
+///
+/// ramfuzz-train -o <model file> [-j <threads>] [-epochs <n>] [-rate <r>]
+///               [-dims <n>] [-occurrences <n>] [-seed <n>]
+///               <log or directory> ...
+/// ramfuzz-train -o <model file> -f <features file> [-j <threads>]
+///               [-epochs <n>] [-rate <r>] [-seed <n>]
+///
+/// Only runs labelled .s or .f are trained on.  Values are hashed into dims
+/// features by their location and occurrence (see Features.hpp).  With -f,
+/// features are taken from a file written by ramfuzz-features instead of
+/// being extracted anew, which saves decoding the corpus for every training
+/// session.  The model is written in the format of
+/// ../runtime/ramfuzz-model.hpp, with effective weights over raw values.
+/// Prints the model's accuracy on the training runs.
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CorpusIndex.hpp"
+#include "Trainer.hpp"
+#include "llvm/Support/CommandLine.h"
+
+namespace cl = llvm::cl;
+using namespace ramfuzz;
+using namespace std;
+
+static cl::opt<string> Output("o", cl::desc("Model file to write"),
+                              cl::value_desc("filename"), cl::Required);
+
+static cl::opt<unsigned>
+    Threads("j", cl::desc("How many threads to decode and train with"),
+            cl::init(thread::hardware_concurrency()));
+
+static cl::opt<unsigned> Epochs("epochs", cl::desc("Passes over the runs"),
+                                cl::init(TrainOptions().epochs));
+
+static cl::opt<double> Rate("rate", cl::desc("Initial learning rate"),
+                            cl::init(TrainOptions().rate));
+
+static cl::opt<unsigned> Dims("dims", cl::desc("Number of hashed features"),
+                              cl::init(default_dims));
+
+static cl::opt<unsigned> Occurrences(
+    "occurrences",
+    cl::desc("Occurrences per location with distinct weights"),
+    cl::init(runtime::linear_model::default_occurrences));
+
+static cl::opt<unsigned long long>
+    Seed("seed", cl::desc("Seed for the order of training runs"),
+         cl::init(0));
+
+static cl::opt<string> FeaturesName("f",
+                                    cl::desc("Features file to train on"),
+                                    cl::value_desc("filename"));
+
+static cl::list<string> Inputs(cl::Positional, cl::ZeroOrMore,
+                               cl::desc("<log or directory> ..."));
+
+int main(int argc, const char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "RamFuzz model trainer\n");
+  if (FeaturesName.empty() == Inputs.empty()) {
+    cerr << "Give either -f or logs to train on" << endl;
+    return 1;
+  }
+  const auto threads = max(1u, unsigned(Threads));
+  Features extracted;
+  unique_ptr<FeaturesFile> mapped;
+  vector<string> unscannable, unreadable;
+  try {
+    if (FeaturesName.empty()) {
+      const auto logs = corpus_logs(Inputs, unscannable);
+      extracted = extract(logs, Dims, Occurrences, threads, unreadable);
+    } else {
+      mapped.reset(new FeaturesFile(FeaturesName));
+    }
+  } catch (const runtime::file_error &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  for (const auto &u : unscannable)
+    cerr << "Cannot scan " << u << endl;
+  for (const auto &u : unreadable)
+    cerr << "Cannot read " << u << endl;
+  const auto &features = mapped ? mapped->matrix() : extracted.matrix();
+  TrainOptions opts;
+  opts.epochs = Epochs;
+  opts.rate = Rate;
+  opts.threads = threads;
+  opts.seed = Seed;
+  double accuracy;
+  const auto model = train(features, opts, accuracy);
+  try {
+    model.save(Output);
+  } catch (const runtime::file_error &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  cout << "Trained on " << features.runs << " runs; accuracy " << accuracy
+       << endl;
+  return unreadable.empty() && unscannable.empty() ? 0 : 2;
+}
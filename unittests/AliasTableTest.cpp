@@ -0,0 +1,62 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "ramfuzz/lib/AliasTable.hpp"
+
+namespace {
+
+using namespace ramfuzz;
+using namespace std;
+using namespace testing;
+
+/// How much of the table's total mass (scale per row) goes to each index.
+vector<unsigned> mass(const AliasTable &t) {
+  vector<unsigned> m(t.prob.size());
+  for (size_t i = 0; i < t.prob.size(); ++i) {
+    m[i] += t.prob[i];
+    m[t.alias[i]] += AliasTable::scale - t.prob[i];
+  }
+  return m;
+}
+
+constexpr unsigned S = AliasTable::scale;
+
+TEST(AliasTableTest, Uniform) {
+  const AliasTable t({2., 2., 2.});
+  EXPECT_EQ((vector<unsigned>{S, S, S}), t.prob);
+  EXPECT_EQ((vector<unsigned>{S, S, S}), mass(t));
+}
+
+TEST(AliasTableTest, Skewed) {
+  const AliasTable t({1., 3.});
+  EXPECT_EQ((vector<unsigned>{S / 2, S * 3 / 2}), mass(t));
+}
+
+TEST(AliasTableTest, Zero) {
+  const AliasTable t({1., 0., 3., 0.});
+  EXPECT_EQ((vector<unsigned>{S, 0, 3 * S, 0}), mass(t));
+}
+
+TEST(AliasTableTest, Uneven) {
+  const vector<double> w{5., 1., 1., 7., 0.5, 2.5};
+  const auto m = mass(AliasTable(w));
+  for (size_t i = 0; i < w.size(); ++i)
+    EXPECT_NEAR(w[i] / 17. * w.size() * S, m[i], w.size()) << i;
+}
+
+} // anonymous namespace
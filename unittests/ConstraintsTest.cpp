@@ -0,0 +1,78 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include "ramfuzz/runtime/ramfuzz-constraints.hpp"
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using namespace ramfuzz::runtime;
+using namespace std;
+using namespace testing;
+
+/// Creates files in a fresh temporary directory.
+class ConstraintsTest : public ramfuzz::test::TempDirTest {
+protected:
+  ConstraintsTest() : TempDirTest("constraints") {}
+};
+
+TEST_F(ConstraintsTest, Load) {
+  constraints c;
+  c.load(file("c", "# Comment.\n"
+                   "\n"
+                   "12 -1.5 3\n"
+                   "12 7 7 0.25\n"
+                   "  34\t0 1e3 2  \n"));
+  ASSERT_NE(nullptr, c.at(12));
+  ASSERT_EQ(2u, c.at(12)->size());
+  EXPECT_EQ(-1.5, (*c.at(12))[0].lo);
+  EXPECT_EQ(3, (*c.at(12))[0].hi);
+  EXPECT_EQ(1, (*c.at(12))[0].weight);
+  EXPECT_EQ(0.25, (*c.at(12))[1].weight);
+  ASSERT_NE(nullptr, c.at(34));
+  EXPECT_EQ(1000, (*c.at(34))[0].hi);
+  EXPECT_EQ(nullptr, c.at(56));
+}
+
+TEST_F(ConstraintsTest, Malformed) {
+  constraints c;
+  c.add(1, 0, 0);
+  for (const auto bad : {"12\n", "12 1\n", "x 1 2\n", "12 3 2\n", "12 1 2 -1\n",
+                         "12 1 2 3 4\n", "12 1 2 x\n", "-12 1 2\n"})
+    EXPECT_THROW(c.load(file("c", bad)), file_error) << bad;
+  EXPECT_THROW(c.load(dir + "/nonexistent"), file_error);
+  EXPECT_EQ(1u, c.all().size());
+}
+
+TEST_F(ConstraintsTest, SaveAndLoad) {
+  constraints c;
+  c.add(18446744073709551615u, 0.1, 1. / 3, 7);
+  c.add(5, -2, -2);
+  const auto fname = dir + "/saved";
+  c.save(fname);
+  constraints back;
+  back.load(fname);
+  ASSERT_NE(nullptr, back.at(18446744073709551615u));
+  EXPECT_EQ(1. / 3, (*back.at(18446744073709551615u))[0].hi);
+  EXPECT_EQ(7, (*back.at(18446744073709551615u))[0].weight);
+  ASSERT_NE(nullptr, back.at(5));
+  EXPECT_EQ(-2, (*back.at(5))[0].lo);
+}
+
+} // anonymous namespace
@@ -0,0 +1,169 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ramfuzz/tools/CorpusIndex.hpp"
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using namespace ramfuzz;
+using namespace std;
+using namespace testing;
+
+using ramfuzz::test::ient;
+
+/// Creates files in a fresh temporary directory.
+class CorpusIndexTest : public ramfuzz::test::TempDirTest {
+protected:
+  CorpusIndexTest() : TempDirTest("corpus") {}
+
+  /// Positions of the hits, as (run, pos) pairs.
+  static vector<pair<uint32_t, uint32_t>> where(const vector<Hit> &hits) {
+    vector<pair<uint32_t, uint32_t>> res;
+    for (const auto &h : hits)
+      res.emplace_back(h.run, h.pos);
+    return res;
+  }
+};
+
+using Where = vector<pair<uint32_t, uint32_t>>;
+
+TEST_F(CorpusIndexTest, Empty) {
+  CorpusIndex idx;
+  vector<string> bad;
+  EXPECT_EQ(0u, idx.add({}, 4, bad));
+  EXPECT_TRUE(idx.hits(123).empty());
+}
+
+TEST_F(CorpusIndexTest, HitsInRunOrder) {
+  const auto a = log("0.s", {ient(1, 10), ient(2, 20), ient(3, 10)});
+  const auto b = log("0.f", {ient(4, 20), ient(5, 10)});
+  CorpusIndex idx;
+  vector<string> bad;
+  EXPECT_EQ(2u, idx.add({a, b}, 3, bad));
+  EXPECT_TRUE(bad.empty());
+  EXPECT_EQ((vector<string>{a, b}), idx.runs());
+  EXPECT_EQ((Where{{0, 0}, {0, 2}, {1, 1}}), where(idx.hits(10)));
+  EXPECT_EQ((Where{{0, 1}, {1, 0}}), where(idx.hits(20)));
+  EXPECT_EQ(5, idx.hits(10)[2].entry.as<int>());
+}
+
+TEST_F(CorpusIndexTest, Incremental) {
+  const auto a = log("0.s", {ient(1, 10)});
+  const auto b = log("1.s", {ient(2, 10)});
+  CorpusIndex idx;
+  vector<string> bad;
+  EXPECT_EQ(1u, idx.add({a}, 1, bad));
+  EXPECT_EQ(1u, idx.add({a, b}, 1, bad));
+  EXPECT_EQ(0u, idx.add({b, a}, 1, bad));
+  EXPECT_EQ((Where{{0, 0}, {1, 0}}), where(idx.hits(10)));
+}
+
+TEST_F(CorpusIndexTest, Unreadable) {
+  const auto a = log("0.s", {ient(1, 10)});
+  CorpusIndex idx;
+  vector<string> bad;
+  EXPECT_EQ(1u, idx.add({dir + "/nonexistent", a}, 2, bad));
+  EXPECT_EQ((vector<string>{dir + "/nonexistent"}), bad);
+  EXPECT_EQ((vector<string>{a}), idx.runs());
+}
+
+TEST_F(CorpusIndexTest, SaveAndQuery) {
+  const auto a = log("0.s", {ient(1, 30), ient(2, 20), ient(3, 10)});
+  const auto b = log("0.f", {ient(4, 20)});
+  CorpusIndex idx;
+  vector<string> bad;
+  idx.add({a, b}, 2, bad);
+  const auto fname = dir + "/index";
+  idx.save(fname);
+
+  CorpusIndexFile file(fname);
+  EXPECT_EQ(idx.runs(), file.runs());
+  EXPECT_EQ((vector<size_t>{10, 20, 30}), file.locations());
+  EXPECT_EQ((Where{{0, 1}, {1, 0}}), where(file.hits(20)));
+  EXPECT_EQ(4, file.hits(20)[1].entry.as<int>());
+  EXPECT_TRUE(file.hits(15).empty());
+  EXPECT_EQ(2u, file.count(20));
+  EXPECT_EQ(0u, file.count(15));
+
+  CorpusIndex loaded;
+  ASSERT_TRUE(loaded.load(fname));
+  EXPECT_EQ(0u, loaded.add({a, b}, 1, bad));
+  EXPECT_EQ(where(idx.hits(30)), where(loaded.hits(30)));
+}
+
+TEST_F(CorpusIndexTest, Corrupt) {
+  // Counts far beyond what the file holds must be rejected, not allocated.
+  const auto index = [this](const vector<uint64_t> &words) {
+    string s("RFC1");
+    for (auto w : words)
+      s.append(reinterpret_cast<const char *>(&w), sizeof(w));
+    return file("index", s);
+  };
+  const uint64_t huge = uint64_t(1) << 40;
+  for (const auto &words : {vector<uint64_t>{huge},
+                            vector<uint64_t>{0, 1, 10, 0, huge},
+                            vector<uint64_t>{0, 1, 10, huge, 1}}) {
+    const auto fname = index(words);
+    CorpusIndex idx;
+    EXPECT_FALSE(idx.load(fname));
+    EXPECT_THROW(CorpusIndexFile{fname}, runtime::file_error);
+  }
+}
+
+TEST_F(CorpusIndexTest, Histogram) {
+  const auto a = log("0.s", {ient(7, 10), ient(7, 10)});
+  const auto b = log("0.f", {ient(7, 10), ient(-1, 10)});
+  CorpusIndex idx;
+  vector<string> bad;
+  idx.add({a, b}, 1, bad);
+  Histogram h;
+  tally(idx.hits(10), idx.runs(), h);
+  ASSERT_EQ(2u, h.size());
+  EXPECT_EQ(1u, h[-1].failure);
+  EXPECT_EQ(2u, h[7].success);
+  EXPECT_EQ(1u, h[7].failure);
+  EXPECT_EQ(3u, h[7].total());
+}
+
+TEST_F(CorpusIndexTest, CorpusLogsSkipNonLogs) {
+  const auto a = log("0.s", {ient(1, 10)});
+  const auto b = log("1.f", {});
+  runtime::logindex idx;
+  idx.add(10, 0, ient(1, 10).width());
+  idx.save(runtime::indexname(a));
+  ofstream(dir + "/model") << "bias 0.5\n";
+  ofstream(dir + "/dedup") << "0123456789abcdef s\n";
+  ofstream(dir + "/short", ios::binary) << char(5) << "xy";
+  vector<string> bad;
+  EXPECT_EQ((vector<string>{a, b}), corpus_logs({dir}, bad));
+  EXPECT_TRUE(bad.empty());
+}
+
+TEST(LabelTest, Suffixes) {
+  EXPECT_EQ(Label::success, label("dir/12.s"));
+  EXPECT_EQ(Label::failure, label("12.f"));
+  EXPECT_EQ(Label::unknown, label("fuzzlog"));
+  EXPECT_EQ(Label::unknown, label("s"));
+}
+
+} // anonymous namespace
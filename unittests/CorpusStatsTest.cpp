@@ -0,0 +1,163 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "ramfuzz/tools/CorpusStats.hpp"
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using namespace ramfuzz;
+using namespace std;
+using namespace testing;
+
+using runtime::constraints;
+using ramfuzz::test::dent;
+using ramfuzz::test::ient;
+
+/// Ranges as (lo, hi, weight) triples.
+vector<vector<double>> triples(const vector<constraints::range> &rs) {
+  vector<vector<double>> res;
+  for (const auto &r : rs)
+    res.push_back({r.lo, r.hi, r.weight});
+  return res;
+}
+
+using Triples = vector<vector<double>>;
+
+/// Creates files in a fresh temporary directory.
+class CorpusStatsTest : public ramfuzz::test::TempDirTest {
+protected:
+  CorpusStatsTest() : TempDirTest("corpus") {}
+};
+
+TEST_F(CorpusStatsTest, Summary) {
+  const auto a = log("0.s", {ient(4, 10), ient(1, 10), ient(3, 10)});
+  const auto b = log("1.s", {ient(2, 10), ient(9, 20)});
+  const auto c = log("0.f", {ient(-5, 10)});
+  CorpusStats stats;
+  vector<string> bad;
+  EXPECT_EQ(3u, stats.add({a, b, c}, 2, bad));
+  EXPECT_TRUE(bad.empty());
+  EXPECT_EQ((vector<size_t>{10, 20}), stats.locations());
+  const auto s = stats.stats(10);
+  EXPECT_EQ(5, s.tag);
+  EXPECT_EQ(4u, s.success.count);
+  EXPECT_EQ(1, s.success.min);
+  EXPECT_EQ(4, s.success.max);
+  EXPECT_EQ(2.5, s.success.mean);
+  EXPECT_EQ(1, s.success.quantiles[0]);
+  EXPECT_EQ(2, s.success.quantiles[2]);
+  EXPECT_EQ(4, s.success.quantiles[4]);
+  EXPECT_EQ(1u, s.failure.count);
+  EXPECT_EQ(-5, s.failure.quantiles[2]);
+  EXPECT_EQ(0u, s.unknown.count);
+  EXPECT_THROW(stats.stats(30), out_of_range);
+}
+
+TEST_F(CorpusStatsTest, Histogram) {
+  const auto a = log("0.s", {ient(0, 10), ient(5, 10), ient(10, 10)});
+  const auto b = log("fuzzlog", {ient(9, 10)});
+  CorpusStats stats;
+  vector<string> bad;
+  stats.add({a, b}, 1, bad);
+  const auto h = stats.stats(10, 2).histogram;
+  ASSERT_EQ(2u, h.size());
+  EXPECT_EQ(0, h[0].lo);
+  EXPECT_EQ(5, h[0].hi);
+  EXPECT_EQ(1u, h[0].success);
+  EXPECT_EQ(2u, h[1].success);
+  EXPECT_EQ(1u, h[1].unknown);
+  EXPECT_TRUE(stats.stats(10, 0).histogram.empty());
+}
+
+TEST_F(CorpusStatsTest, SingleValueHistogram) {
+  const auto a = log("0.s", {ient(7, 10), ient(7, 10)});
+  CorpusStats stats;
+  vector<string> bad;
+  stats.add({a}, 1, bad);
+  const auto h = stats.stats(10).histogram;
+  ASSERT_EQ(1u, h.size());
+  EXPECT_EQ(2u, h[0].success);
+}
+
+TEST_F(CorpusStatsTest, NonFinite) {
+  const auto a = log("0.s", {dent(NAN, 10), dent(-1e308, 10), dent(1e308, 10),
+                             dent(INFINITY, 10), dent(NAN, 20)});
+  CorpusStats stats;
+  vector<string> bad;
+  stats.add({a}, 1, bad);
+  EXPECT_EQ((vector<size_t>{10, 20}), stats.locations());
+  const auto s = stats.stats(10, 2);
+  EXPECT_EQ(2u, s.success.count);
+  EXPECT_EQ(0, s.success.mean);
+  ASSERT_EQ(2u, s.histogram.size());
+  EXPECT_EQ(-1e308, s.histogram[0].lo);
+  EXPECT_EQ(0, s.histogram[0].hi);
+  EXPECT_EQ(1e308, s.histogram[1].hi);
+  EXPECT_EQ(1u, s.histogram[0].success);
+  EXPECT_EQ(1u, s.histogram[1].success);
+  EXPECT_EQ(0u, stats.stats(20).success.count);
+  EXPECT_TRUE(stats.stats(20).histogram.empty());
+}
+
+TEST_F(CorpusStatsTest, Valid) {
+  const auto a =
+      log("0.s", {ient(1, 10), ient(2, 10), ient(2, 10), ient(5, 10)});
+  const auto b = log("1.s", {ient(7, 10), ient(9, 10), ient(3, 10)});
+  const auto c = log("0.f", {ient(4, 10), ient(9, 10), ient(12, 10)});
+  CorpusStats stats;
+  vector<string> bad;
+  stats.add({a, b, c}, 3, bad);
+  EXPECT_EQ((Triples{{1, 3, 4}, {5, 7, 2}}), triples(stats.stats(10).valid));
+  EXPECT_EQ((Triples{{1, 3, 4}}), triples(stats.stats(10, 1, 3).valid));
+  const auto cs = stats.intervals(2);
+  ASSERT_TRUE(cs.at(10));
+  EXPECT_EQ((Triples{{1, 3, 4}, {5, 7, 2}}), triples(*cs.at(10)));
+}
+
+TEST_F(CorpusStatsTest, Incremental) {
+  const auto a = log("0.s", {ient(5, 10)});
+  const auto b = log("1.s", {ient(1, 10)});
+  CorpusStats stats;
+  vector<string> bad;
+  stats.add({a}, 1, bad);
+  stats.add({b}, 1, bad);
+  EXPECT_EQ(1, stats.stats(10).success.min);
+  EXPECT_EQ((Triples{{1, 5, 2}}), triples(stats.stats(10).valid));
+}
+
+TEST_F(CorpusStatsTest, Unreadable) {
+  const auto a = log("0.s", {ient(1, 10)});
+  CorpusStats stats;
+  vector<string> bad;
+  EXPECT_EQ(1u, stats.add({dir + "/nonexistent", a}, 2, bad));
+  EXPECT_EQ((vector<string>{dir + "/nonexistent"}), bad);
+}
+
+TEST_F(CorpusStatsTest, CorpusLogs) {
+  const auto b = log("1.s", {});
+  const auto a = log("0.f", {});
+  vector<string> bad;
+  EXPECT_EQ((vector<string>{"x", a, b}), corpus_logs({"x", dir}, bad));
+  EXPECT_TRUE(bad.empty());
+}
+
+} // anonymous namespace
@@ -0,0 +1,109 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "ramfuzz/runtime/ramfuzz-dictionary.hpp"
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using namespace ramfuzz::runtime;
+using namespace std;
+using namespace testing;
+
+/// Creates files in a fresh temporary directory.
+class DictionaryTest : public ramfuzz::test::TempDirTest {
+protected:
+  DictionaryTest() : TempDirTest("dictionary") {}
+};
+
+/// True iff \p v contains \p x.
+template <typename T> bool has(const vector<T> &v, T x) {
+  return find(v.cbegin(), v.cend(), x) != v.cend();
+}
+
+TEST_F(DictionaryTest, Load) {
+  dictionary d;
+  d.load(file("d", "# Comment.\n"
+                   "\n"
+                   "12 -1.5\n"
+                   "12 7\n"
+                   "int 42\n"
+                   "  unsigned \t long 1e3  \n"
+                   "* nan\n"
+                   "double -inf\n"));
+  ASSERT_NE(nullptr, d.at(12));
+  EXPECT_EQ((vector<double>{-1.5, 7}), *d.at(12));
+  EXPECT_EQ(nullptr, d.at(34));
+  ASSERT_NE(nullptr, d.of_type(5));
+  EXPECT_EQ(vector<double>{42}, *d.of_type(5));
+  ASSERT_NE(nullptr, d.of_type(8));
+  EXPECT_EQ(vector<double>{1000}, *d.of_type(8));
+  ASSERT_NE(nullptr, d.of_type(dictionary::any_type));
+  ASSERT_EQ(1u, d.of_type(dictionary::any_type)->size());
+  EXPECT_TRUE(isnan((*d.of_type(dictionary::any_type))[0]));
+  ASSERT_NE(nullptr, d.of_type(12));
+  EXPECT_EQ(-numeric_limits<double>::infinity(), (*d.of_type(12))[0]);
+  EXPECT_EQ(nullptr, d.of_type(6));
+}
+
+TEST_F(DictionaryTest, Malformed) {
+  dictionary d;
+  d.add_at(1, 0);
+  for (const auto bad : {"12\n", "int\n", "x 1\n", "12 x\n", "12 1 2\n",
+                         "-12 1\n", "long double 1\n", "int 1x\n", "* \n"})
+    EXPECT_THROW(d.load(file("d", bad)), file_error) << bad;
+  EXPECT_THROW(d.load(dir + "/nonexistent"), file_error);
+  EXPECT_EQ(1u, d.locations().size());
+  EXPECT_TRUE(d.types().empty());
+}
+
+TEST(BuiltinValuesTest, Integral) {
+  const auto &i = builtin_values<int>();
+  for (int x : {0, 1, -1, 2, 3, -4, 1 << 30, (1 << 30) - 1,
+                numeric_limits<int>::min(), numeric_limits<int>::min() + 1,
+                numeric_limits<int>::max(), numeric_limits<int>::max() - 1})
+    EXPECT_TRUE(has(i, x)) << x;
+  EXPECT_TRUE(is_sorted(i.cbegin(), i.cend()));
+  EXPECT_EQ(i.cend(), adjacent_find(i.cbegin(), i.cend()));
+  const auto &u = builtin_values<unsigned char>();
+  EXPECT_TRUE(has(u, static_cast<unsigned char>(255)));
+  EXPECT_TRUE(has(u, static_cast<unsigned char>(128)));
+  EXPECT_EQ(*min_element(u.cbegin(), u.cend()), 0);
+  EXPECT_TRUE(has(builtin_values<unsigned long long>(),
+                  numeric_limits<unsigned long long>::max()));
+  EXPECT_TRUE(builtin_values<bool>().empty());
+}
+
+TEST(BuiltinValuesTest, Floating) {
+  const auto &d = builtin_values<double>();
+  for (double x : {0., 1., -1., .5, numeric_limits<double>::max(),
+                   numeric_limits<double>::lowest(),
+                   numeric_limits<double>::denorm_min(),
+                   numeric_limits<double>::infinity(),
+                   -numeric_limits<double>::infinity()})
+    EXPECT_TRUE(has(d, x)) << x;
+  EXPECT_TRUE(any_of(d.cbegin(), d.cend(), [](double x) { return isnan(x); }));
+  EXPECT_TRUE(any_of(d.cbegin(), d.cend(),
+                     [](double x) { return x == 0 && signbit(x); }));
+}
+
+} // anonymous namespace
@@ -0,0 +1,113 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "ramfuzz/tools/Trainer.hpp"
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using namespace ramfuzz;
+using namespace std;
+using namespace testing;
+
+using ramfuzz::test::ient;
+
+/// Creates files in a fresh temporary directory.
+class FeaturesTest : public ramfuzz::test::TempDirTest {
+protected:
+  FeaturesTest() : TempDirTest("features") {}
+};
+
+TEST(FeatureTest, InRange) {
+  EXPECT_EQ(feature(123, 4, 1000), feature(123, 4, 1000));
+  EXPECT_NE(feature(123, 0, 1u << 20), feature(123, 1, 1u << 20));
+  for (size_t loc = 0; loc < 100; ++loc)
+    EXPECT_GT(7u, feature(loc, 0, 7));
+}
+
+TEST_F(FeaturesTest, Extract) {
+  const auto a = log("0.s", {ient(1, 10), ient(2, 10), ient(3, 10)});
+  const auto b = log("fuzzlog", {ient(4, 10)});
+  const auto c = log("0.f", {ient(5, 20)});
+  vector<string> bad;
+  const auto f = extract({a, b, c, dir + "/1.s"}, 1u << 20, 2, 2, bad);
+  EXPECT_EQ((vector<string>{dir + "/1.s"}), bad);
+  ASSERT_EQ(2u, f.runs());
+  EXPECT_EQ((vector<char>{1, 0}), f.label);
+  EXPECT_EQ((vector<uint64_t>{0, 3, 4}), f.rows);
+  EXPECT_EQ((vector<double>{1, 2, 3, 5}), f.value);
+  const auto f10 = feature(10, 1, f.dims);
+  EXPECT_EQ(f10, f.index[1]);
+  EXPECT_EQ(f10, f.index[2]);
+  EXPECT_EQ((vector<FeatureKey>{{10, 0}, {10, 1}, {20, 0}}), f.keys);
+}
+
+TEST_F(FeaturesTest, SaveAndMap) {
+  const auto a = log("0.s", {ient(1, 10), ient(2, 20)});
+  const auto b = log("0.f", {ient(3, 10)});
+  vector<string> bad;
+  const auto f = extract({a, b}, 1000, 4, 1, bad);
+  const auto fname = dir + "/features";
+  f.save(fname);
+  FeaturesFile file(fname);
+  const auto &m = file.matrix();
+  EXPECT_EQ(1000u, m.dims);
+  EXPECT_EQ(4u, m.occurrences);
+  ASSERT_EQ(2u, m.runs);
+  ASSERT_EQ(3u, m.nnz);
+  EXPECT_EQ((vector<uint64_t>{0, 2, 3}), vector<uint64_t>(m.rows, m.rows + 3));
+  EXPECT_EQ(f.index, vector<uint32_t>(m.index, m.index + 3));
+  EXPECT_EQ(f.value, vector<double>(m.value, m.value + 3));
+  EXPECT_EQ(f.label, vector<char>(m.label, m.label + 2));
+  EXPECT_EQ(f.keys, vector<FeatureKey>(m.keys, m.keys + m.nkeys));
+  double acc1, acc2;
+  const auto m1 = train(f.matrix(), TrainOptions(), acc1);
+  const auto m2 = train(m, TrainOptions(), acc2);
+  EXPECT_EQ(acc1, acc2);
+  EXPECT_EQ(m1.weight(10, 0), m2.weight(10, 0));
+}
+
+TEST_F(FeaturesTest, Invalid) {
+  EXPECT_THROW(FeaturesFile(dir + "/nonexistent"), runtime::file_error);
+  // A log index is no features file, though both are binary sidecars.
+  EXPECT_THROW(FeaturesFile(file("fuzzlog.idx", "RFX1" + string(64, '\0'))),
+               runtime::file_error);
+  const auto a = log("0.s", {ient(1, 10), ient(2, 20)});
+  vector<string> bad;
+  const auto fname = dir + "/features";
+  extract({a}, 1000, 4, 1, bad).save(fname);
+  ASSERT_EQ(0, truncate(fname.c_str(), 60));
+  EXPECT_THROW(FeaturesFile{fname}, runtime::file_error);
+  Features f;
+  f.dims = 2;
+  f.rows.push_back(1);
+  f.index.push_back(2);
+  f.value.push_back(1);
+  f.label.push_back(1);
+  f.save(fname);
+  EXPECT_THROW(FeaturesFile{fname}, runtime::file_error);
+  f.index[0] = 1;
+  f.save(fname);
+  EXPECT_EQ(1u, FeaturesFile(fname).matrix().nnz);
+}
+
+} // anonymous namespace
@@ -0,0 +1,142 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ramfuzz/tools/Fingerprint.hpp"
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using namespace ramfuzz;
+using namespace std;
+using namespace testing;
+
+using runtime::file_error;
+using runtime::logentry;
+using ramfuzz::test::ient;
+
+/// Fingerprint of a run logging \p log.
+uint64_t fp(const vector<logentry> &log) {
+  Fingerprinter f;
+  for (const auto &e : log)
+    f.add(e);
+  return f.value();
+}
+
+/// Path hash of a run logging \p log.
+uint64_t path(const vector<logentry> &log) {
+  Fingerprinter f;
+  for (const auto &e : log)
+    f.add(e);
+  return f.path();
+}
+
+TEST(FingerprintTest, SimilarRuns) {
+  vector<logentry> a, b, c;
+  for (size_t loc = 1; loc <= 40; ++loc) {
+    a.push_back(ient(100, loc));
+    b.push_back(ient(loc == 7 ? 101 : 100, loc)); // Same magnitude.
+    c.push_back(ient(100, loc * 1000));           // Other locations.
+  }
+  EXPECT_EQ(fp(a), fp(b));
+  EXPECT_EQ(path(a), path(b));
+  EXPECT_LT(10u, distance(fp(a), fp(c)));
+  EXPECT_NE(path(a), path(c));
+  b[7] = ient(-100, 8);
+  EXPECT_GE(8u, distance(fp(a), fp(b)));
+}
+
+TEST(FingerprintTest, Distance) {
+  EXPECT_EQ(0u, distance(5, 5));
+  EXPECT_EQ(2u, distance(0, 3));
+  EXPECT_EQ(64u, distance(0, ~0ull));
+}
+
+TEST(FingerprintIndexTest, NearDuplicates) {
+  FingerprintIndex idx(2);
+  EXPECT_TRUE(idx.insert(0xff00, Label::success));
+  EXPECT_FALSE(idx.insert(0xff00, Label::success));
+  EXPECT_FALSE(idx.insert(0xff03, Label::success));
+  EXPECT_TRUE(idx.insert(0xff07, Label::success));
+  EXPECT_TRUE(idx.insert(0xff00, Label::failure));
+  EXPECT_TRUE(idx.contains(0x1ff00, Label::failure));
+  EXPECT_FALSE(idx.contains(0xff00, Label::unknown));
+  EXPECT_FALSE(idx.contains(0xff00ull << 48, Label::success));
+  EXPECT_EQ(3u, idx.size());
+}
+
+TEST(FingerprintIndexTest, ExactOnly) {
+  FingerprintIndex idx(0);
+  EXPECT_TRUE(idx.insert(~0ull, Label::success));
+  EXPECT_FALSE(idx.insert(~0ull, Label::success));
+  EXPECT_TRUE(idx.insert(~1ull, Label::success));
+}
+
+/// Creates files in a fresh temporary directory.
+class FingerprintFileTest : public ramfuzz::test::TempDirTest {
+protected:
+  FingerprintFileTest() : TempDirTest("fingerprint") {}
+};
+
+TEST_F(FingerprintFileTest, Persists) {
+  const auto fname = dir + "/prints";
+  {
+    FingerprintIndex idx;
+    idx.open(fname);
+    EXPECT_EQ(0u, idx.size());
+    idx.insert(0x123456789abcdef0, Label::success);
+    idx.insert(42, Label::unknown);
+  }
+  FingerprintIndex idx;
+  idx.open(fname);
+  EXPECT_EQ(2u, idx.size());
+  EXPECT_TRUE(idx.contains(0x123456789abcdef0, Label::success));
+  EXPECT_TRUE(idx.contains(42, Label::unknown));
+  EXPECT_FALSE(idx.contains(42, Label::failure));
+}
+
+TEST_F(FingerprintFileTest, Malformed) {
+  const auto fname = dir + "/prints";
+  for (const char *bad : {"12 x\n", "zz s\n", "12\n", "12 s s\n", "-1 s\n"}) {
+    ofstream(fname) << "# comment\n\n" << bad;
+    FingerprintIndex idx;
+    EXPECT_THROW(idx.open(fname), file_error) << bad;
+  }
+}
+
+TEST_F(FingerprintFileTest, Logs) {
+  vector<string> logs;
+  for (int i = 0; i < 3; ++i) {
+    logs.push_back(dir + "/" + to_string(i) + ".s");
+    ofstream f(logs.back(), ios::binary);
+    runtime::write_entry(f, ient(i ? 10 : -10, 5));
+  }
+  logs.push_back(dir + "/missing");
+  vector<string> bad;
+  vector<uint64_t> paths;
+  const auto prints = fingerprints(logs, 2, bad, &paths);
+  ASSERT_EQ(4u, prints.size());
+  EXPECT_EQ(prints[1], prints[2]);
+  EXPECT_NE(prints[0], prints[1]);
+  EXPECT_EQ(paths[0], paths[1]);
+  EXPECT_EQ(vector<string>{logs[3]}, bad);
+}
+
+} // anonymous namespace
@@ -0,0 +1,156 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ramfuzz/lib/RamFuzz.hpp"
+
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace {
+
+using namespace ramfuzz;
+using namespace std;
+using namespace testing;
+
+using clang::tooling::FixedCompilationDatabase;
+
+/// Runs genTests() on headers in a fresh temporary directory.
+class GenTestsTest : public Test {
+protected:
+  void SetUp() override {
+    llvm::SmallString<128> d;
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("gentests", d));
+    dir = d.str().str();
+  }
+
+  void TearDown() override { llvm::sys::fs::remove_directories(dir); }
+
+  /// Creates a header named \p name with the given content.  Returns its path.
+  string header(const string &name, const string &content) {
+    const auto path = dir + "/" + name;
+    ofstream(path) << content;
+    return path;
+  }
+
+  /// Runs genTests() on \p sources, putting the output into h and c.
+  int gen(const vector<string> &sources, unsigned jobs,
+          const Weights &weights = Weights()) {
+    FixedCompilationDatabase db(dir, {"-std=c++11", "-xc++"});
+    GenOptions opts;
+    opts.jobs = jobs;
+    opts.weights = weights;
+    h.clear();
+    c.clear();
+    llvm::raw_string_ostream outh(h), outc(c);
+    llvm::raw_ostream *out = &outc;
+    const int status = genTests(db, sources, opts, outh, out, llvm::nulls());
+    outh.flush();
+    outc.flush();
+    return status;
+  }
+
+  string dir, h, c;
+};
+
+TEST_F(GenTestsTest, ParallelMatchesSerial) {
+  const vector<string> sources{
+      header("a.hpp", "class A { public: void f(int); };"),
+      header("b.hpp", "#include \"a.hpp\"\n"
+                      "class B : public A { public: void g(A&); };"),
+      header("c.hpp", "enum E { e1, e2 };\n"
+                      "struct C { C(E); void h(double); };")};
+  ASSERT_EQ(0, gen(sources, 1));
+  const auto serial_h = h, serial_c = c;
+  ASSERT_EQ(0, gen(sources, 3));
+  EXPECT_EQ(serial_h, h);
+  EXPECT_EQ(serial_c, c);
+  EXPECT_NE(string::npos, c.find("submakerfn0(runtime::gen& g) { return "
+                                 "g.make<B>(true); }"));
+}
+
+TEST_F(GenTestsTest, ClassInSeveralSources) {
+  const auto a = header("a.hpp", "class A { public: void f(); };");
+  ASSERT_EQ(0, gen({a, a, a}, 2));
+  const auto first = h.find("class harness<A>");
+  ASSERT_NE(string::npos, first);
+  EXPECT_EQ(string::npos, h.find("class harness<A>", first + 1));
+}
+
+TEST_F(GenTestsTest, ErrorInOneSource) {
+  const vector<string> sources{header("a.hpp", "class A {};"),
+                               header("b.hpp", "class B { syntax error };")};
+  EXPECT_EQ(1, gen(sources, 2));
+  EXPECT_NE(string::npos, h.find("class harness<A>"));
+}
+
+TEST_F(GenTestsTest, Weights) {
+  const auto a = header("a.hpp", "struct A {\n"
+                                 "  void f();\n"
+                                 "  void f(int);\n"
+                                 "  __attribute__((annotate("
+                                 "\"ramfuzz_weight=0\"))) void g();\n"
+                                 "  void h() const;\n"
+                                 "};\n"
+                                 "struct B { void f(); void g(); };");
+  ASSERT_EQ(0, gen({a}, 1));
+  // Observers aren't spun, so they get no table rows.
+  EXPECT_NE(string::npos, h.find("unsigned wprob[3], walias[3];"));
+  EXPECT_NE(string::npos, c.find("harness<A>::wprob[] = {65536, 32768, 0};"));
+  EXPECT_EQ(string::npos, c.find("harness<B>::wprob"));
+  ASSERT_EQ(0, gen({a}, 1, {{"A::g", 1.}, {"B::f", 3.}}));
+  EXPECT_EQ(string::npos, c.find("harness<A>::wprob"));
+  EXPECT_NE(string::npos, c.find("harness<B>::wprob[] = {65536, 32768};"));
+  EXPECT_NE(string::npos, c.find("harness<B>::walias[] = {0, 0};"));
+}
+
+TEST_F(GenTestsTest, AllWeightsZero) {
+  const auto a = header("a.hpp", "struct A { void f(); void g(); };\n"
+                                 "struct B { void f(); };");
+  ASSERT_EQ(0, gen({a}, 1, {{"A::f", 0.}, {"A::g", 0.}}));
+  // No table, since nothing is drawn from it; A's methods are never spun.
+  EXPECT_EQ(string::npos, c.find("harness<A>::wprob"));
+  const auto body = [this](const string &cls) {
+    const auto begin = h.find("class harness<" + cls + ">");
+    if (begin == string::npos)
+      return string();
+    return h.substr(begin, h.find("\n};", begin) - begin);
+  };
+  EXPECT_NE(string::npos, body("A").find("bool nospin = true;"));
+  EXPECT_EQ(string::npos, body("B").find("nospin"));
+}
+
+TEST_F(GenTestsTest, ReadWeights) {
+  const auto fname = header("weights", "# Comment.\n"
+                                       "\n"
+                                       "ns::A::f 2.5\n"
+                                       "  B::g\t0  \n");
+  Weights w;
+  ASSERT_TRUE(readWeights(fname, w, llvm::nulls()));
+  EXPECT_EQ((Weights{{"ns::A::f", 2.5}, {"B::g", 0.}}), w);
+  header("bad", "A::f -1\n");
+  EXPECT_FALSE(readWeights(dir + "/bad", w, llvm::nulls()));
+  header("bad", "A::f\n");
+  EXPECT_FALSE(readWeights(dir + "/bad", w, llvm::nulls()));
+  EXPECT_FALSE(readWeights(dir + "/nonexistent", w, llvm::nulls()));
+}
+
+} // anonymous namespace
@@ -0,0 +1,357 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ramfuzz/lib/GenCache.hpp"
+#include "ramfuzz/lib/Generated.hpp"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+
+namespace {
+
+using namespace ramfuzz;
+using namespace std;
+using namespace testing;
+
+/// Details of a plain visible class named qname.
+ClassDetails plain(const string &qname) {
+  return ClassDetails(qname, qname, "", "", false, true);
+}
+
+/// Code for class qname, referencing the classes in refs.
+ClassCode code(const string &qname, const vector<string> &refs = {}) {
+  ClassCode cc;
+  cc.cls = plain(qname);
+  cc.decl = "class harness<" + qname + ">;\n";
+  cc.defs = "// " + qname + "\n";
+  for (const auto &r : refs)
+    cc.referenced.insert(plain(r));
+  return cc;
+}
+
+struct Emitted {
+  int status;
+  string h, c, errs;
+};
+
+Emitted emit(const Generated &g) {
+  Emitted e;
+  llvm::raw_string_ostream h(e.h), c(e.c), errs(e.errs);
+  e.status = g.emit({"a.hpp"}, h, c, errs);
+  h.flush();
+  c.flush();
+  errs.flush();
+  return e;
+}
+
+TEST(SourceCodeTest, RoundTrip) {
+  SourceCode sc;
+  sc.classes.push_back(code("N::A", {"B"}));
+  sc.classes[0].enums["E"] = {"E::x", "E::y"};
+  sc.classes.push_back(code("B"));
+  sc.inheritance[plain("B")] = {plain("N::A")};
+  stringstream ss;
+  sc.write(ss);
+  SourceCode back;
+  ASSERT_TRUE(back.read(ss));
+  ASSERT_EQ(2u, back.classes.size());
+  EXPECT_EQ("N::A", back.classes[0].cls.qname());
+  EXPECT_TRUE(back.classes[0].cls.is_visible());
+  EXPECT_EQ(sc.classes[0].decl, back.classes[0].decl);
+  EXPECT_EQ(sc.classes[0].defs, back.classes[0].defs);
+  EXPECT_EQ(1u, back.classes[0].referenced.count(plain("B")));
+  EXPECT_EQ(sc.classes[0].enums, back.classes[0].enums);
+  ASSERT_EQ(1u, back.inheritance.size());
+  EXPECT_EQ("N::A", back.inheritance[plain("B")].at(0).qname());
+}
+
+TEST(SourceCodeTest, Garbage) {
+  stringstream ss("RFG1 and then some");
+  SourceCode sc;
+  EXPECT_FALSE(sc.read(ss));
+}
+
+TEST(GeneratedTest, MergesDuplicates) {
+  SourceCode s1, s2;
+  s1.classes = {code("A"), code("B")};
+  s1.inheritance[plain("A")] = {plain("B")};
+  s2.classes = {code("B"), code("C")};
+  s2.inheritance[plain("A")] = {plain("B")};
+  Generated g;
+  g.add(s1);
+  g.add(s2);
+  const auto e = emit(g);
+  EXPECT_EQ(0, e.status);
+  EXPECT_NE(string::npos, e.h.find("#include \"a.hpp\""));
+  const auto b = e.c.find("// B\n");
+  EXPECT_NE(string::npos, b);
+  EXPECT_EQ(string::npos, e.c.find("// B\n", b + 1));
+  EXPECT_LT(e.c.find("// A\n"), b);
+  EXPECT_LT(b, e.c.find("// C\n"));
+  EXPECT_NE(string::npos, e.c.find("harness<A>::subcount = 1;"));
+}
+
+TEST(GeneratedTest, Missing) {
+  SourceCode sc;
+  sc.classes = {code("A", {"B", "C"}), code("C")};
+  sc.inheritance[plain("A")] = {plain("D")};
+  Generated g;
+  g.add(sc);
+  EXPECT_EQ((vector<string>{"B", "D"}), g.missingClasses());
+  const auto e = emit(g);
+  EXPECT_EQ(2, e.status);
+  EXPECT_NE(string::npos, e.errs.find("B\nD\n"));
+}
+
+TEST(GeneratedTest, Enums) {
+  SourceCode sc;
+  sc.classes = {code("A"), code("B")};
+  sc.classes[0].enums["E"] = {"E::x"};
+  sc.classes[1].enums["E"] = {"E::x"};
+  Generated g;
+  g.add(sc);
+  const auto e = emit(g);
+  const auto first = e.c.find("gen::make<E>(bool)");
+  EXPECT_NE(string::npos, first);
+  EXPECT_EQ(string::npos, e.c.find("gen::make<E>(bool)", first + 1));
+}
+
+TEST(GeneratedTest, Shards) {
+  SourceCode sc;
+  for (const auto &n : {"A", "B", "C", "D", "E", "F", "G", "H"})
+    sc.classes.push_back(code(n));
+  sc.classes[0].enums["En"] = {"En::x"};
+  Generated g;
+  g.add(sc);
+  string h, c[3];
+  llvm::raw_string_ostream outh(h), c0(c[0]), c1(c[1]), c2(c[2]);
+  llvm::raw_ostream *outc[] = {&c0, &c1, &c2};
+  EXPECT_EQ(0, g.emit({"a.hpp"}, outh, outc, llvm::nulls()));
+  for (int i = 0; i < 3; ++i) {
+    outc[i]->flush();
+    EXPECT_EQ(0u, c[i].find("#include <cstddef>")) << i;
+    EXPECT_NE(string::npos, c[i].find("} // namespace ramfuzz\n")) << i;
+  }
+  for (const auto &cc : sc.classes) {
+    const auto &out = c[shard(cc.cls.qname(), 3)];
+    EXPECT_NE(string::npos, out.find(cc.defs)) << cc.cls.qname();
+    EXPECT_NE(string::npos, out.find("harness<" + cc.cls.qname() +
+                                     ">::subcount = 0;"));
+  }
+  EXPECT_NE(string::npos,
+            c[shard("En", 3)].find("gen::make<En>(bool) {"));
+  // Within a shard, classes keep their order.
+  const auto &s = c[shard("A", 3)];
+  size_t last = 0;
+  for (const auto &cc : sc.classes)
+    if (shard(cc.cls.qname(), 3) == shard("A", 3)) {
+      const auto at = s.find(cc.defs);
+      EXPECT_LE(last, at);
+      last = at;
+    }
+}
+
+TEST(GeneratedTest, ShardIsStable) {
+  EXPECT_EQ(0u, shard("anything", 1));
+  EXPECT_EQ(shard("ns::Foo", 16), shard("ns::Foo", 16));
+  // FNV-1a of "a" is 0xaf63dc4c8601ec8c.
+  EXPECT_EQ(0xaf63dc4c8601ec8cu % 1000, shard("a", 1000));
+}
+
+/// Classes emitted into fuzz.hpp by g, in emission order.
+vector<string> emitted(const Generated &g) {
+  const auto e = emit(g);
+  vector<string> res;
+  const string pre = "class harness<";
+  for (auto at = e.h.find(pre); at != string::npos;
+       at = e.h.find(pre, at + 1)) {
+    const auto begin = at + pre.size();
+    res.push_back(e.h.substr(begin, e.h.find('>', begin) - begin));
+  }
+  return res;
+}
+
+/// A source with classes A..G where A uses B, B uses C, D is A's subclass, E
+/// is D's subclass, and F and G are unrelated.
+SourceCode related() {
+  SourceCode sc;
+  sc.classes = {code("A", {"B"}), code("B", {"C"}), code("C"), code("D"),
+                code("E"), code("F"), code("G")};
+  sc.inheritance[plain("A")] = {plain("D")};
+  sc.inheritance[plain("D")] = {plain("E")};
+  return sc;
+}
+
+TEST(GeneratedTest, PruneFromRoot) {
+  Generated g;
+  g.add(related());
+  EXPECT_TRUE(g.prune({"A"}, "", "").empty());
+  EXPECT_EQ((vector<string>{"A", "B", "C", "D", "E"}), emitted(g));
+  EXPECT_EQ(0, emit(g).status);
+}
+
+TEST(GeneratedTest, PruneUnknownRoot) {
+  Generated g;
+  g.add(related());
+  EXPECT_EQ((vector<string>{"X"}), g.prune({"X", "C"}, "", ""));
+  EXPECT_EQ((vector<string>{"C"}), emitted(g));
+}
+
+TEST(GeneratedTest, PruneIncludeExclude) {
+  Generated g;
+  g.add(related());
+  EXPECT_TRUE(g.prune({}, "^[DF]$", "^E$").empty());
+  EXPECT_EQ((vector<string>{"D", "F"}), emitted(g));
+  const auto e = emit(g);
+  EXPECT_EQ(0, e.status);
+  EXPECT_NE(string::npos, e.c.find("harness<D>::subcount = 0;"));
+}
+
+TEST(GeneratedTest, PruneExcludeOnly) {
+  Generated g;
+  g.add(related());
+  EXPECT_TRUE(g.prune({}, "", "^[BE]$").empty());
+  // B stays, since A uses it; E goes, along with D's submaker for it.
+  EXPECT_EQ((vector<string>{"A", "B", "C", "D", "F", "G"}), emitted(g));
+  const auto e = emit(g);
+  EXPECT_EQ(0, e.status);
+  EXPECT_NE(string::npos, e.c.find("harness<D>::subcount = 0;"));
+}
+
+TEST(GeneratedTest, PruneKeepsUsedExcluded) {
+  Generated g;
+  g.add(related());
+  EXPECT_TRUE(g.prune({"A", "B"}, "", "^[BD]$").empty());
+  EXPECT_EQ((vector<string>{"A", "B", "C"}), emitted(g));
+}
+
+/// A class A and a class template N::V.
+SourceCode with_template() {
+  SourceCode sc;
+  sc.classes = {code("A"), code("N::V")};
+  sc.classes[1].cls =
+      ClassDetails("V", "N::V", "template<typename T>", "<T>", true, true);
+  return sc;
+}
+
+TEST(GeneratedTest, Instantiate) {
+  Generated g;
+  g.add(with_template());
+  EXPECT_EQ((vector<string>{"A<int>", "W<int>"}),
+            g.instantiate({"N::V<int>", "A<int>", "::N::V<pair<int, int>>",
+                           "W<int>"}));
+  const auto e = emit(g);
+  EXPECT_EQ(0, e.status);
+  const auto ext = e.h.find("extern template class harness<N::V<int>>;\n");
+  ASSERT_NE(string::npos, ext);
+  // After all the template's member definitions.
+  EXPECT_LT(e.h.find("harness<N::V<T>>::subcount"), ext);
+  EXPECT_NE(string::npos,
+            e.h.find("extern template class harness<::N::V<pair<int, int>>>;"));
+  EXPECT_EQ(string::npos, e.h.find("harness<A<int>>"));
+  EXPECT_NE(string::npos, e.c.find("\ntemplate class harness<N::V<int>>;\n"));
+}
+
+TEST(GeneratedTest, PruneKeepsInstantiated) {
+  Generated g;
+  g.add(with_template());
+  EXPECT_TRUE(g.instantiate({"N::V<int>"}).empty());
+  EXPECT_TRUE(g.prune({"A"}, "", "").empty());
+  EXPECT_NE(string::npos, emit(g).h.find("class harness<N::V>;"));
+}
+
+/// Provides a fresh temporary directory.
+class GenCacheTest : public Test {
+protected:
+  void SetUp() override {
+    llvm::SmallString<128> d;
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("gencache", d));
+    dir = d.str().str();
+    ofstream(dir + "/a.hpp") << "class A {};";
+    sc.classes = {code("A")};
+  }
+
+  void TearDown() override { llvm::sys::fs::remove_directories(dir); }
+
+  /// a.hpp with the digest of its current contents.
+  map<string, string> deps() const {
+    return {{dir + "/a.hpp", GenCache::digest(dir + "/a.hpp")}};
+  }
+
+  string dir;
+  SourceCode sc;
+};
+
+TEST_F(GenCacheTest, Hit) {
+  GenCache cache(dir + "/cache", "gen");
+  SourceCode back;
+  EXPECT_FALSE(cache.lookup("a.hpp", "cmd", back));
+  ASSERT_TRUE(cache.store("a.hpp", "cmd", deps(), sc));
+  ASSERT_TRUE(cache.lookup("a.hpp", "cmd", back));
+  ASSERT_EQ(1u, back.classes.size());
+  EXPECT_EQ("A", back.classes[0].cls.qname());
+}
+
+TEST_F(GenCacheTest, KeyMismatch) {
+  GenCache cache(dir + "/cache", "gen");
+  ASSERT_TRUE(cache.store("a.hpp", "cmd", deps(), sc));
+  SourceCode back;
+  EXPECT_FALSE(cache.lookup("b.hpp", "cmd", back));
+  EXPECT_FALSE(cache.lookup("a.hpp", "cmd -DX", back));
+  EXPECT_FALSE(GenCache(dir + "/cache", "gen2").lookup("a.hpp", "cmd", back));
+}
+
+TEST_F(GenCacheTest, DependencyChanged) {
+  GenCache cache(dir + "/cache", "gen");
+  ASSERT_TRUE(cache.store("a.hpp", "cmd", deps(), sc));
+  ofstream(dir + "/a.hpp") << "class A { int x; };";
+  SourceCode back;
+  EXPECT_FALSE(cache.lookup("a.hpp", "cmd", back));
+}
+
+TEST_F(GenCacheTest, ChangedWhileParsing) {
+  // a.hpp changed after it was parsed but before the entry was stored.
+  const auto parsed = deps();
+  ofstream(dir + "/a.hpp") << "class A { int x; };";
+  GenCache cache(dir + "/cache", "gen");
+  ASSERT_TRUE(cache.store("a.hpp", "cmd", parsed, sc));
+  SourceCode back;
+  EXPECT_FALSE(cache.lookup("a.hpp", "cmd", back));
+  ASSERT_TRUE(cache.store("a.hpp", "cmd", deps(), sc));
+  EXPECT_TRUE(cache.lookup("a.hpp", "cmd", back));
+}
+
+TEST_F(GenCacheTest, WriteIfChanged) {
+  const auto f = dir + "/out";
+  ASSERT_TRUE(write_if_changed(f, "abc"));
+  llvm::sys::fs::file_status st1, st2;
+  ASSERT_FALSE(llvm::sys::fs::status(f, st1));
+  ASSERT_TRUE(write_if_changed(f, "abc"));
+  ASSERT_FALSE(llvm::sys::fs::status(f, st2));
+  EXPECT_EQ(st1.getLastModificationTime(), st2.getLastModificationTime());
+  ASSERT_TRUE(write_if_changed(f, "abcd"));
+  string content;
+  getline(ifstream(f), content);
+  EXPECT_EQ("abcd", content);
+}
+
+} // anonymous namespace
@@ -0,0 +1,158 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "ramfuzz/runtime/ramfuzz-linear.hpp"
+
+namespace {
+
+using namespace ramfuzz::runtime;
+using namespace std;
+using namespace testing;
+
+using row = linear_system::row;
+
+constexpr double inf = numeric_limits<double>::infinity();
+
+/// Adds lo <= x[i] <= hi to s.
+void box(linear_system &s, size_t i, double lo, double hi) {
+  vector<double> w(i + 1);
+  w[i] = 1;
+  s.add(row{w, -lo});
+  w[i] = -1;
+  s.add(row{w, hi});
+}
+
+TEST(LinearTest, Unconstrained) {
+  linear_system s(2);
+  double lo, hi;
+  ASSERT_TRUE(s.bounds(lo, hi));
+  EXPECT_EQ(-inf, lo);
+  EXPECT_EQ(inf, hi);
+  s.fix(1);
+  s.fix(2);
+  EXPECT_TRUE(s.done());
+  EXPECT_FALSE(s.bounds(lo, hi));
+}
+
+TEST(LinearTest, Pairs) {
+  // x[0] <= x[2] and x[1] <= x[3], as in ai/solver.py.
+  linear_system s(4);
+  for (size_t i = 0; i < 4; ++i)
+    box(s, i, -99999, 99999);
+  s.add(row{{-1, 0, 1, 0}, 0});
+  s.add(row{{0, -1, 0, 1}, 0});
+  double lo, hi;
+  ASSERT_TRUE(s.bounds(lo, hi));
+  EXPECT_EQ(-99999, lo);
+  EXPECT_EQ(99999, hi);
+  s.fix(500);
+  ASSERT_TRUE(s.bounds(lo, hi));
+  EXPECT_EQ(-99999, lo);
+  s.fix(7);
+  ASSERT_TRUE(s.bounds(lo, hi));
+  EXPECT_EQ(500, lo);
+  EXPECT_EQ(99999, hi);
+  s.fix(600);
+  ASSERT_TRUE(s.bounds(lo, hi));
+  EXPECT_EQ(7, lo);
+}
+
+TEST(LinearTest, BoundFromLaterVariable) {
+  // x[1] >= x[0] + 10 and x[1] <= 20, so x[0] <= 10.
+  linear_system s(2);
+  s.add(row{{-1, 1}, -10});
+  s.add(row{{0, -1}, 20});
+  double lo, hi;
+  ASSERT_TRUE(s.bounds(lo, hi));
+  EXPECT_EQ(-inf, lo);
+  EXPECT_EQ(10, hi);
+  s.fix(4);
+  ASSERT_TRUE(s.bounds(lo, hi));
+  EXPECT_EQ(14, lo);
+  EXPECT_EQ(20, hi);
+}
+
+TEST(LinearTest, Infeasible) {
+  linear_system s(2);
+  box(s, 1, 5, 3);
+  double lo, hi;
+  EXPECT_FALSE(s.bounds(lo, hi));
+}
+
+TEST(LinearTest, Prunes) {
+  linear_system s(2);
+  s.add(row{{2, 4}, 2});
+  s.add(row{{1, 2}, 0});
+  s.add(row{{0, 0}, 1});
+  ASSERT_EQ(1u, s.projection(1).size());
+  EXPECT_EQ((vector<double>{.5, 1}), s.projection(1)[0].w);
+  EXPECT_EQ(0, s.projection(1)[0].b);
+  s.max_rows(1);
+  box(s, 0, 0, 1);
+  EXPECT_EQ(1u, s.projection(1).size());
+}
+
+TEST(LinearTest, AddAfterFix) {
+  linear_system s(2);
+  s.add(row{{-1, 1}, 0});
+  s.fix(3);
+  double lo, hi;
+  ASSERT_TRUE(s.bounds(lo, hi));
+  EXPECT_EQ(3, lo);
+  s.add(row{{1, -1}, 2});
+  ASSERT_TRUE(s.bounds(lo, hi));
+  EXPECT_EQ(3, lo);
+  EXPECT_EQ(5, hi);
+}
+
+TEST(LinearTest, SequentialSamplesSatisfy) {
+  mt19937 rng(1);
+  uniform_real_distribution<double> coef(-1, 1);
+  for (int trial = 0; trial < 50; ++trial) {
+    const size_t n = 5;
+    linear_system s(n);
+    vector<row> rows;
+    for (size_t i = 0; i < n; ++i)
+      box(s, i, -100, 100);
+    for (int i = 0; i < 6; ++i) {
+      row r{vector<double>(n), 0};
+      for (auto &x : r.w)
+        x = coef(rng);
+      r.b = 10 * coef(rng) + 20; // Keeps the origin's neighborhood feasible.
+      rows.push_back(r);
+      s.add(r);
+    }
+    vector<double> x;
+    while (!s.done()) {
+      double lo, hi;
+      ASSERT_TRUE(s.bounds(lo, hi)) << trial << ' ' << x.size();
+      x.push_back(uniform_real_distribution<double>(lo, hi)(rng));
+      s.fix(x.back());
+    }
+    for (const auto &r : rows) {
+      double sum = r.b;
+      for (size_t i = 0; i < n; ++i)
+        sum += r.w[i] * x[i];
+      EXPECT_GE(sum, -1e-9) << trial;
+    }
+  }
+}
+
+} // anonymous namespace
@@ -0,0 +1,116 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "ramfuzz/runtime/ramfuzz-model.hpp"
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using namespace ramfuzz::runtime;
+using namespace std;
+using namespace testing;
+
+using ramfuzz::test::dent;
+using ramfuzz::test::ient;
+
+/// Creates files in a fresh temporary directory.
+class ModelTest : public ramfuzz::test::TempDirTest {
+protected:
+  ModelTest() : TempDirTest("model") {}
+};
+
+TEST_F(ModelTest, Weights) {
+  linear_model m;
+  m.occurrences(2);
+  m.set(10, 0, 1.5);
+  m.set(10, 5, -2);
+  EXPECT_EQ(1.5, m.weight(10, 0));
+  EXPECT_EQ(-2, m.weight(10, 1));
+  EXPECT_EQ(-2, m.weight(10, 9));
+  EXPECT_EQ(0, m.weight(20, 0));
+}
+
+TEST_F(ModelTest, Score) {
+  linear_model m;
+  m.bias(-1);
+  m.occurrences(2);
+  m.set(10, 0, 2);
+  m.set(10, 1, 3);
+  m.set(20, 0, -1);
+  EXPECT_EQ(-1 + 2 * 4 + 3 * 5 + 3 * 6 - 7,
+            m.score({ient(4, 10), ient(7, 20), ient(5, 10), ient(6, 10),
+                     ient(9, 30)}));
+  EXPECT_EQ(.5, linear_model::probability(0));
+}
+
+TEST_F(ModelTest, NonFiniteScore) {
+  linear_model m;
+  m.occurrences(2);
+  m.set(10, 0, 5);
+  m.set(10, 1, 3);
+  EXPECT_EQ(3 * 2, m.score({dent(NAN, 10), dent(2, 10)}));
+  EXPECT_EQ(0, m.score({dent(INFINITY, 20)}));
+}
+
+TEST_F(ModelTest, Load) {
+  linear_model m;
+  m.load(file("m", "# Comment.\n"
+                   "bias -0.5\n"
+                   "occurrences 3\n"
+                   "\n"
+                   "12 0 1.5\n"
+                   "  12\t2 -4  \n"));
+  EXPECT_EQ(-0.5, m.bias());
+  EXPECT_EQ(3u, m.occurrences());
+  EXPECT_EQ(1.5, m.weight(12, 0));
+  EXPECT_EQ(0, m.weight(12, 1));
+  EXPECT_EQ(-4, m.weight(12, 7));
+}
+
+TEST_F(ModelTest, Malformed) {
+  linear_model m;
+  m.bias(3);
+  for (const auto bad : {"12 1\n", "x 1 2\n", "-12 1 2\n", "12 1 2 3\n",
+                         "bias\n", "bias x\n", "occurrences 0\n",
+                         "occurrences -1\n", "12 1 x\n"})
+    EXPECT_THROW(m.load(file("m", bad)), file_error) << bad;
+  EXPECT_THROW(m.load(dir + "/nonexistent"), file_error);
+  EXPECT_EQ(3, m.bias());
+}
+
+TEST_F(ModelTest, SaveAndLoad) {
+  linear_model m;
+  m.bias(1. / 3);
+  m.occurrences(4);
+  m.set(18446744073709551615u, 3, 0.1);
+  m.set(5, 1, -2);
+  const auto fname = dir + "/saved";
+  m.save(fname);
+  linear_model back;
+  back.load(fname);
+  EXPECT_EQ(1. / 3, back.bias());
+  EXPECT_EQ(4u, back.occurrences());
+  EXPECT_EQ(0.1, back.weight(18446744073709551615u, 3));
+  EXPECT_EQ(-2, back.weight(5, 1));
+  EXPECT_EQ(0, back.weight(5, 0));
+}
+
+} // anonymous namespace
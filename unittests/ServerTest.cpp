@@ -0,0 +1,139 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ramfuzz/lib/RamFuzz.hpp"
+#include "ramfuzz/lib/Server.hpp"
+
+#include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+
+namespace {
+
+using namespace ramfuzz;
+using namespace std;
+using namespace testing;
+
+using clang::tooling::FixedCompilationDatabase;
+
+/// Runs a Server on a header in a fresh temporary directory.
+class ServerTest : public Test {
+protected:
+  void SetUp() override {
+    llvm::SmallString<128> d;
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("server", d));
+    dir = d.str().str();
+    sock = dir + "/sock";
+    write("a.hpp", "class A { public: void f(int); };");
+    write("b.hpp", "#include \"a.hpp\"\nclass B { public: void g(A&); };");
+    server.reset(new Server(db, {dir + "/a.hpp", dir + "/b.hpp"},
+                            [this](Generated &gen, llvm::raw_ostream &errs) {
+                              ++outputs;
+                              string c;
+                              llvm::raw_string_ostream outh(h), outc(c);
+                              h.clear();
+                              return gen.emit({}, outh, outc, errs);
+                            }));
+    thread([this] { status = server->run(sock); }).swap(runner);
+    // Wait for the socket to appear.
+    for (int i = 0; i < 1000 && !llvm::sys::fs::exists(sock); ++i)
+      usleep(10000);
+  }
+
+  void TearDown() override {
+    if (runner.joinable()) {
+      request("quit");
+      runner.join();
+    }
+    llvm::sys::fs::remove_directories(dir);
+  }
+
+  void write(const string &name, const string &content) {
+    ofstream(dir + "/" + name) << content;
+  }
+
+  /// Sends request r to the server and returns its reply.
+  string request(const string &r) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, sock.c_str());
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr))) {
+      close(fd);
+      return "cannot connect";
+    }
+    const auto line = r + "\n";
+    send(fd, line.data(), line.size(), 0);
+    string reply;
+    char buf[256];
+    for (ssize_t n; (n = recv(fd, buf, sizeof(buf), 0)) > 0;)
+      reply.append(buf, n);
+    close(fd);
+    return reply;
+  }
+
+  string dir, sock;
+  FixedCompilationDatabase db{".", {"-std=c++11", "-xc++"}};
+  unique_ptr<Server> server;
+  thread runner;
+  int status = -1;
+  int outputs = 0;
+  string h; ///< Latest fuzz.hpp.
+};
+
+TEST_F(ServerTest, Status) {
+  EXPECT_EQ("0\n", request("status"));
+  EXPECT_EQ(1, outputs);
+  EXPECT_NE(string::npos, h.find("class harness<B>"));
+  EXPECT_EQ("1\nUnknown request: hello\n", request("hello"));
+}
+
+TEST_F(ServerTest, RegeneratesOnChange) {
+  EXPECT_EQ("0\n", request("generate"));
+  EXPECT_EQ(1, outputs);
+  write("a.hpp", "class A { public: void f(int); };\nclass A2 {};");
+  EXPECT_EQ("0\n", request("generate"));
+  EXPECT_EQ(2, outputs);
+  EXPECT_NE(string::npos, h.find("class harness<A2>"));
+  EXPECT_EQ("0\n", request("generate"));
+  EXPECT_EQ(2, outputs);
+}
+
+TEST_F(ServerTest, ErrorAndRecovery) {
+  write("a.hpp", "class A { syntax error };");
+  EXPECT_EQ('1', request("generate")[0]);
+  write("a.hpp", "class A {};");
+  EXPECT_EQ("0\n", request("generate"));
+}
+
+TEST_F(ServerTest, Quit) {
+  EXPECT_EQ("0\n", request("quit"));
+  runner.join();
+  EXPECT_EQ(0, status);
+  EXPECT_FALSE(llvm::sys::fs::exists(sock));
+}
+
+} // anonymous namespace
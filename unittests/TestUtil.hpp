@@ -0,0 +1,91 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file Helpers shared by the unit tests of log-processing code.
+
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ramfuzz/runtime/ramfuzz-log.hpp"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+
+namespace ramfuzz {
+namespace test {
+
+/// Type tags of int and double in logs; see typetag() in
+/// ../runtime/ramfuzz-rt.cpp.
+constexpr char int_tag = 5, double_tag = 12;
+
+/// An int entry at location loc.
+inline runtime::logentry ient(int val, size_t loc) {
+  runtime::logentry e{int_tag, 0, loc};
+  std::memcpy(&e.bits, &val, sizeof(val));
+  return e;
+}
+
+/// A double entry at location loc.
+inline runtime::logentry dent(double val, size_t loc) {
+  runtime::logentry e{double_tag, 0, loc};
+  std::memcpy(&e.bits, &val, sizeof(val));
+  return e;
+}
+
+/// Fixture providing a fresh temporary directory, removed after each test,
+/// and ways to create files in it.
+class TempDirTest : public testing::Test {
+protected:
+  /// The directory's name will start with \p prefix.
+  explicit TempDirTest(const char *prefix) : prefix(prefix) {}
+
+  void SetUp() override {
+    llvm::SmallString<128> d;
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory(prefix, d));
+    dir = d.str().str();
+  }
+
+  void TearDown() override { llvm::sys::fs::remove_directories(dir); }
+
+  /// Creates a file named \p name with the given content.  Returns its path.
+  std::string file(const std::string &name, const std::string &content) {
+    const auto path = dir + "/" + name;
+    std::ofstream(path) << content;
+    return path;
+  }
+
+  /// Writes a log named \p name with the given entries and returns its path.
+  std::string log(const std::string &name,
+                  const std::vector<runtime::logentry> &entries) {
+    const auto path = dir + "/" + name;
+    std::ofstream f(path, std::ios::binary);
+    for (const auto &e : entries)
+      runtime::write_entry(f, e);
+    return path;
+  }
+
+  std::string dir;
+
+private:
+  const char *prefix;
+};
+
+} // namespace test
+} // namespace ramfuzz
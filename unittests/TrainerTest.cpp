@@ -0,0 +1,149 @@
+// Copyright 2016-2018 The RamFuzz contributors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "ramfuzz/tools/Trainer.hpp"
+
+#include "TestUtil.hpp"
+
+namespace {
+
+using namespace ramfuzz;
+using namespace std;
+using namespace testing;
+
+using ramfuzz::test::dent;
+using ramfuzz::test::ient;
+
+/// Creates files in a fresh temporary directory.
+class TrainerTest : public ramfuzz::test::TempDirTest {
+protected:
+  TrainerTest() : TempDirTest("trainer") {}
+};
+
+TEST_F(TrainerTest, LearnsThreshold) {
+  // Runs succeed iff the value at location 10 exceeds the one at 20.
+  vector<string> logs;
+  for (int i = 0; i < 400; ++i) {
+    const int x = (i * 37) % 200 - 100, y = (i * 53) % 200 - 100;
+    if (x == y)
+      continue;
+    logs.push_back(log(to_string(i) + (x > y ? ".s" : ".f"),
+                       {ient(x, 10), ient(y, 20), ient(i % 3, 30)}));
+  }
+  vector<string> bad;
+  const auto f = extract(logs, 1024, 1, 1, bad);
+  TrainOptions opts;
+  opts.epochs = 30;
+  for (unsigned threads : {1u, 3u}) {
+    opts.threads = threads;
+    double accuracy;
+    const auto m = train(f.matrix(), opts, accuracy);
+    EXPECT_LT(.95, accuracy) << threads;
+    EXPECT_LT(0, m.weight(10, 0)) << threads;
+    EXPECT_GT(0, m.weight(20, 0)) << threads;
+    EXPECT_LT(0, m.score({ient(50, 10), ient(-50, 20)})) << threads;
+    EXPECT_GT(0, m.score({ient(-50, 10), ient(50, 20)})) << threads;
+  }
+}
+
+TEST_F(TrainerTest, Deterministic) {
+  vector<string> logs;
+  for (int i = 0; i < 50; ++i)
+    logs.push_back(log(to_string(i) + (i % 2 ? ".s" : ".f"),
+                       {ient(i % 7, 10), ient(i, 20)}));
+  vector<string> bad;
+  const auto f = extract(logs, 64, 1, 4, bad);
+  TrainOptions opts;
+  opts.threads = 2;
+  double a1, a2;
+  const auto m1 = train(f.matrix(), opts, a1),
+             m2 = train(f.matrix(), opts, a2);
+  EXPECT_EQ(a1, a2);
+  EXPECT_EQ(m1.bias(), m2.bias());
+  EXPECT_EQ(m1.weight(20, 0), m2.weight(20, 0));
+}
+
+TEST_F(TrainerTest, ExtremeMagnitudes) {
+  // Squaring these over- or underflows; the scaling must still be finite.
+  vector<string> logs;
+  for (int i = 0; i < 40; ++i)
+    logs.push_back(log(to_string(i) + (i % 2 ? ".s" : ".f"),
+                       {dent(i % 2 ? 1e307 : -1e307, 10),
+                        dent(i % 2 ? 1e-200 : -1e-200, 20)}));
+  vector<string> bad;
+  const auto f = extract(logs, 64, 1, 1, bad);
+  double accuracy;
+  const auto m = train(f.matrix(), TrainOptions(), accuracy);
+  EXPECT_EQ(1, accuracy);
+  EXPECT_LT(0, m.weight(10, 0));
+  EXPECT_LT(0, m.weight(20, 0));
+  EXPECT_TRUE(isfinite(m.score({dent(1e307, 10), dent(1e-200, 20)})));
+}
+
+TEST(OnlineTrainerTest, LearnsThreshold) {
+  // Same rule as above, learned one run at a time.
+  OnlineTrainer t(1, .05);
+  for (int pass = 0; pass < 10; ++pass)
+    for (int i = 0; i < 400; ++i) {
+      const int x = (i * 37) % 200 - 100, y = (i * 53) % 200 - 100;
+      if (x != y)
+        t.learn({ient(x, 10), ient(y, 20), ient(i % 3, 30)}, x > y);
+    }
+  EXPECT_EQ(3840u, t.runs());
+  const auto m = t.model();
+  EXPECT_EQ(1u, m.occurrences());
+  EXPECT_LT(0, m.weight(10, 0));
+  EXPECT_GT(0, m.weight(20, 0));
+  EXPECT_LT(0, m.score({ient(50, 10), ient(-50, 20)}));
+  EXPECT_GT(0, m.score({ient(-50, 10), ient(50, 20)}));
+}
+
+TEST(OnlineTrainerTest, ExtremeMagnitudes) {
+  OnlineTrainer t(1, .05);
+  for (int i = 0; i < 40; ++i)
+    t.learn({dent(i % 2 ? 1e307 : -1e307, 10),
+             dent(i % 2 ? 1e-200 : -1e-200, 20)},
+            i % 2);
+  const auto m = t.model();
+  EXPECT_LT(0, m.weight(10, 0));
+  EXPECT_LT(0, m.weight(20, 0));
+  EXPECT_LT(0, m.score({dent(1e307, 10), dent(1e-200, 20)}));
+}
+
+TEST(OnlineTrainerTest, ClipsOccurrences) {
+  OnlineTrainer t(2);
+  t.learn({ient(1, 10), ient(1, 10), ient(1, 10), ient(1, 20)}, true);
+  const auto m = t.model();
+  const auto &all = m.all();
+  ASSERT_EQ(1u, all.count(10));
+  EXPECT_EQ(2u, all.at(10).size());
+  EXPECT_EQ(1u, all.at(20).size());
+}
+
+TEST(OnlineTrainerTest, NonFiniteOccurrences) {
+  // As in extract(), a skipped value still counts as an occurrence.
+  OnlineTrainer t(2);
+  t.learn({dent(NAN, 10), dent(1, 10)}, true);
+  const auto m = t.model();
+  EXPECT_EQ(0, m.weight(10, 0));
+  EXPECT_LT(0, m.weight(10, 1));
+}
+
+} // anonymous namespace